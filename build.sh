@@ -0,0 +1,20 @@
+#!/bin/sh
+# Headless Linux build (offscreen renderer, no window). Requires the Vulkan SDK/loader and stb_image.h in ./include
+# Usage: ./build.sh [-d]
+
+exe_name="v"
+compiler_flags="-std=c++20 -O0 -fno-rtti -Wall -Wextra"
+ignore_warnings="-Wno-unused-parameter -Wno-missing-field-initializers"
+include_dirs="include"
+linker_flags="-lvulkan -pthread"
+
+if [ "$1" = "-d" ]; then
+    compiler_flags="$compiler_flags -g"
+fi
+
+if c++ $compiler_flags $ignore_warnings -I "$include_dirs" src/platform_linux_headless.cpp -o "$exe_name" $linker_flags; then
+    echo "Build successful"
+else
+    echo "Build failed"
+    exit 1
+fi
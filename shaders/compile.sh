@@ -0,0 +1,20 @@
+#!/bin/sh
+# Compiles every shader source to compiled/<name>_<stage>.spv, the names compile.bat produces and load_shader_data() expects
+# Usage: ./compile.sh   (from this directory; set GLSLC to pick a compiler other than the SDK's or the one on PATH)
+
+glslc="${GLSLC:-${VULKAN_SDK:+$VULKAN_SDK/bin/}glslc}"
+
+mkdir -p compiled
+
+status=0
+for source in *.vert *.frag; do
+    [ -e "$source" ] || continue
+    compiled_file="compiled/${source%.*}_${source##*.}.spv"
+    if "$glslc" "$source" -o "$compiled_file"; then
+        echo "$compiled_file compiled"
+    else
+        status=1
+    fi
+done
+
+exit $status
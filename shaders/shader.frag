@@ -1,12 +1,17 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(binding = 1) uniform sampler2D texture_sampler;
+//Bindless, indexed by SpriteInstance::texture_index. See TextureAtlas
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 layout(location = 0) in vec3 frag_vertex_color;
 layout(location = 1) in vec2 frag_texture_coord;
+layout(location = 2) in vec4 frag_tint;
+layout(location = 3) flat in uint frag_texture_index;
 
 layout(location = 0) out vec4 out_color;
 
 void main() {
-    out_color = texture(texture_sampler, frag_texture_coord);
+    //The index varies between instances drawn in the same call
+    out_color = texture(textures[nonuniformEXT(frag_texture_index)], frag_texture_coord) * frag_tint;
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
+layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 projection;
@@ -10,12 +10,26 @@ layout(location = 0) in vec2 in_position;
 layout(location = 1) in vec3 in_color;
 layout(location = 2) in vec2 in_texture_coord;
 
+//Per-instance stream, see SpriteInstance
+layout(location = 3) in vec2 in_model_x_axis;
+layout(location = 4) in vec2 in_model_y_axis;
+layout(location = 5) in vec2 in_model_translation;
+layout(location = 6) in uint in_texture_index;
+layout(location = 7) in vec4 in_tint;
+layout(location = 8) in vec4 in_uv_rect; //min.xy, max.xy within the atlas page
+
 layout (location = 0) out vec3 frag_vertex_color;
 layout (location = 1) out vec2 frag_texture_coord;
+layout (location = 2) out vec4 frag_tint;
+layout (location = 3) flat out uint frag_texture_index;
 
 void main() {
-    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(in_position, 0.0, 1.0);
+    mat3x2 sprite_model = mat3x2(in_model_x_axis, in_model_y_axis, in_model_translation);
+    vec2 world_position = sprite_model * vec3(in_position, 1.0);
+    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(world_position, 0.0, 1.0);
     frag_vertex_color = in_color;
-    frag_texture_coord = in_texture_coord;
+    frag_texture_coord = mix(in_uv_rect.xy, in_uv_rect.zw, in_texture_coord);
+    frag_tint = in_tint;
+    frag_texture_index = in_texture_index;
     //gl_Position = vec4(in_position, 0.0, 1.0);
 }
\ No newline at end of file
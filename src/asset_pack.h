@@ -0,0 +1,218 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+#include "texture.h"
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Every asset in one file: a header, an open-addressed table of contents keyed by the hash of each asset's path, the
+//path strings and then the blobs. The whole file is mapped read-only and blobs are used where they lie, so loading
+//an asset is a table lookup and whatever copy the GPU needs anyway. Built by asset_packer
+namespace AssetPack {
+    static constexpr u32 MAGIC = 0x4B415056; //"VPAK"
+    static constexpr u32 VERSION = 1;
+    static constexpr u64 BLOB_ALIGNMENT = 64; //Image levels are 16-aligned inside their blob, as load_ktx2() lays them out
+
+    enum class Type : u32 {
+        EMPTY = 0, //Unused table slot
+        SHADER = 1, //SPIR-V, the stage is in the name as with loose shaders
+        IMAGE = 2, //Texels of every level back to back, level 0 first, each 16-aligned
+        RAW = 3 //Vertex data and anything else, as it was on disk
+    };
+
+    struct Header {
+        u32 magic;
+        u32 version;
+        u64 file_size;
+        u32 entry_count;
+        u32 table_capacity; //Power of two
+        u64 table_offset;
+        u64 strings_offset;
+        u64 strings_size;
+    };
+
+    struct Entry {
+        u64 name_hash;
+        u64 offset; //From the start of the file
+        u64 size;
+        u32 name_offset; //Into the strings, null terminated
+        Type type;
+        ImageFormat format; //Images only
+        u32 width;
+        u32 height;
+        u32 level_count;
+    };
+
+    static_assert(sizeof(Header) == 48);
+    static_assert(sizeof(Entry) == 48);
+
+    //FNV-1a
+    u64 hash_name(const char* name) {
+        u64 hash = 0xCBF29CE484222325ull;
+        for(const char* character = name; *character; ++character) {
+            hash = (hash ^ static_cast<u8>(*character)) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+}
+
+struct MappedAssetPack {
+    const u8* data = nullptr;
+    u64 size = 0;
+    const AssetPack::Header* header = nullptr;
+    const AssetPack::Entry* entries = nullptr;
+    const char* strings = nullptr;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+void asset_pack_close(MappedAssetPack* pack) {
+    if(!pack->data) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(pack->data);
+    CloseHandle(pack->mapping);
+    CloseHandle(pack->file);
+#else
+    munmap(const_cast<u8*>(pack->data), pack->size);
+#endif
+    *pack = {};
+}
+
+//Maps the file and checks that the header and table of contents lie inside it. Blobs are checked as they are looked up
+bool asset_pack_open(const char* filename, MappedAssetPack* pack) {
+    *pack = {};
+
+#if defined(_WIN32)
+    pack->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(pack->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size = {};
+    GetFileSizeEx(pack->file, &file_size);
+    pack->size = static_cast<u64>(file_size.QuadPart);
+    pack->mapping = pack->size > 0 ? CreateFileMappingA(pack->file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    pack->data = pack->mapping ? (const u8*)MapViewOfFile(pack->mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(!pack->data) {
+        printf("MapViewOfFile() failed. [%s]\n", filename);
+        if(pack->mapping) {
+            CloseHandle(pack->mapping);
+        }
+        CloseHandle(pack->file);
+        *pack = {};
+        return false;
+    }
+#else
+    i32 file = open(filename, O_RDONLY);
+    if(file < 0) {
+        return false;
+    }
+
+    struct stat file_stat = {};
+    void* data = fstat(file, &file_stat) == 0 && file_stat.st_size > 0 ? mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file);
+    if(data == MAP_FAILED) {
+        printf("mmap() failed. [%s]\n", filename);
+        return false;
+    }
+
+    //Startup reads most of the pack, so start reading all of it in now rather than one fault at a time
+    madvise(data, file_stat.st_size, MADV_WILLNEED);
+    pack->data = (const u8*)data;
+    pack->size = static_cast<u64>(file_stat.st_size);
+#endif
+
+    const AssetPack::Header* header = (const AssetPack::Header*)pack->data;
+    bool valid = pack->size >= sizeof(AssetPack::Header) && header->magic == AssetPack::MAGIC && header->version == AssetPack::VERSION && header->file_size == pack->size;
+    valid = valid && header->table_capacity > 0 && (header->table_capacity & (header->table_capacity - 1)) == 0;
+    valid = valid && header->table_offset + static_cast<u64>(header->table_capacity) * sizeof(AssetPack::Entry) <= pack->size;
+    valid = valid && header->strings_size > 0 && header->strings_offset + header->strings_size <= pack->size && pack->data[header->strings_offset + header->strings_size - 1] == '\0';
+    if(!valid) {
+        printf("%s is not an asset pack of version %u.\n", filename, AssetPack::VERSION);
+        asset_pack_close(pack);
+        return false;
+    }
+
+    pack->header = header;
+    pack->entries = (const AssetPack::Entry*)(pack->data + header->table_offset);
+    pack->strings = (const char*)(pack->data + header->strings_offset);
+    return true;
+}
+
+bool asset_pack_entry_valid(const MappedAssetPack* pack, const AssetPack::Entry* entry) {
+    return entry->offset + entry->size <= pack->size && entry->name_offset < pack->header->strings_size;
+}
+
+const AssetPack::Entry* asset_pack_find(const MappedAssetPack* pack, const char* name) {
+    if(!pack->data) {
+        return nullptr;
+    }
+
+    u64 hash = AssetPack::hash_name(name);
+    u32 mask = pack->header->table_capacity - 1;
+    for(u32 probe = 0; probe <= mask; ++probe) {
+        const AssetPack::Entry* entry = &pack->entries[(hash + probe) & mask];
+        if(entry->type == AssetPack::Type::EMPTY) {
+            return nullptr;
+        }
+
+        if(entry->name_hash == hash && asset_pack_entry_valid(pack, entry) && strcmp(pack->strings + entry->name_offset, name) == 0) {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+const u8* asset_pack_data(const MappedAssetPack* pack, const AssetPack::Entry* entry) {
+    return pack->data + entry->offset;
+}
+
+//Points image_data at the texels inside the mapping, nothing is copied and image_free() leaves them alone
+bool asset_pack_image(const MappedAssetPack* pack, const AssetPack::Entry* entry, ImageData* image_data) {
+    *image_data = {};
+    if(entry->type != AssetPack::Type::IMAGE || image_format_block_size(entry->format) == 0 || entry->level_count == 0 || entry->level_count > ImageData::MAX_LEVELS) {
+        printf("%s is not an image. [Asset pack entry]\n", pack->strings + entry->name_offset);
+        return false;
+    }
+
+    u64 size = 0;
+    for(u32 level = 0; level < entry->level_count; ++level) {
+        u32 level_width = entry->width >> level ? entry->width >> level : 1;
+        u32 level_height = entry->height >> level ? entry->height >> level : 1;
+        image_data->level_offsets[level] = (size + 15) & ~15ull;
+        image_data->level_sizes[level] = image_level_size(entry->format, level_width, level_height);
+        size = image_data->level_offsets[level] + image_data->level_sizes[level];
+    }
+
+    if(size > entry->size) {
+        printf("%s is truncated. [Asset pack entry, %llu bytes, expected %llu]\n", pack->strings + entry->name_offset, (unsigned long long)entry->size, (unsigned long long)size);
+        return false;
+    }
+
+    image_data->pixels = const_cast<u8*>(asset_pack_data(pack, entry));
+    image_data->width = entry->width;
+    image_data->height = entry->height;
+    image_data->size = entry->size;
+    image_data->format = entry->format;
+    image_data->level_count = entry->level_count;
+    image_data->memory = ImageMemory::MAPPED;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,230 @@
+//Offline asset packer: gathers shaders, images and raw data into one asset pack the renderer maps at startup. Images
+//are stored decoded (RGBA8) or, for .ktx2, block-compressed with their mip chain, ready to be copied to staging
+//Build: c++ -std=c++20 -O2 -I include src/asset_packer.cpp -o asset_packer
+//       cl -std:c++20 -O2 -EHsc -I ..\include ..\src\asset_packer.cpp
+//Usage: asset_packer <output.pak> <file or directory>...   e.g. asset_packer assets.pak shaders/compiled textures
+//Assets are looked up by the path they were packed from, so pack from the directory the renderer runs in
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "texture.h"
+#include "asset_pack.h"
+
+struct PackInput {
+    std::string name;
+    AssetPack::Type type;
+    ImageData image; //Images only
+    std::vector<u8> bytes; //Everything else
+};
+
+bool has_extension(const std::string& name, const char* extension) {
+    std::string lower = std::filesystem::path(name).extension().string();
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char character) { return static_cast<char>(tolower(character)); });
+    return lower == extension;
+}
+
+bool read_file(const char* filename, std::vector<u8>* bytes) {
+    FILE* file = fopen(filename, "rb");
+    if(!file) {
+        printf("Could not open %s.\n", filename);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    bytes->resize(static_cast<size_t>(ftell(file)));
+    fseek(file, 0, SEEK_SET);
+    bool read = bytes->empty() || fread(bytes->data(), 1, bytes->size(), file) == bytes->size();
+    fclose(file);
+
+    if(!read) {
+        printf("%s could not be read.\n", filename);
+    }
+    return read;
+}
+
+bool load_input(PackInput* input) {
+    static constexpr const char* DECODED_EXTENSIONS[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm" };
+
+    const char* filename = input->name.c_str();
+    if(has_extension(input->name, ".ktx2")) {
+        input->type = AssetPack::Type::IMAGE;
+        return load_ktx2(filename, &input->image);
+    }
+
+    for(const char* extension : DECODED_EXTENSIONS) {
+        if(has_extension(input->name, extension)) {
+            input->type = AssetPack::Type::IMAGE;
+            return load_image(filename, &input->image);
+        }
+    }
+
+    if(!read_file(filename, &input->bytes)) {
+        return false;
+    }
+
+    input->type = AssetPack::Type::RAW;
+    if(has_extension(input->name, ".spv")) {
+        static constexpr u32 SPIRV_MAGIC = 0x07230203;
+        if(input->bytes.size() < 4 || input->bytes.size() % 4 != 0 || memcmp(input->bytes.data(), &SPIRV_MAGIC, 4) != 0) {
+            printf("%s is not SPIR-V.\n", filename);
+            return false;
+        }
+        input->type = AssetPack::Type::SHADER;
+    }
+
+    return true;
+}
+
+u64 align_up(u64 value, u64 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool write_pack(const char* filename, std::vector<PackInput>& inputs) {
+    u32 table_capacity = 16;
+    while(table_capacity < inputs.size() * 2) {
+        table_capacity *= 2;
+    }
+
+    std::vector<char> strings;
+    std::vector<AssetPack::Entry> table(table_capacity);
+    u64 table_offset = sizeof(AssetPack::Header);
+    u64 strings_offset = table_offset + sizeof(AssetPack::Entry) * table_capacity;
+    for(PackInput& input : inputs) {
+        strings.insert(strings.end(), input.name.c_str(), input.name.c_str() + input.name.size() + 1);
+    }
+
+    //Blobs go in the order the renderer asks for them at startup, so the first reads stay sequential
+    u64 offset = align_up(strings_offset + strings.size(), AssetPack::BLOB_ALIGNMENT);
+    u32 name_offset = 0;
+    for(PackInput& input : inputs) {
+        u64 size = input.type == AssetPack::Type::IMAGE ? input.image.size : input.bytes.size();
+        AssetPack::Entry entry = {
+            .name_hash = AssetPack::hash_name(input.name.c_str()),
+            .offset = offset,
+            .size = size,
+            .name_offset = name_offset,
+            .type = input.type,
+            .format = input.image.format,
+            .width = input.image.width,
+            .height = input.image.height,
+            .level_count = input.image.level_count
+        };
+
+        u32 slot = static_cast<u32>(entry.name_hash) & (table_capacity - 1);
+        while(table[slot].type != AssetPack::Type::EMPTY) {
+            slot = (slot + 1) & (table_capacity - 1);
+        }
+        table[slot] = entry;
+
+        name_offset += static_cast<u32>(input.name.size() + 1);
+        offset = align_up(offset + size, AssetPack::BLOB_ALIGNMENT);
+    }
+
+    AssetPack::Header header = {
+        .magic = AssetPack::MAGIC,
+        .version = AssetPack::VERSION,
+        .file_size = offset,
+        .entry_count = static_cast<u32>(inputs.size()),
+        .table_capacity = table_capacity,
+        .table_offset = table_offset,
+        .strings_offset = strings_offset,
+        .strings_size = strings.size()
+    };
+
+    FILE* file = fopen(filename, "wb");
+    if(!file) {
+        printf("Could not create %s.\n", filename);
+        return false;
+    }
+
+    static const u8 PADDING[AssetPack::BLOB_ALIGNMENT] = {};
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    written = written && fwrite(table.data(), sizeof(AssetPack::Entry), table.size(), file) == table.size();
+    written = written && fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+
+    u64 position = strings_offset + strings.size();
+    for(PackInput& input : inputs) {
+        u64 blob_offset = align_up(position, AssetPack::BLOB_ALIGNMENT);
+        written = written && fwrite(PADDING, 1, blob_offset - position, file) == blob_offset - position;
+
+        const u8* blob = input.type == AssetPack::Type::IMAGE ? input.image.pixels : input.bytes.data();
+        u64 size = input.type == AssetPack::Type::IMAGE ? input.image.size : input.bytes.size();
+        written = written && (size == 0 || fwrite(blob, 1, size, file) == size);
+        position = blob_offset + size;
+    }
+    written = written && fwrite(PADDING, 1, offset - position, file) == offset - position;
+
+    if(fclose(file) != 0 || !written) {
+        printf("Could not write %s.\n", filename);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        printf("Usage: %s <output.pak> <file or directory>...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<PackInput> inputs;
+    for(i32 argument_index = 2; argument_index < argc; ++argument_index) {
+        std::error_code error;
+        std::filesystem::path path = argv[argument_index];
+        if(!std::filesystem::is_directory(path, error)) {
+            inputs.push_back({ .name = path.generic_string() });
+            continue;
+        }
+
+        for(const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+            if(entry.is_regular_file()) {
+                inputs.push_back({ .name = entry.path().generic_string() });
+            }
+        }
+    }
+
+    bool loaded = true;
+    for(PackInput& input : inputs) {
+        loaded = load_input(&input) && loaded;
+    }
+
+    //Shaders, then images, then everything else, the order create_renderer() loads them in
+    std::stable_sort(inputs.begin(), inputs.end(), [](const PackInput& a, const PackInput& b) { return a.type < b.type; });
+    for(size_t index = 1; loaded && index < inputs.size(); ++index) {
+        for(size_t other = 0; other < index; ++other) {
+            if(inputs[index].name == inputs[other].name) {
+                printf("%s was given twice.\n", inputs[index].name.c_str());
+                loaded = false;
+            }
+        }
+    }
+
+    if(!loaded || inputs.empty() || !write_pack(argv[1], inputs)) {
+        for(PackInput& input : inputs) {
+            image_free(&input.image);
+        }
+        return 1;
+    }
+
+    u64 total_size = 0;
+    for(PackInput& input : inputs) {
+        static constexpr const char* TYPE_NAMES[] = { "empty", "shader", "image", "raw" };
+        u64 size = input.type == AssetPack::Type::IMAGE ? input.image.size : input.bytes.size();
+        total_size += size;
+        if(input.type == AssetPack::Type::IMAGE) {
+            printf("%-6s %10llu bytes  %s  %ux%u, %u levels\n", TYPE_NAMES[static_cast<u32>(input.type)], (unsigned long long)size, input.name.c_str(), input.image.width, input.image.height, input.image.level_count);
+        } else {
+            printf("%-6s %10llu bytes  %s\n", TYPE_NAMES[static_cast<u32>(input.type)], (unsigned long long)size, input.name.c_str());
+        }
+        image_free(&input.image);
+    }
+    printf("Packed %zd assets, %llu bytes, into %s\n", inputs.size(), (unsigned long long)total_size, argv[1]);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+#include "texture.h"
+
+//Bottom-left skyline packer. The skyline is the top edge of everything placed so far, stored as horizontal segments
+//from left to right. A rectangle goes wherever its top edge ends up lowest, so pages fill from the bottom up
+struct SkylineNode {
+    u32 x;
+    u32 y;
+    u32 width;
+};
+
+struct SkylinePacker {
+    static constexpr size_t MAX_NODES = 1024;
+
+    u32 width = 0;
+    u32 height = 0;
+    u32 used_width = 0; //Extent actually covered by placed rectangles
+    u32 used_height = 0;
+    size_t node_count = 0;
+    SkylineNode nodes[MAX_NODES];
+};
+
+void skyline_packer_init(SkylinePacker* packer, u32 width, u32 height) {
+    packer->width = width;
+    packer->height = height;
+    packer->used_width = 0;
+    packer->used_height = 0;
+    packer->node_count = 1;
+    packer->nodes[0] = { .x = 0, .y = 0, .width = width };
+}
+
+//Height the rectangle would sit at if its left edge is on node_index, or false if it runs off the page
+bool skyline_packer_fit(SkylinePacker* packer, size_t node_index, u32 width, u32 height, u32* y) {
+    u32 x = packer->nodes[node_index].x;
+    if(x + width > packer->width) {
+        return false;
+    }
+
+    u32 top = 0;
+    u32 remaining = width;
+    for(size_t index = node_index; remaining > 0; ++index) {
+        top = packer->nodes[index].y > top ? packer->nodes[index].y : top;
+        if(top + height > packer->height) {
+            return false;
+        }
+        remaining -= packer->nodes[index].width < remaining ? packer->nodes[index].width : remaining;
+    }
+
+    *y = top;
+    return true;
+}
+
+bool skyline_packer_insert(SkylinePacker* packer, u32 width, u32 height, u32* x, u32* y) {
+    if(width == 0 || height == 0 || packer->node_count == SkylinePacker::MAX_NODES) {
+        return false;
+    }
+
+    size_t best_index = SIZE_MAX;
+    u32 best_top = UINT32_MAX;
+    u32 best_width = UINT32_MAX;
+    for(size_t index = 0; index < packer->node_count; ++index) {
+        u32 fit_y = 0;
+        if(!skyline_packer_fit(packer, index, width, height, &fit_y)) {
+            continue;
+        }
+
+        //Ties go to the narrower segment, which leaves wider gaps for later rectangles
+        if(fit_y + height < best_top || (fit_y + height == best_top && packer->nodes[index].width < best_width)) {
+            best_index = index;
+            best_top = fit_y + height;
+            best_width = packer->nodes[index].width;
+            *y = fit_y;
+        }
+    }
+
+    if(best_index == SIZE_MAX) {
+        return false;
+    }
+
+    *x = packer->nodes[best_index].x;
+
+    //The new segment replaces the part of the skyline underneath the rectangle
+    memmove(&packer->nodes[best_index + 1], &packer->nodes[best_index], sizeof(SkylineNode) * (packer->node_count - best_index));
+    packer->nodes[best_index] = { .x = *x, .y = best_top, .width = width };
+    ++packer->node_count;
+
+    u32 right = *x + width;
+    size_t index = best_index + 1;
+    while(index < packer->node_count && packer->nodes[index].x < right) {
+        SkylineNode* node = &packer->nodes[index];
+        if(node->x + node->width <= right) {
+            memmove(node, node + 1, sizeof(SkylineNode) * (packer->node_count - index - 1));
+            --packer->node_count;
+            continue;
+        }
+
+        node->width -= right - node->x;
+        node->x = right;
+        break;
+    }
+
+    //Neighbours at the same height are one segment
+    for(index = 0; index + 1 < packer->node_count;) {
+        if(packer->nodes[index].y == packer->nodes[index + 1].y) {
+            packer->nodes[index].width += packer->nodes[index + 1].width;
+            memmove(&packer->nodes[index + 1], &packer->nodes[index + 2], sizeof(SkylineNode) * (packer->node_count - index - 2));
+            --packer->node_count;
+        } else {
+            ++index;
+        }
+    }
+
+    packer->used_width = right > packer->used_width ? right : packer->used_width;
+    packer->used_height = best_top > packer->used_height ? best_top : packer->used_height;
+
+    return true;
+}
+
+//Copies an RGBA8 image to (x, y) of the page and repeats its outermost rows and columns extrude pixels outwards, so
+//bilinear taps that land just outside the sub-image read its own edge instead of a neighbour
+void atlas_blit_extruded(u8* page, u32 page_width, ImageData* image, u32 x, u32 y, u32 extrude) {
+    size_t page_pitch = static_cast<size_t>(page_width) * 4;
+    size_t image_pitch = static_cast<size_t>(image->width) * 4;
+
+    for(u32 row = 0; row < image->height + 2 * extrude; ++row) {
+        u32 source_row = row < extrude ? 0 : (row - extrude >= image->height ? image->height - 1 : row - extrude);
+        u8* source = image->pixels + source_row * image_pitch;
+        u8* destination = page + (y + row) * page_pitch + static_cast<size_t>(x) * 4;
+
+        for(u32 column = 0; column < extrude; ++column) {
+            memcpy(destination + column * 4, source, 4);
+            memcpy(destination + (extrude + image->width + column) * 4, source + image_pitch - 4, 4);
+        }
+        memcpy(destination + extrude * 4, source, image_pitch);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+//Startup decode time for every image in a directory, on the calling thread alone and then spread over the job pool
+//Build: c++ -std=c++20 -O2 -I include src/benchmark_decode.cpp -o benchmark_decode -pthread
+//       cl -std:c++20 -O2 -EHsc -I ..\include ..\src\benchmark_decode.cpp
+//Usage: benchmark_decode <directory> [threads]
+#include <stdio.h>
+#include <stdlib.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "memory.h"
+#include "time.h"
+#include "texture.h"
+#include "job_pool.h"
+
+struct DecodeJob {
+    const char* filename;
+    ImageData image;
+    bool loaded;
+};
+
+struct DecodeResult {
+    f64 milliseconds = 0.0;
+    u64 bytes = 0;
+    size_t failed = 0;
+};
+
+void decode_job(void* data) {
+    DecodeJob* job = static_cast<DecodeJob*>(data);
+    job->loaded = load_image(job->filename, &job->image);
+}
+
+DecodeResult collect(std::vector<DecodeJob>& jobs, Time::Stamp start) {
+    DecodeResult result = {};
+    result.milliseconds = static_cast<f64>(std::chrono::duration_cast<Time::Nanoseconds>(Time::Clock::now() - start).count()) / 1e6;
+    for(DecodeJob& job : jobs) {
+        if(job.loaded) {
+            result.bytes += job.image.size;
+            image_free(&job.image);
+        } else {
+            ++result.failed;
+        }
+    }
+    return result;
+}
+
+//threads counts the caller, so 1 decodes without a pool
+DecodeResult decode_all(std::vector<DecodeJob>& jobs, MemoryArena* arena, size_t threads) {
+    if(threads == 1) {
+        Time::Stamp start = Time::Clock::now();
+        for(DecodeJob& job : jobs) {
+            decode_job(&job);
+        }
+        return collect(jobs, start);
+    }
+
+    JobPool* pool = job_pool_create(arena, threads - 1);
+    if(!pool) {
+        exit(1);
+    }
+
+    Time::Stamp start = Time::Clock::now();
+    JobCounter counter;
+    for(DecodeJob& job : jobs) {
+        job_pool_submit(pool, decode_job, &job, &counter);
+    }
+    job_pool_wait(pool, &counter);
+    DecodeResult result = collect(jobs, start);
+
+    job_pool_destroy(pool);
+    memory_arena_reset(arena);
+    return result;
+}
+
+void print_result(const char* label, size_t threads, DecodeResult result, f64 baseline_ms) {
+    f64 megabytes = static_cast<f64>(result.bytes) / (1024.0 * 1024.0);
+    printf("%-8s %2zd threads %9.2f ms %9.1f MB/s decoded %6.2fx\n", label, threads, result.milliseconds, megabytes / (result.milliseconds / 1000.0), baseline_ms / result.milliseconds);
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        printf("Usage: %s <directory> [threads]\n", argv[0]);
+        return 1;
+    }
+
+    size_t threads = argc > 2 ? strtoull(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+    threads = threads > 1 ? threads : 2;
+    threads = threads <= JobPool::MAX_WORKERS + 1 ? threads : JobPool::MAX_WORKERS + 1;
+
+    std::error_code error;
+    std::vector<std::string> filenames;
+    for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(argv[1], error)) {
+        if(entry.is_regular_file()) {
+            filenames.push_back(entry.path().string());
+        }
+    }
+    if(error || filenames.empty()) {
+        printf("No files in %s.\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<DecodeJob> jobs(filenames.size());
+    for(size_t index = 0; index < jobs.size(); ++index) {
+        jobs[index] = { .filename = filenames[index].c_str() };
+    }
+
+    MemoryArena* arena = memory_arena_create(MB(4));
+    if(!arena) {
+        return 1;
+    }
+
+    //One untimed pass so both runs read files from the page cache
+    decode_all(jobs, arena, 1);
+    DecodeResult single = decode_all(jobs, arena, 1);
+    DecodeResult pooled = decode_all(jobs, arena, threads);
+
+    printf("%zd files, %zd not decoded\n", jobs.size(), single.failed);
+    print_result("Serial", 1, single, single.milliseconds);
+    print_result("Pool", threads, pooled, single.milliseconds);
+
+    memory_arena_free(arena);
+    return 0;
+}
\ No newline at end of file
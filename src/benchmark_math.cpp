@@ -0,0 +1,127 @@
+//Microbenchmark for the Vec4/Mat4 SIMD kernels in math.h against the generic templates
+//Build: c++ -std=c++20 -O2 src/benchmark_math.cpp -o benchmark_math   (add -mavx for the AVX Mat4 * Mat4 path)
+//       cl -std:c++20 -O2 -EHsc ..\src\benchmark_math.cpp              (add -arch:AVX for the AVX Mat4 * Mat4 path)
+#include <stdio.h>
+#include <stdlib.h>
+#include "types.h"
+#include "math.h"
+#include "time.h"
+
+static constexpr size_t BENCHMARK_COUNT = 4096;
+static constexpr size_t BENCHMARK_ITERATIONS = 2000;
+
+struct BenchmarkResult {
+    f64 generic_ns = 0.0;
+    f64 simd_ns = 0.0;
+    f32 max_error = 0.0f;
+};
+
+static Mat4 matrices[BENCHMARK_COUNT];
+static Vec4 vectors[BENCHMARK_COUNT] = {};
+
+//Keeps the optimizer from discarding the benchmarked work
+static volatile f32 benchmark_sink = 0.0f;
+
+f32 random_f32() {
+    return static_cast<f32>(rand()) / static_cast<f32>(RAND_MAX) * 2.0f - 1.0f;
+}
+
+f64 nanoseconds_per_operation(Time::Stamp start, Time::Stamp end) {
+    return static_cast<f64>(std::chrono::duration_cast<Time::Nanoseconds>(end - start).count()) / static_cast<f64>(BENCHMARK_COUNT * BENCHMARK_ITERATIONS);
+}
+
+f32 max_f32(f32 a, f32 b) {
+    return a > b ? a : b;
+}
+
+template<typename GenericKernel, typename SimdKernel, typename ErrorKernel>
+BenchmarkResult benchmark(GenericKernel generic_kernel, SimdKernel simd_kernel, ErrorKernel error_kernel) {
+    BenchmarkResult result = {};
+
+    for(size_t i = 0; i < BENCHMARK_COUNT; ++i) {
+        result.max_error = max_f32(result.max_error, error_kernel(i));
+    }
+
+    f32 sink = 0.0f;
+    Time::Stamp start = Time::Clock::now();
+    for(size_t iteration = 0; iteration < BENCHMARK_ITERATIONS; ++iteration) {
+        for(size_t i = 0; i < BENCHMARK_COUNT; ++i) {
+            sink += generic_kernel(i);
+        }
+    }
+    result.generic_ns = nanoseconds_per_operation(start, Time::Clock::now());
+
+    start = Time::Clock::now();
+    for(size_t iteration = 0; iteration < BENCHMARK_ITERATIONS; ++iteration) {
+        for(size_t i = 0; i < BENCHMARK_COUNT; ++i) {
+            sink += simd_kernel(i);
+        }
+    }
+    result.simd_ns = nanoseconds_per_operation(start, Time::Clock::now());
+
+    benchmark_sink = sink;
+    return result;
+}
+
+void print_result(const char* name, BenchmarkResult result) {
+    printf("%-16s generic %7.3f ns  simd %7.3f ns  speedup %5.2fx  max error %g\n", name, result.generic_ns, result.simd_ns, result.generic_ns / result.simd_ns, result.max_error);
+}
+
+int main() {
+#if defined(MATH_SIMD_AVX)
+    printf("SIMD path: SSE + AVX\n");
+#elif defined(MATH_SIMD_SSE)
+    printf("SIMD path: SSE\n");
+#elif defined(MATH_SIMD_NEON)
+    printf("SIMD path: NEON\n");
+#else
+    printf("SIMD path: none (generic fallback)\n");
+#endif
+
+    srand(1);
+    for(size_t i = 0; i < BENCHMARK_COUNT; ++i) {
+        for(size_t column = 0; column < 4; ++column) {
+            for(size_t row = 0; row < 4; ++row) {
+                matrices[i][column][row] = random_f32();
+            }
+            vectors[i][column] = random_f32();
+        }
+    }
+
+    //Each operation is chained against a neighbour so both sides see the same memory traffic
+    print_result("Mat4 * Mat4", benchmark([](size_t i) { return matrix_multiply<f32, 4, 4>(matrices[i], matrices[(i + 1) % BENCHMARK_COUNT]).data[i & 3][0]; }, [](size_t i) { return (matrices[i] * matrices[(i + 1) % BENCHMARK_COUNT]).data[i & 3][0]; }, [](size_t i) {
+        Mat4 expected = matrix_multiply<f32, 4, 4>(matrices[i], matrices[(i + 1) % BENCHMARK_COUNT]);
+        Mat4 actual = matrices[i] * matrices[(i + 1) % BENCHMARK_COUNT];
+        f32 error = 0.0f;
+        for(size_t column = 0; column < 4; ++column) {
+            for(size_t row = 0; row < 4; ++row) {
+                error = max_f32(error, fabsf(expected[column][row] - actual[column][row]));
+            }
+        }
+        return error;
+    }));
+
+    print_result("Mat4 * Vec4", benchmark([](size_t i) { return matrix_transform<f32, 4, 4>(matrices[i], vectors[i])[i & 3]; }, [](size_t i) { return (matrices[i] * vectors[i])[i & 3]; }, [](size_t i) {
+        Vec4 expected = matrix_transform<f32, 4, 4>(matrices[i], vectors[i]);
+        Vec4 actual = matrices[i] * vectors[i];
+        f32 error = 0.0f;
+        for(size_t component = 0; component < 4; ++component) {
+            error = max_f32(error, fabsf(expected[component] - actual[component]));
+        }
+        return error;
+    }));
+
+    print_result("Vec4 dot", benchmark([](size_t i) { return vector_dot<f32, 4>(vectors[i], vectors[(i + 1) % BENCHMARK_COUNT]); }, [](size_t i) { return vectors[i].dot(vectors[(i + 1) % BENCHMARK_COUNT]); }, [](size_t i) { return fabsf(vector_dot<f32, 4>(vectors[i], vectors[(i + 1) % BENCHMARK_COUNT]) - vectors[i].dot(vectors[(i + 1) % BENCHMARK_COUNT])); }));
+
+    print_result("Vec4 normalize", benchmark([](size_t i) { return vector_normalize<f32, 4>(vectors[i])[i & 3]; }, [](size_t i) { return vectors[i].normalize()[i & 3]; }, [](size_t i) {
+        Vec4 expected = vector_normalize<f32, 4>(vectors[i]);
+        Vec4 actual = vectors[i].normalize();
+        f32 error = 0.0f;
+        for(size_t component = 0; component < 4; ++component) {
+            error = max_f32(error, fabsf(expected[component] - actual[component]));
+        }
+        return error;
+    }));
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+//Benchmark for the SpriteBatch transform pass against per-sprite Mat4 translation * rotation * scale
+//Build: c++ -std=c++20 -O2 src/benchmark_sprites.cpp -o benchmark_sprites
+//       cl -std:c++20 -O2 -EHsc ..\src\benchmark_sprites.cpp
+#include <stdio.h>
+#include <stdlib.h>
+#include "types.h"
+#include "math.h"
+#include "memory.h"
+#include "time.h"
+#include "sprite_batch.h"
+
+static constexpr size_t BENCHMARK_SPRITES = 100'000;
+static constexpr size_t BENCHMARK_TICKS = 100;
+
+//The layout SpriteBatch replaces: three full matrices per sprite, composed every tick
+struct MatrixTransform {
+    Mat4 translation = MAT4_IDENTITY;
+    Mat4 rotation = MAT4_IDENTITY;
+    Mat4 scale = MAT4_IDENTITY;
+};
+
+f32 random_range(f32 minimum, f32 maximum) {
+    return minimum + (maximum - minimum) * (static_cast<f32>(rand()) / static_cast<f32>(RAND_MAX));
+}
+
+f64 milliseconds_per_tick(Time::Stamp start, Time::Stamp end) {
+    return static_cast<f64>(std::chrono::duration_cast<Time::Nanoseconds>(end - start).count()) / 1'000'000.0 / static_cast<f64>(BENCHMARK_TICKS);
+}
+
+int main() {
+    MemoryArena* arena = memory_arena_create(MB(64));
+    if(!arena) {
+        return 1;
+    }
+
+    SpriteBatch* batch = sprite_batch_create(arena, BENCHMARK_SPRITES);
+    MatrixTransform* matrix_transforms = (MatrixTransform*)malloc(sizeof(MatrixTransform) * BENCHMARK_SPRITES);
+    Mat4* matrix_models = (Mat4*)malloc(sizeof(Mat4) * BENCHMARK_SPRITES);
+    if(!batch || !matrix_transforms || !matrix_models) {
+        printf("Allocation failed.\n");
+        return 1;
+    }
+
+    srand(1);
+    for(size_t i = 0; i < BENCHMARK_SPRITES; ++i) {
+        Sprite sprite = sprite_batch_add(batch, 0);
+        batch->transforms.position_x[sprite.index] = random_range(-1000.0f, 1000.0f);
+        batch->transforms.position_y[sprite.index] = random_range(-1000.0f, 1000.0f);
+        batch->transforms.rotation[sprite.index] = random_range(-4.0f * PI, 4.0f * PI);
+        batch->transforms.scale_x[sprite.index] = random_range(0.1f, 4.0f);
+        batch->transforms.scale_y[sprite.index] = random_range(0.1f, 4.0f);
+
+        matrix_transforms[i] = {};
+        matrix_transforms[i].translation[0][3] = batch->transforms.position_x[sprite.index];
+        matrix_transforms[i].translation[1][3] = batch->transforms.position_y[sprite.index];
+    }
+
+    //Matrix path: trig per sprite, then two Mat4 products (row-major, column vectors)
+    Time::Stamp start = Time::Clock::now();
+    for(size_t tick = 0; tick < BENCHMARK_TICKS; ++tick) {
+        for(size_t i = 0; i < BENCHMARK_SPRITES; ++i) {
+            f32 sine = sinf(batch->transforms.rotation[i]);
+            f32 cosine = cosf(batch->transforms.rotation[i]);
+            MatrixTransform* transform = &matrix_transforms[i];
+            transform->rotation[0][0] = cosine;
+            transform->rotation[0][1] = -sine;
+            transform->rotation[1][0] = sine;
+            transform->rotation[1][1] = cosine;
+            transform->scale[0][0] = batch->transforms.scale_x[i];
+            transform->scale[1][1] = batch->transforms.scale_y[i];
+            matrix_models[i] = transform->translation * transform->rotation * transform->scale;
+        }
+    }
+    f64 matrix_ms = milliseconds_per_tick(start, Time::Clock::now());
+
+    //Batch path, scalar only
+    start = Time::Clock::now();
+    for(size_t tick = 0; tick < BENCHMARK_TICKS; ++tick) {
+        for(size_t i = 0; i < batch->count; ++i) {
+            affine_compose(batch->transforms.position_x[i], batch->transforms.position_y[i], batch->transforms.rotation[i], batch->transforms.scale_x[i], batch->transforms.scale_y[i], &batch->model_matrices[i]);
+        }
+    }
+    f64 scalar_ms = milliseconds_per_tick(start, Time::Clock::now());
+
+    start = Time::Clock::now();
+    for(size_t tick = 0; tick < BENCHMARK_TICKS; ++tick) {
+        sprite_batch_update_transforms(batch);
+    }
+    f64 batch_ms = milliseconds_per_tick(start, Time::Clock::now());
+
+    f32 max_error = 0.0f;
+    for(size_t i = 0; i < batch->count; ++i) {
+        Affine2D* affine = &batch->model_matrices[i];
+        Mat4* model = &matrix_models[i];
+        f32 errors[] = {
+            fabsf(affine->x_axis[0] - (*model)[0][0]),
+            fabsf(affine->x_axis[1] - (*model)[1][0]),
+            fabsf(affine->y_axis[0] - (*model)[0][1]),
+            fabsf(affine->y_axis[1] - (*model)[1][1]),
+            fabsf(affine->translation[0] - (*model)[0][3]),
+            fabsf(affine->translation[1] - (*model)[1][3])
+        };
+        for(f32 error : errors) {
+            max_error = error > max_error ? error : max_error;
+        }
+    }
+
+    size_t batch_bytes = sizeof(f32) * 5 + sizeof(u32) + sizeof(Affine2D);
+    size_t matrix_bytes = sizeof(MatrixTransform) + sizeof(Mat4);
+
+    printf("%zd sprites, %zd ticks\n", BENCHMARK_SPRITES, BENCHMARK_TICKS);
+    printf("Mat4 T * R * S       %7.3f ms/tick  %3zd bytes/sprite\n", matrix_ms, matrix_bytes);
+    printf("SpriteBatch scalar   %7.3f ms/tick  %3zd bytes/sprite\n", scalar_ms, batch_bytes);
+    printf("SpriteBatch SIMD     %7.3f ms/tick  %3zd bytes/sprite  (%.2fx vs Mat4, %.2fx vs scalar)\n", batch_ms, batch_bytes, matrix_ms / batch_ms, scalar_ms / batch_ms);
+    printf("Transform state      %3zd -> %zd bytes/sprite\n", sizeof(MatrixTransform), sizeof(f32) * 5);
+    printf("Max error vs sinf/cosf: %g\n", max_error);
+
+    free(matrix_models);
+    free(matrix_transforms);
+    memory_arena_free(arena);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+//Cost of trace_begin()/trace_end() while recording and while tracing is off
+//Build: c++ -std=c++20 -O2 src/benchmark_trace.cpp -o benchmark_trace
+//       cl -std:c++20 -O2 -EHsc ..\src\benchmark_trace.cpp
+#include <stdio.h>
+#include "types.h"
+#include "time.h"
+#include "trace.h"
+
+static constexpr size_t BENCHMARK_PAIRS = 100'000; //Fits in one TraceBuffer, nothing is dropped
+
+f64 nanoseconds_per_event(Time::Stamp start, Time::Stamp end) {
+    return static_cast<f64>(std::chrono::duration_cast<Time::Nanoseconds>(end - start).count()) / static_cast<f64>(BENCHMARK_PAIRS * 2);
+}
+
+int main() {
+    Time::Stamp start = Time::Clock::now();
+    for(size_t i = 0; i < BENCHMARK_PAIRS; ++i) {
+        TraceScope trace_scope("disabled");
+    }
+    f64 disabled_ns = nanoseconds_per_event(start, Time::Clock::now());
+
+    if(!trace_start("benchmark_trace.json")) {
+        return 1;
+    }
+
+    start = Time::Clock::now();
+    for(size_t i = 0; i < BENCHMARK_PAIRS; ++i) {
+        TraceScope trace_scope("enabled");
+    }
+    f64 enabled_ns = nanoseconds_per_event(start, Time::Clock::now());
+
+    printf("%zd begin/end pairs\n", BENCHMARK_PAIRS);
+    printf("Tracing off  %6.2f ns/event\n", disabled_ns);
+    printf("Tracing on   %6.2f ns/event\n", enabled_ns);
+
+    return trace_write() ? 0 : 1;
+}
\ No newline at end of file
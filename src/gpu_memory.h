@@ -0,0 +1,420 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+
+//Block based device memory allocator. Each memory type gets its own pools of large VkDeviceMemory blocks which are
+//split with a binary buddy scheme, so the driver only sees a handful of vkAllocateMemory calls no matter how many
+//buffers and images we create
+
+//Linear resources (buffers) and optimal tiling images never share a block, which keeps bufferImageGranularity from
+//ever applying between neighbours
+enum class GpuResourceKind : u32 {
+    LINEAR,
+    OPTIMAL_IMAGE,
+    COUNT
+};
+
+//Buddy tree over one block. Node i has children 2i and 2i + 1, each node stores 1 + log2 of the largest free run in
+//its subtree (in MIN_ALLOCATION units), 0 means the subtree is fully used
+struct GpuMemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mapped = nullptr; //Host visible blocks are mapped once for their whole lifetime
+    VkDeviceSize size = 0;
+    VkDeviceSize reserved = 0; //Sum of the power of two ranges handed out
+    u32 levels = 0; //size == MIN_ALLOCATION << levels
+    u32 allocation_count = 0;
+    u8* tree = nullptr;
+};
+
+struct GpuMemoryPool {
+    static constexpr size_t MAX_BLOCKS = 16;
+
+    GpuMemoryBlock* blocks[MAX_BLOCKS];
+    u32 block_count = 0;
+};
+
+struct GpuAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0; //As requested, before rounding
+    void* mapped = nullptr;
+    u32 memory_type = UINT32_MAX;
+    GpuResourceKind kind = GpuResourceKind::LINEAR;
+    u32 block_index = UINT32_MAX; //UINT32_MAX for dedicated allocations
+    u32 order = 0;
+};
+
+struct GpuMemoryStats {
+    u32 device_allocations = 0;
+    u32 blocks = 0;
+    u32 dedicated_allocations = 0;
+    u32 allocations = 0;
+    VkDeviceSize bytes_allocated = 0; //Everything we got from vkAllocateMemory
+    VkDeviceSize bytes_reserved = 0; //Handed out, including buddy rounding
+    VkDeviceSize bytes_requested = 0; //What callers asked for
+    f32 fragmentation = 0.0f; //1 - largest free range / total free, over all blocks
+};
+
+struct GpuAllocator {
+    static constexpr VkDeviceSize BLOCK_SIZE = 64ull * 1024 * 1024;
+    static constexpr VkDeviceSize MIN_ALLOCATION = 256;
+    static constexpr size_t MEMORY_TYPE_CACHE_SIZE = 8;
+
+    struct MemoryTypeCacheEntry {
+        u32 memory_type_bits = 0;
+        VkMemoryPropertyFlags property_flags = 0;
+        u32 memory_type = UINT32_MAX;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memory_properties = {};
+    u32 max_allocation_count = 0;
+    VkDeviceSize block_sizes[VK_MAX_MEMORY_TYPES];
+    GpuMemoryPool pools[VK_MAX_MEMORY_TYPES][static_cast<size_t>(GpuResourceKind::COUNT)];
+
+    MemoryTypeCacheEntry memory_type_cache[MEMORY_TYPE_CACHE_SIZE];
+    size_t memory_type_cache_next = 0;
+
+    u32 device_allocation_count = 0;
+    u32 dedicated_allocation_count = 0;
+    u32 allocation_count = 0;
+    VkDeviceSize bytes_allocated = 0;
+    VkDeviceSize bytes_requested = 0;
+    VkDeviceSize dedicated_bytes = 0;
+};
+
+u32 gpu_memory_log2(VkDeviceSize value) {
+    u32 log = 0;
+    while(value > 1) {
+        value >>= 1;
+        ++log;
+    }
+    return log;
+}
+
+void gpu_allocator_create(GpuAllocator* allocator, VkDevice device, VkPhysicalDevice physical_device) {
+    *allocator = {};
+    allocator->device = device;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &allocator->memory_properties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    allocator->max_allocation_count = properties.limits.maxMemoryAllocationCount;
+
+    //Small heaps (the 256MB BAR window on discrete cards) get smaller blocks so one block can't starve the heap
+    for(u32 memory_type = 0; memory_type < allocator->memory_properties.memoryTypeCount; ++memory_type) {
+        VkDeviceSize heap_size = allocator->memory_properties.memoryHeaps[allocator->memory_properties.memoryTypes[memory_type].heapIndex].size;
+        VkDeviceSize block_size = GpuAllocator::BLOCK_SIZE;
+        while(block_size > GpuAllocator::MIN_ALLOCATION && block_size > heap_size / 8) {
+            block_size >>= 1;
+        }
+        allocator->block_sizes[memory_type] = block_size;
+    }
+}
+
+//Exact match on every requested property flag, cached since the same few combinations are asked for over and over
+u32 gpu_allocator_find_memory_type(GpuAllocator* allocator, u32 memory_type_bits, VkMemoryPropertyFlags property_flags) {
+    for(size_t entry_index = 0; entry_index < GpuAllocator::MEMORY_TYPE_CACHE_SIZE; ++entry_index) {
+        GpuAllocator::MemoryTypeCacheEntry* entry = &allocator->memory_type_cache[entry_index];
+        if(entry->memory_type != UINT32_MAX && entry->memory_type_bits == memory_type_bits && entry->property_flags == property_flags) {
+            return entry->memory_type;
+        }
+    }
+
+    u32 memory_type = UINT32_MAX;
+    for(u32 memory_type_index = 0; memory_type_index < allocator->memory_properties.memoryTypeCount; ++memory_type_index) {
+        if((memory_type_bits & (1u << memory_type_index)) &&
+           (allocator->memory_properties.memoryTypes[memory_type_index].propertyFlags & property_flags) == property_flags) {
+            memory_type = memory_type_index;
+            break;
+        }
+    }
+
+    if(memory_type != UINT32_MAX) {
+        allocator->memory_type_cache[allocator->memory_type_cache_next] = {
+            .memory_type_bits = memory_type_bits,
+            .property_flags = property_flags,
+            .memory_type = memory_type
+        };
+        allocator->memory_type_cache_next = (allocator->memory_type_cache_next + 1) % GpuAllocator::MEMORY_TYPE_CACHE_SIZE;
+    }
+
+    return memory_type;
+}
+
+VkResult gpu_allocator_allocate_device_memory(GpuAllocator* allocator, u32 memory_type, VkDeviceSize size, VkDeviceMemory* memory, void** mapped) {
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    if(allocator->device_allocation_count >= allocator->max_allocation_count) {
+        result = VK_ERROR_TOO_MANY_OBJECTS;
+        printf("gpu_allocator_allocate_device_memory() failed. [maxMemoryAllocationCount (%u) reached]\n", allocator->max_allocation_count);
+        return result;
+    }
+
+    VkMemoryAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .allocationSize = size,
+        .memoryTypeIndex = memory_type
+    };
+
+    result = vkAllocateMemory(allocator->device, &allocate_info, nullptr, memory);
+    if(result != VK_SUCCESS) {
+        printf("vkAllocateMemory() failed. [%llu bytes, memory type %u]\n", (unsigned long long)size, memory_type);
+        return result;
+    }
+
+    *mapped = nullptr;
+    if(allocator->memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(allocator->device, *memory, 0, VK_WHOLE_SIZE, 0, mapped);
+        if(result != VK_SUCCESS) {
+            printf("vkMapMemory() failed.\n");
+            vkFreeMemory(allocator->device, *memory, nullptr);
+            return result;
+        }
+    }
+
+    ++allocator->device_allocation_count;
+    allocator->bytes_allocated += size;
+
+    return result;
+}
+
+GpuMemoryBlock* gpu_memory_block_create(GpuAllocator* allocator, u32 memory_type) {
+    GpuMemoryBlock* block = (GpuMemoryBlock*)malloc(sizeof(GpuMemoryBlock));
+    if(!block) {
+        printf("gpu_memory_block_create() failed. [GpuMemoryBlock object allocation]\n");
+        return nullptr;
+    }
+
+    *block = {};
+    block->size = allocator->block_sizes[memory_type];
+    block->levels = gpu_memory_log2(block->size / GpuAllocator::MIN_ALLOCATION);
+
+    size_t node_count = size_t(2) << block->levels;
+    block->tree = (u8*)malloc(node_count);
+    if(!block->tree) {
+        printf("gpu_memory_block_create() failed. [Buddy tree allocation, %zd nodes]\n", node_count);
+        free(block);
+        return nullptr;
+    }
+
+    //A node at depth d is free for an order of (levels - d), stored plus one
+    for(u32 depth = 0; depth <= block->levels; ++depth) {
+        memset(block->tree + (size_t(1) << depth), static_cast<i32>(block->levels - depth + 1), size_t(1) << depth);
+    }
+
+    if(gpu_allocator_allocate_device_memory(allocator, memory_type, block->size, &block->memory, &block->mapped) != VK_SUCCESS) {
+        free(block->tree);
+        free(block);
+        return nullptr;
+    }
+
+    return block;
+}
+
+//Returns the offset of a free range of MIN_ALLOCATION << order bytes, or UINT64_MAX if the block can't fit it
+VkDeviceSize gpu_memory_block_allocate(GpuMemoryBlock* block, u32 order) {
+    if(order > block->levels || block->tree[1] < order + 1) {
+        return UINT64_MAX;
+    }
+
+    size_t node = 1;
+    for(u32 depth = 0; depth < block->levels - order; ++depth) {
+        node = block->tree[node * 2] >= order + 1 ? node * 2 : node * 2 + 1;
+    }
+
+    block->tree[node] = 0;
+    size_t first_node_at_depth = size_t(1) << (block->levels - order);
+    VkDeviceSize offset = (node - first_node_at_depth) * (GpuAllocator::MIN_ALLOCATION << order);
+
+    while(node > 1) {
+        node /= 2;
+        u8 left = block->tree[node * 2];
+        u8 right = block->tree[node * 2 + 1];
+        block->tree[node] = left > right ? left : right;
+    }
+
+    block->reserved += GpuAllocator::MIN_ALLOCATION << order;
+    ++block->allocation_count;
+    return offset;
+}
+
+void gpu_memory_block_free(GpuMemoryBlock* block, VkDeviceSize offset, u32 order) {
+    size_t node = (size_t(1) << (block->levels - order)) + offset / (GpuAllocator::MIN_ALLOCATION << order);
+    block->tree[node] = static_cast<u8>(order + 1);
+
+    //Buddies that are both completely free merge back into their parent
+    for(u32 parent_order = order + 1; node > 1; ++parent_order) {
+        node /= 2;
+        u8 left = block->tree[node * 2];
+        u8 right = block->tree[node * 2 + 1];
+        if(left == parent_order && right == parent_order) {
+            block->tree[node] = static_cast<u8>(parent_order + 1);
+        } else {
+            block->tree[node] = left > right ? left : right;
+        }
+    }
+
+    block->reserved -= GpuAllocator::MIN_ALLOCATION << order;
+    --block->allocation_count;
+}
+
+VkResult gpu_allocate(GpuAllocator* allocator, VkMemoryRequirements* requirements, VkMemoryPropertyFlags property_flags, GpuResourceKind kind, GpuAllocation* allocation) {
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    u32 memory_type = gpu_allocator_find_memory_type(allocator, requirements->memoryTypeBits, property_flags);
+    if(memory_type == UINT32_MAX) {
+        result = VK_ERROR_FEATURE_NOT_PRESENT;
+        printf("gpu_allocate() failed. [No memory type for bits 0x%x with properties 0x%x]\n", requirements->memoryTypeBits, property_flags);
+        return result;
+    }
+
+    *allocation = {
+        .size = requirements->size,
+        .memory_type = memory_type,
+        .kind = kind
+    };
+
+    //Buddy ranges are aligned to their own size, so rounding up to the alignment covers both
+    VkDeviceSize range_size = requirements->size > requirements->alignment ? requirements->size : requirements->alignment;
+    VkDeviceSize block_size = allocator->block_sizes[memory_type];
+
+    //Anything over half a block would waste most of one, those get their own VkDeviceMemory
+    if(range_size > block_size / 2) {
+        result = gpu_allocator_allocate_device_memory(allocator, memory_type, requirements->size, &allocation->memory, &allocation->mapped);
+        if(result != VK_SUCCESS) {
+            return result;
+        }
+
+        ++allocator->dedicated_allocation_count;
+        allocator->dedicated_bytes += requirements->size;
+        ++allocator->allocation_count;
+        allocator->bytes_requested += requirements->size;
+        return result;
+    }
+
+    u32 order = 0;
+    while((GpuAllocator::MIN_ALLOCATION << order) < range_size) {
+        ++order;
+    }
+
+    GpuMemoryPool* pool = &allocator->pools[memory_type][static_cast<size_t>(kind)];
+    VkDeviceSize offset = UINT64_MAX;
+    u32 block_index = 0;
+    for(; block_index < pool->block_count; ++block_index) {
+        offset = gpu_memory_block_allocate(pool->blocks[block_index], order);
+        if(offset != UINT64_MAX) {
+            break;
+        }
+    }
+
+    if(offset == UINT64_MAX) {
+        if(pool->block_count >= GpuMemoryPool::MAX_BLOCKS) {
+            result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+            printf("gpu_allocate() failed. [Memory type %u is out of blocks]\n", memory_type);
+            return result;
+        }
+
+        GpuMemoryBlock* block = gpu_memory_block_create(allocator, memory_type);
+        if(!block) {
+            result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+            return result;
+        }
+
+        block_index = pool->block_count;
+        pool->blocks[pool->block_count++] = block;
+        offset = gpu_memory_block_allocate(block, order);
+    }
+
+    GpuMemoryBlock* block = pool->blocks[block_index];
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->mapped = block->mapped ? (u8*)block->mapped + offset : nullptr;
+    allocation->block_index = block_index;
+    allocation->order = order;
+
+    ++allocator->allocation_count;
+    allocator->bytes_requested += requirements->size;
+
+    result = VK_SUCCESS;
+    return result;
+}
+
+void gpu_free(GpuAllocator* allocator, GpuAllocation* allocation) {
+    if(allocation->memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if(allocation->block_index == UINT32_MAX) {
+        vkFreeMemory(allocator->device, allocation->memory, nullptr);
+        --allocator->device_allocation_count;
+        --allocator->dedicated_allocation_count;
+        allocator->dedicated_bytes -= allocation->size;
+        allocator->bytes_allocated -= allocation->size;
+    } else {
+        GpuMemoryPool* pool = &allocator->pools[allocation->memory_type][static_cast<size_t>(allocation->kind)];
+        gpu_memory_block_free(pool->blocks[allocation->block_index], allocation->offset, allocation->order);
+    }
+
+    --allocator->allocation_count;
+    allocator->bytes_requested -= allocation->size;
+    *allocation = {};
+}
+
+GpuMemoryStats gpu_allocator_stats(GpuAllocator* allocator) {
+    GpuMemoryStats stats = {
+        .device_allocations = allocator->device_allocation_count,
+        .dedicated_allocations = allocator->dedicated_allocation_count,
+        .allocations = allocator->allocation_count,
+        .bytes_allocated = allocator->bytes_allocated,
+        .bytes_requested = allocator->bytes_requested
+    };
+
+    VkDeviceSize total_free = 0;
+    VkDeviceSize largest_free_sum = 0;
+    for(u32 memory_type = 0; memory_type < allocator->memory_properties.memoryTypeCount; ++memory_type) {
+        for(size_t kind = 0; kind < static_cast<size_t>(GpuResourceKind::COUNT); ++kind) {
+            GpuMemoryPool* pool = &allocator->pools[memory_type][kind];
+            for(u32 block_index = 0; block_index < pool->block_count; ++block_index) {
+                GpuMemoryBlock* block = pool->blocks[block_index];
+                ++stats.blocks;
+                stats.bytes_reserved += block->reserved;
+                total_free += block->size - block->reserved;
+                largest_free_sum += block->tree[1] ? GpuAllocator::MIN_ALLOCATION << (block->tree[1] - 1) : 0;
+            }
+        }
+    }
+
+    //Dedicated allocations are exactly the requested size
+    stats.bytes_reserved += allocator->dedicated_bytes;
+
+    if(total_free > 0) {
+        stats.fragmentation = 1.0f - static_cast<f32>(largest_free_sum) / static_cast<f32>(total_free);
+    }
+
+    return stats;
+}
+
+void gpu_allocator_print_stats(GpuAllocator* allocator) {
+    GpuMemoryStats stats = gpu_allocator_stats(allocator);
+    printf("GPU memory: %u allocations in %u blocks + %u dedicated (%u/%u vkAllocateMemory)\n", stats.allocations, stats.blocks, stats.dedicated_allocations, stats.device_allocations, allocator->max_allocation_count);
+    printf("            %.2f MB allocated, %.2f MB reserved, %.2f MB requested, %.1f%% fragmented\n", stats.bytes_allocated / (1024.0 * 1024.0), stats.bytes_reserved / (1024.0 * 1024.0), stats.bytes_requested / (1024.0 * 1024.0), stats.fragmentation * 100.0f);
+}
+
+void gpu_allocator_destroy(GpuAllocator* allocator) {
+    for(u32 memory_type = 0; memory_type < allocator->memory_properties.memoryTypeCount; ++memory_type) {
+        for(size_t kind = 0; kind < static_cast<size_t>(GpuResourceKind::COUNT); ++kind) {
+            GpuMemoryPool* pool = &allocator->pools[memory_type][kind];
+            for(u32 block_index = 0; block_index < pool->block_count; ++block_index) {
+                vkFreeMemory(allocator->device, pool->blocks[block_index]->memory, nullptr);
+                free(pool->blocks[block_index]->tree);
+                free(pool->blocks[block_index]);
+            }
+            pool->block_count = 0;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <stdio.h>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "types.h"
+#include "memory.h"
+#include "trace.h"
+
+//Work-stealing thread pool. Every worker owns a deque: it pushes and pops its own jobs at the tail (newest first, still
+//warm in cache) and steals from the head of the others when it runs dry. Threads outside the pool submit to queue 0,
+//which only thieves drain. Jobs must not block on each other except through job_pool_wait()
+using JobFunction = void (*)(void* data);
+
+struct JobCounter {
+    std::atomic<u32> pending = 0;
+};
+
+struct Job {
+    JobFunction function;
+    void* data;
+    JobCounter* counter;
+};
+
+struct JobQueue {
+    static constexpr size_t CAPACITY = 1024;
+
+    std::mutex mutex;
+    Job jobs[CAPACITY];
+    size_t head = 0; //Thieves take from here
+    size_t tail = 0; //The owner pushes and pops here
+};
+
+struct JobPool {
+    static constexpr size_t MAX_WORKERS = 63;
+
+    size_t worker_count = 0;
+    JobQueue queues[MAX_WORKERS + 1]; //queues[0] belongs to submitting threads, worker i owns queues[i + 1]
+    std::thread workers[MAX_WORKERS];
+    std::atomic<size_t> queued = 0; //Jobs sitting in any queue, sleeping workers wait for this to go non-zero
+    std::atomic<bool> running = false;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+};
+
+static thread_local size_t job_queue_index = 0;
+
+bool job_queue_push(JobQueue* queue, Job job) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if(queue->tail - queue->head == JobQueue::CAPACITY) {
+        return false;
+    }
+
+    queue->jobs[queue->tail++ % JobQueue::CAPACITY] = job;
+    return true;
+}
+
+bool job_queue_pop(JobQueue* queue, Job* job) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if(queue->tail == queue->head) {
+        return false;
+    }
+
+    *job = queue->jobs[--queue->tail % JobQueue::CAPACITY];
+    return true;
+}
+
+bool job_queue_steal(JobQueue* queue, Job* job) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if(queue->tail == queue->head) {
+        return false;
+    }
+
+    *job = queue->jobs[queue->head++ % JobQueue::CAPACITY];
+    return true;
+}
+
+void job_run(Job* job) {
+    job->function(job->data);
+    if(job->counter) {
+        job->counter->pending.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+//Own queue first, then every other queue starting after our own so thieves spread out
+bool job_pool_try_run(JobPool* pool) {
+    Job job;
+    size_t queue_count = pool->worker_count + 1;
+    bool found = job_queue_index != 0 && job_queue_pop(&pool->queues[job_queue_index], &job);
+    for(size_t offset = 1; !found && offset <= queue_count; ++offset) {
+        found = job_queue_steal(&pool->queues[(job_queue_index + offset) % queue_count], &job);
+    }
+
+    if(!found) {
+        return false;
+    }
+
+    pool->queued.fetch_sub(1, std::memory_order_relaxed);
+    job_run(&job);
+    return true;
+}
+
+void job_worker_main(JobPool* pool, size_t queue_index) {
+    job_queue_index = queue_index;
+    //A trace buffer is several megabytes, only take one when a trace is being recorded
+    if(global_trace.enabled.load(std::memory_order_acquire)) {
+        trace_register_thread("Job Worker");
+    }
+
+    while(pool->running.load(std::memory_order_acquire)) {
+        if(job_pool_try_run(pool)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(pool->sleep_mutex);
+        pool->wake.wait(lock, [pool] { return pool->queued.load(std::memory_order_acquire) > 0 || !pool->running.load(std::memory_order_acquire); });
+    }
+}
+
+//worker_count 0 picks one worker per hardware thread besides the caller's, the caller helps out in job_pool_wait()
+JobPool* job_pool_create(MemoryArena* arena, size_t worker_count) {
+    if(worker_count == 0) {
+        u32 hardware_threads = std::thread::hardware_concurrency();
+        worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+    }
+    worker_count = worker_count < JobPool::MAX_WORKERS ? worker_count : JobPool::MAX_WORKERS;
+
+    void* memory = memory_arena_allocate(arena, sizeof(JobPool), alignof(JobPool));
+    if(!memory) {
+        printf("job_pool_create() failed. [JobPool object allocation]\n");
+        return nullptr;
+    }
+
+    JobPool* pool = new(memory) JobPool;
+    pool->worker_count = worker_count;
+    pool->running.store(true, std::memory_order_release);
+    for(size_t worker_index = 0; worker_index < worker_count; ++worker_index) {
+        pool->workers[worker_index] = std::thread(job_worker_main, pool, worker_index + 1);
+    }
+
+    return pool;
+}
+
+//Runs the job inline when the queue is full, so submitting never fails
+void job_pool_submit(JobPool* pool, JobFunction function, void* data, JobCounter* counter) {
+    Job job = { .function = function, .data = data, .counter = counter };
+    if(counter) {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //Counted before the push so a thief can never take the count below zero
+    pool->queued.fetch_add(1, std::memory_order_release);
+    if(!job_queue_push(&pool->queues[job_queue_index], job)) {
+        pool->queued.fetch_sub(1, std::memory_order_relaxed);
+        job_run(&job);
+        return;
+    }
+
+    {
+        //Taking the lock orders the increment against a worker that is about to sleep
+        std::lock_guard<std::mutex> lock(pool->sleep_mutex);
+    }
+    pool->wake.notify_one();
+}
+
+//Runs queued jobs on the calling thread until every job counted by counter has finished
+void job_pool_wait(JobPool* pool, JobCounter* counter) {
+    while(counter->pending.load(std::memory_order_acquire) > 0) {
+        if(!job_pool_try_run(pool)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void job_pool_destroy(JobPool* pool) {
+    {
+        std::lock_guard<std::mutex> lock(pool->sleep_mutex);
+        pool->running.store(false, std::memory_order_release);
+    }
+    pool->wake.notify_all();
+
+    for(size_t worker_index = 0; worker_index < pool->worker_count; ++worker_index) {
+        pool->workers[worker_index].join();
+    }
+
+    pool->~JobPool();
+}
\ No newline at end of file
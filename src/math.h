@@ -3,8 +3,42 @@
 #include <cmath>
 #include <initializer_list>
 
+//SSE2 is baseline on x64, AVX is only used when the compiler is allowed to emit it (/arch:AVX, -mavx)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SIMD_SSE
+#include <immintrin.h>
+#if defined(__AVX__)
+#define MATH_SIMD_AVX
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MATH_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 static constexpr f32 PI = 3.14159265358979323846f;
 
+template<typename T, size_t N>
+class Vector;
+
+template<typename T, size_t C, size_t R>
+struct Matrix;
+
+//Generic kernels, the member operators dispatch through these so Vec4/Mat4 can be overloaded with SIMD versions below
+template<typename T, size_t N>
+T vector_dot(const Vector<T, N>& a, const Vector<T, N>& b);
+
+template<typename T, size_t N>
+Vector<T, N> vector_normalize(const Vector<T, N>& vector);
+
+template<typename T, size_t C, size_t R>
+Matrix<T, C, R> matrix_multiply(const Matrix<T, C, R>& a, const Matrix<T, C, R>& b);
+
+template<typename T, size_t C, size_t R>
+Vector<T, C> matrix_transform(const Matrix<T, C, R>& matrix, const Vector<T, R>& vector);
+
+template<typename T, size_t C, size_t R>
+Matrix<T, R, C> matrix_transpose(const Matrix<T, C, R>& matrix);
+
 template<typename T, size_t N>
 class Vector {
   public:
@@ -18,7 +52,7 @@ class Vector {
         }
     }
 
-    T operator[](size_t index) const {
+    const T& operator[](size_t index) const {
         return data[index];
     }
 
@@ -74,28 +108,16 @@ class Vector {
         return result;
     }
 
-    T magnitude() {
-        T magnitude = 0;
-        for(size_t i = 0; i < N; ++i) {
-            magnitude += data[i] * data[i];
-        }
-        return sqrtf(magnitude);
+    T magnitude() const {
+        return sqrtf(vector_dot(*this, *this));
     }
 
-    Vector<T, N> normalize() {
-        Vector<T, N> result = { 0 };
-        for(size_t i = 0; i < N; ++i) {
-            result[i] = data[i] / magnitude();
-        }
-        return result;
+    Vector<T, N> normalize() const {
+        return vector_normalize(*this);
     }
 
     T dot(const Vector<T, N>& other) const {
-        T sum = 0;
-        for(size_t i = 0; i < N; ++i) {
-            sum += data[i] * other[i];
-        }
-        return sum;
+        return vector_dot(*this, other);
     }
 
     T negate() {
@@ -127,33 +149,220 @@ struct Matrix {
         return data[index];
     }
 
-    Matrix<T, C, R> operator*(const T scalar) {
-        for(size_t i = 0; i < C; ++i) {
-            for(size_t j = 0; j < R; ++j) {
-                data[i][j] *= scalar;
-            }
-        }
+    auto operator[](size_t index) const -> const T (&)[R] {
+        return data[index];
     }
 
-    Matrix<T, C, R> operator*(const Matrix<T, C, R>& other) {
+    Matrix<T, C, R> operator*(const T scalar) const {
         Matrix<T, C, R> result = {};
         for(size_t i = 0; i < C; ++i) {
             for(size_t j = 0; j < R; ++j) {
-                T sum = 0;
-                for(size_t k = 0; k < R; ++k) {
-                    sum += data[i][k] * other.data[k][j];
-                }
-                result.data[i][j] = sum;
+                result.data[i][j] = data[i][j] * scalar;
             }
         }
         return result;
     }
+
+    Matrix<T, C, R> operator*(const Matrix<T, C, R>& other) const {
+        return matrix_multiply(*this, other);
+    }
+
+    Vector<T, C> operator*(const Vector<T, R>& vector) const {
+        return matrix_transform(*this, vector);
+    }
+
+    Matrix<T, R, C> transpose() const {
+        return matrix_transpose(*this);
+    }
 };
 
 using Mat2 = Matrix<f32, 2, 2>;
 using Mat3 = Matrix<f32, 3, 3>;
 using Mat4 = Matrix<f32, 4, 4>;
 
+template<typename T, size_t N>
+T vector_dot(const Vector<T, N>& a, const Vector<T, N>& b) {
+    T sum = 0;
+    for(size_t i = 0; i < N; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+template<typename T, size_t N>
+Vector<T, N> vector_normalize(const Vector<T, N>& vector) {
+    T magnitude = sqrtf(vector_dot(vector, vector));
+    Vector<T, N> result = { 0 };
+    for(size_t i = 0; i < N; ++i) {
+        result[i] = vector[i] / magnitude;
+    }
+    return result;
+}
+
+template<typename T, size_t C, size_t R>
+Matrix<T, C, R> matrix_multiply(const Matrix<T, C, R>& a, const Matrix<T, C, R>& b) {
+    Matrix<T, C, R> result = {};
+    for(size_t i = 0; i < C; ++i) {
+        for(size_t j = 0; j < R; ++j) {
+            T sum = 0;
+            for(size_t k = 0; k < R; ++k) {
+                sum += a.data[i][k] * b.data[k][j];
+            }
+            result.data[i][j] = sum;
+        }
+    }
+    return result;
+}
+
+template<typename T, size_t C, size_t R>
+Vector<T, C> matrix_transform(const Matrix<T, C, R>& matrix, const Vector<T, R>& vector) {
+    Vector<T, C> result = { 0 };
+    for(size_t i = 0; i < C; ++i) {
+        T sum = 0;
+        for(size_t k = 0; k < R; ++k) {
+            sum += matrix.data[i][k] * vector[k];
+        }
+        result[i] = sum;
+    }
+    return result;
+}
+
+template<typename T, size_t C, size_t R>
+Matrix<T, R, C> matrix_transpose(const Matrix<T, C, R>& matrix) {
+    Matrix<T, R, C> result = {};
+    for(size_t i = 0; i < C; ++i) {
+        for(size_t j = 0; j < R; ++j) {
+            result.data[j][i] = matrix.data[i][j];
+        }
+    }
+    return result;
+}
+
+//Vec4/Mat4 overloads. Being non-templates they win overload resolution over the generic kernels,
+//call the generic ones explicitly with e.g. matrix_multiply<f32, 4, 4>(a, b)
+//The matrix kernels keep the generic summation order (no FMA contraction) so results are bit identical,
+//the horizontal sums in dot/normalize reassociate and can differ in the last bit
+//Transpose has none, the compiler already does the generic copy loop faster than _MM_TRANSPOSE4_PS
+#if defined(MATH_SIMD_SSE)
+f32 vector_dot(const Vec4& a, const Vec4& b) {
+    __m128 product = _mm_mul_ps(_mm_loadu_ps(&a[0]), _mm_loadu_ps(&b[0]));
+    __m128 shuffled = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(product, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+Vec4 vector_normalize(const Vec4& vector) {
+    __m128 values = _mm_loadu_ps(&vector[0]);
+    __m128 squares = _mm_mul_ps(values, values);
+    squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1)));
+    squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    Vec4 result = { 0 };
+    _mm_storeu_ps(&result[0], _mm_div_ps(values, _mm_sqrt_ps(squares)));
+    return result;
+}
+
+Mat4 matrix_multiply(const Mat4& a, const Mat4& b) {
+    Mat4 result;
+#if defined(MATH_SIMD_AVX)
+    //Two result rows per iteration, each 128-bit half broadcasts its own row's a[i][k]
+    __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.data[0]));
+    __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.data[1]));
+    __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.data[2]));
+    __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.data[3]));
+    for(size_t i = 0; i < 4; i += 2) {
+        __m256 rows = _mm256_loadu_ps(&a.data[i][0]);
+        __m256 sum = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+        _mm256_storeu_ps(&result.data[i][0], sum);
+    }
+#else
+    __m128 b0 = _mm_loadu_ps(b.data[0]);
+    __m128 b1 = _mm_loadu_ps(b.data[1]);
+    __m128 b2 = _mm_loadu_ps(b.data[2]);
+    __m128 b3 = _mm_loadu_ps(b.data[3]);
+    for(size_t i = 0; i < 4; ++i) {
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(a.data[i][0]), b0);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a.data[i][1]), b1));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a.data[i][2]), b2));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a.data[i][3]), b3));
+        _mm_storeu_ps(result.data[i], sum);
+    }
+#endif
+    return result;
+}
+
+Vec4 matrix_transform(const Mat4& matrix, const Vec4& vector) {
+    //Transposing turns the four row dot products into a sum of scaled columns
+    __m128 c0 = _mm_loadu_ps(matrix.data[0]);
+    __m128 c1 = _mm_loadu_ps(matrix.data[1]);
+    __m128 c2 = _mm_loadu_ps(matrix.data[2]);
+    __m128 c3 = _mm_loadu_ps(matrix.data[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    __m128 sum = _mm_mul_ps(c0, _mm_set1_ps(vector[0]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(vector[1])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(vector[2])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(vector[3])));
+
+    Vec4 result = { 0 };
+    _mm_storeu_ps(&result[0], sum);
+    return result;
+}
+
+#elif defined(MATH_SIMD_NEON)
+f32 vector_dot(const Vec4& a, const Vec4& b) {
+    return vaddvq_f32(vmulq_f32(vld1q_f32(&a[0]), vld1q_f32(&b[0])));
+}
+
+Vec4 vector_normalize(const Vec4& vector) {
+    float32x4_t values = vld1q_f32(&vector[0]);
+    float32x4_t magnitude = vdupq_n_f32(sqrtf(vaddvq_f32(vmulq_f32(values, values))));
+
+    Vec4 result = { 0 };
+    vst1q_f32(&result[0], vdivq_f32(values, magnitude));
+    return result;
+}
+
+Mat4 matrix_multiply(const Mat4& a, const Mat4& b) {
+    float32x4_t b0 = vld1q_f32(b.data[0]);
+    float32x4_t b1 = vld1q_f32(b.data[1]);
+    float32x4_t b2 = vld1q_f32(b.data[2]);
+    float32x4_t b3 = vld1q_f32(b.data[3]);
+
+    Mat4 result;
+    for(size_t i = 0; i < 4; ++i) {
+        float32x4_t row = vld1q_f32(a.data[i]);
+        float32x4_t sum = vmulq_laneq_f32(b0, row, 0);
+        sum = vaddq_f32(sum, vmulq_laneq_f32(b1, row, 1));
+        sum = vaddq_f32(sum, vmulq_laneq_f32(b2, row, 2));
+        sum = vaddq_f32(sum, vmulq_laneq_f32(b3, row, 3));
+        vst1q_f32(result.data[i], sum);
+    }
+    return result;
+}
+
+Vec4 matrix_transform(const Mat4& matrix, const Vec4& vector) {
+    //De-interleaving load yields the columns directly
+    float32x4x4_t columns = vld4q_f32(&matrix.data[0][0]);
+    float32x4_t values = vld1q_f32(&vector[0]);
+
+    float32x4_t sum = vmulq_laneq_f32(columns.val[0], values, 0);
+    sum = vaddq_f32(sum, vmulq_laneq_f32(columns.val[1], values, 1));
+    sum = vaddq_f32(sum, vmulq_laneq_f32(columns.val[2], values, 2));
+    sum = vaddq_f32(sum, vmulq_laneq_f32(columns.val[3], values, 3));
+
+    Vec4 result = { 0 };
+    vst1q_f32(&result[0], sum);
+    return result;
+}
+
+#endif
+
 // clang-format off
 static constexpr Mat3 MAT3_IDENTITY = {
     1.0f, 0.0f, 0.0f,
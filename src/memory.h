@@ -4,12 +4,69 @@
 #include "types.h"
 #include <stdio.h>
 
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+size_t KB(size_t kilobytes) {
+    return kilobytes * 1024;
+}
+
+size_t MB(size_t megabytes) {
+    return megabytes * KB(1024);
+}
+
+size_t GB(size_t gigabytes) {
+    return gigabytes * MB(1024);
+}
+
+//The whole size is reserved as address space up front and committed in COMMIT_GRANULARITY steps as used grows,
+//so a large arena only costs the physical memory that has actually been handed out
 struct MemoryArena {
-    size_t size = 0;
+    static constexpr size_t DEFAULT_ALIGNMENT = 16;
+    static constexpr size_t COMMIT_GRANULARITY = 64 * 1024;
+
+    size_t size = 0; //Reserved
+    size_t committed = 0;
     size_t used = 0;
     void* memory = nullptr;
 };
 
+struct MemoryArenaMarker {
+    size_t used = 0;
+};
+
+void* memory_reserve(size_t bytes) {
+#if defined(_WIN32)
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* memory = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+#endif
+}
+
+bool memory_commit(void* memory, size_t bytes) {
+#if defined(_WIN32)
+    return VirtualAlloc(memory, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return mprotect(memory, bytes, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+void memory_release(void* memory, size_t bytes) {
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, bytes);
+#endif
+}
+
 MemoryArena* memory_arena_create(size_t bytes) {
     MemoryArena* arena = (MemoryArena*)malloc(sizeof(MemoryArena));
     if(!arena) {
@@ -17,43 +74,80 @@ MemoryArena* memory_arena_create(size_t bytes) {
         return nullptr;
     }
 
-    arena->memory = malloc(bytes);
+    bytes = (bytes + MemoryArena::COMMIT_GRANULARITY - 1) & ~(MemoryArena::COMMIT_GRANULARITY - 1);
+
+    arena->memory = memory_reserve(bytes);
     if(!arena->memory) {
-        printf("malloc() failed. [MemoryArena memory allocation]\n");
+        printf("memory_reserve() failed. [MemoryArena %zd bytes]\n", bytes);
         free(arena);
         return nullptr;
     }
 
     arena->size = bytes;
+    arena->committed = 0;
     arena->used = 0;
 
     return arena;
 }
 
-void* memory_arena_allocate(MemoryArena* arena, size_t bytes) {
-    if(arena->used + bytes > arena->size) {
-        printf("memory_arena_allocate() failed. [Not enough space to allocate %zd bytes]", bytes);
+//Alignment must be a power of two
+void* memory_arena_allocate(MemoryArena* arena, size_t bytes, size_t alignment = MemoryArena::DEFAULT_ALIGNMENT) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(arena->memory);
+    size_t offset = ((base + arena->used + alignment - 1) & ~(alignment - 1)) - base;
+    if(offset + bytes > arena->size) {
+        printf("memory_arena_allocate() failed. [Not enough space to allocate %zd bytes]\n", bytes);
         return nullptr;
     }
 
-    void* memory = (u8*)arena->memory + arena->used;
-    arena->used += bytes;
-    return memory;
+    if(offset + bytes > arena->committed) {
+        size_t commit_end = (offset + bytes + MemoryArena::COMMIT_GRANULARITY - 1) & ~(MemoryArena::COMMIT_GRANULARITY - 1);
+        if(!memory_commit((u8*)arena->memory + arena->committed, commit_end - arena->committed)) {
+            printf("memory_commit() failed. [%zd bytes]\n", commit_end - arena->committed);
+            return nullptr;
+        }
+        arena->committed = commit_end;
+    }
+
+    arena->used = offset + bytes;
+    return (u8*)arena->memory + offset;
 }
 
-void memory_arena_free(MemoryArena* arena) {
-    free(arena->memory);
-    free(arena);
+template<typename T>
+T* push_array(MemoryArena* arena, size_t count, size_t alignment = alignof(T)) {
+    return (T*)memory_arena_allocate(arena, sizeof(T) * count, alignment);
 }
 
-size_t KB(size_t kilobytes) {
-    return kilobytes * 1024;
+template<typename T>
+T* push_struct(MemoryArena* arena) {
+    return push_array<T>(arena, 1);
 }
 
-size_t MB(size_t megabytes) {
-    return megabytes * KB(1024);
+[[nodiscard]] MemoryArenaMarker memory_arena_marker(MemoryArena* arena) {
+    return { .used = arena->used };
 }
 
-size_t GB(size_t gigabytes) {
-    return gigabytes * MB(1024);
-}
\ No newline at end of file
+//Releases everything allocated since the marker was taken. Committed pages stay committed for reuse
+void memory_arena_restore(MemoryArena* arena, MemoryArenaMarker marker) {
+    arena->used = marker.used;
+}
+
+void memory_arena_reset(MemoryArena* arena) {
+    arena->used = 0;
+}
+
+void memory_arena_free(MemoryArena* arena) {
+    memory_release(arena->memory, arena->size);
+    free(arena);
+}
+
+//Rolls the arena back to where it was when the scope was opened
+struct TempScope {
+    MemoryArena* arena;
+    MemoryArenaMarker marker;
+
+    explicit TempScope(MemoryArena* arena) : arena(arena), marker(memory_arena_marker(arena)) {}
+    ~TempScope() { memory_arena_restore(arena, marker); }
+
+    TempScope(const TempScope&) = delete;
+    TempScope& operator=(const TempScope&) = delete;
+};
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "platform_linux_headless.h"
+#include "vulkan_renderer.cpp"
+
+//Renders a fixed number of frames into offscreen targets with no window or surface. Meant for CI and software ICDs (lavapipe)
+//Usage: v [--frames N] [--width W] [--height H] [--frames-in-flight N] [--workers N] [--pack FILE] [--hot-reload 1] [--trace FILE]
+int main(int argc, char** argv) {
+    HeadlessOptions options = {};
+    if(!parse_options(argc, argv, &options)) {
+        printf("Usage: %s [--frames N] [--width W] [--height H] [--frames-in-flight 1-%zd] [--workers N] [--pack FILE] [--hot-reload 1] [--trace FILE]\n", argv[0], Swapchain::MAX_FRAMES_IN_FLIGHT);
+        return 1;
+    }
+
+    if(options.trace_path && !trace_start(options.trace_path)) {
+        printf("trace_start() failed.\n");
+        return 1;
+    }
+
+    ApplicationLinuxHeadless application = {
+        .resolution = options.resolution,
+        .renderer = {}
+    };
+
+    VulkanRendererInitInfo vulkan_renderer_init_info = {
+        .renderer = &application.renderer,
+        .application_name = "Vulkan Test",
+        .offscreen = true,
+        .offscreen_resolution = application.resolution,
+        .frame_pacing = options.frame_pacing,
+        .worker_count = options.worker_count,
+        .asset_pack_path = options.asset_pack_path,
+        .shader_hot_reload = options.shader_hot_reload
+    };
+
+    VkResult result = create_renderer(&vulkan_renderer_init_info);
+    if(result != VK_SUCCESS) {
+        printf("Renderer creation failed: %s\n", string_VkResult(result));
+        //Frees what was created before the failure and keeps the trace leading up to it
+        destroy_renderer(&application.renderer);
+        trace_write();
+    } else {
+        printf("Renderer created. [Offscreen %dx%d, %zd frames, %zd in flight]\n", application.resolution.width, application.resolution.height, options.frames, application.renderer.swapchain.frames_in_flight);
+        application.initialized = true;
+    }
+
+    if(application.initialized) {
+        application.renderer.fixed_frame_mode = true;
+        application.renderer.frames_to_render = options.frames;
+
+        Time::Stamp start_time = Time::Clock::now();
+        Time::Duration accumulator = Time::Duration::zero();
+        Time::Duration delta_time = Time::Milliseconds(10);
+
+        application.session = {
+            .start = start_time,
+            .fps = {
+                .measurement_start_time = start_time }
+        };
+        application.renderer.profiler = &application.session.profiler;
+
+        while(application.renderer.should_render) {
+            Time::Stamp now = Time::Clock::now();
+            Time::Duration frame_time = now - start_time;
+
+            start_time = now;
+            accumulator += frame_time;
+
+            while(accumulator >= delta_time) {
+                application_update(&application, delta_time);
+                accumulator -= delta_time;
+            }
+
+            application_render(&application, delta_time);
+        }
+
+        destroy_renderer(&application.renderer);
+        trace_write();
+
+        session_debug_print(&application.session);
+        printf("\n");
+    }
+
+    return application.initialized ? 0 : 1;
+}
+
+bool parse_options(i32 argc, char** argv, HeadlessOptions* options) {
+    for(i32 argument_index = 1; argument_index < argc; ++argument_index) {
+        if(argument_index + 1 >= argc) {
+            return false;
+        }
+
+        const char* option = argv[argument_index];
+        const char* argument = argv[++argument_index];
+        if(strcmp(option, "--trace") == 0) {
+            options->trace_path = argument;
+            continue;
+        }
+        if(strcmp(option, "--pack") == 0) {
+            options->asset_pack_path = argument;
+            continue;
+        }
+
+        u64 value = strtoull(argument, nullptr, 10);
+        if(value == 0) {
+            return false;
+        }
+
+        if(strcmp(option, "--frames") == 0) {
+            options->frames = value;
+        } else if(strcmp(option, "--width") == 0) {
+            options->resolution.width = static_cast<u32>(value);
+        } else if(strcmp(option, "--height") == 0) {
+            options->resolution.height = static_cast<u32>(value);
+        } else if(strcmp(option, "--frames-in-flight") == 0 && value <= Swapchain::MAX_FRAMES_IN_FLIGHT) {
+            options->frame_pacing.frames_in_flight = value;
+        } else if(strcmp(option, "--workers") == 0) {
+            options->worker_count = value;
+        } else if(strcmp(option, "--hot-reload") == 0) {
+            options->shader_hot_reload = true;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool platform_list_directory(const char* directory, DirectoryListing* listing) {
+    DIR* handle = opendir(directory);
+    if(!handle) {
+        return false;
+    }
+
+    listing->count = 0;
+    while(dirent* entry = readdir(handle)) {
+        if(entry->d_type == DT_DIR) {
+            continue;
+        }
+
+        if(listing->count >= DirectoryListing::MAX_ENTRIES) {
+            printf("platform_list_directory() truncated. [More than %zd files in %s]\n", DirectoryListing::MAX_ENTRIES, directory);
+            break;
+        }
+
+        strcpy_s(listing->entries[listing->count++], MAX_PATH, entry->d_name);
+    }
+    closedir(handle);
+
+    return true;
+}
+
+bool platform_watch_directory(const char* directory, DirectoryWatch* watch) {
+    i32 descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(descriptor < 0) {
+        printf("inotify_init1() failed.\n");
+        return false;
+    }
+
+    //Editors either rewrite the file in place or write a temporary and rename it over the original
+    if(inotify_add_watch(descriptor, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        printf("inotify_add_watch() failed. [%s]\n", directory);
+        close(descriptor);
+        return false;
+    }
+
+    i32* state = (i32*)malloc(sizeof(i32));
+    if(!state) {
+        close(descriptor);
+        return false;
+    }
+    *state = descriptor;
+    watch->state = state;
+
+    return true;
+}
+
+bool platform_poll_directory_watch(DirectoryWatch* watch, DirectoryListing* changed) {
+    changed->count = 0;
+    if(!watch->state) {
+        return false;
+    }
+
+    i32 descriptor = *(i32*)watch->state;
+    alignas(inotify_event) char buffer[4096];
+    while(true) {
+        ssize_t bytes = read(descriptor, buffer, sizeof(buffer));
+        if(bytes <= 0) {
+            //EAGAIN, every queued event has been read
+            return bytes == 0 || errno == EAGAIN;
+        }
+
+        for(char* cursor = buffer; cursor < buffer + bytes;) {
+            inotify_event* event = (inotify_event*)cursor;
+            cursor += sizeof(inotify_event) + event->len;
+            if(event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+
+            bool seen = false;
+            for(size_t index = 0; index < changed->count && !seen; ++index) {
+                seen = strcmp(changed->entries[index], event->name) == 0;
+            }
+            if(!seen && changed->count < DirectoryListing::MAX_ENTRIES) {
+                strcpy_s(changed->entries[changed->count++], MAX_PATH, event->name);
+            }
+        }
+    }
+}
+
+void platform_unwatch_directory(DirectoryWatch* watch) {
+    if(watch->state) {
+        close(*(i32*)watch->state);
+        free(watch->state);
+        watch->state = nullptr;
+    }
+}
+
+void application_update(ApplicationLinuxHeadless* application, Time::Duration delta_time) {
+    session_update(&application->session, delta_time);
+    update_sprites(&application->renderer);
+}
+
+void application_render(ApplicationLinuxHeadless* application, Time::Duration delta_time) {
+    if(application->renderer.fixed_frame_mode) {
+        if(--application->renderer.frames_to_render == 0) {
+            application->renderer.should_render = false;
+        }
+    }
+
+    session_render(&application->session);
+
+    VkResult result = draw_frame(&application->renderer, delta_time);
+    if(result != VK_SUCCESS) {
+        printf("draw_frame() failed: %s\n", string_VkResult(result));
+        application->renderer.should_render = false;
+    }
+}
\ No newline at end of file
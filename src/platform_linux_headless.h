@@ -0,0 +1,64 @@
+#pragma once
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+
+//The renderer is written against the MSVC CRT, these fill in the pieces glibc doesn't provide
+#if !defined(MAX_PATH)
+#define MAX_PATH 260
+#endif
+
+i32 strcpy_s(char* destination, size_t destination_size, const char* source) {
+    if(snprintf(destination, destination_size, "%s", source) >= static_cast<i32>(destination_size)) {
+        return -1;
+    }
+    return 0;
+}
+
+i32 strcat_s(char* destination, size_t destination_size, const char* source) {
+    size_t length = strnlen(destination, destination_size);
+    if(snprintf(destination + length, destination_size - length, "%s", source) >= static_cast<i32>(destination_size - length)) {
+        return -1;
+    }
+    return 0;
+}
+
+char* strtok_s(char* string, const char* delimiters, char** context) {
+    return strtok_r(string, delimiters, context);
+}
+
+i32 memcpy_s(void* destination, size_t destination_size, const void* source, size_t count) {
+    if(count > destination_size) {
+        return -1;
+    }
+    memcpy(destination, source, count);
+    return 0;
+}
+
+#include "platform_shared.h"
+#include "vulkan_renderer.h"
+
+struct ApplicationLinuxHeadless {
+    Resolution resolution = {};
+    VulkanRenderer renderer = {};
+    bool initialized = false;
+    Session session;
+};
+
+struct HeadlessOptions {
+    static constexpr size_t DEFAULT_FRAMES = 1000;
+
+    size_t frames = DEFAULT_FRAMES;
+    Resolution resolution = Resolutions::DEFAULT[2];
+    FramePacingConfig frame_pacing = {};
+    const char* trace_path = nullptr; //Chrome trace JSON written at exit when set
+    size_t worker_count = 0; //Asset decoding threads, 0 for one per hardware thread
+    const char* asset_pack_path = "assets.pak";
+    bool shader_hot_reload = false;
+};
+
+bool parse_options(i32 argc, char** argv, HeadlessOptions* options);
+void application_update(ApplicationLinuxHeadless* application, Time::Duration delta_time);
+void application_render(ApplicationLinuxHeadless* application, Time::Duration delta_time);
\ No newline at end of file
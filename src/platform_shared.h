@@ -23,4 +23,23 @@ struct WindowDescription {
     static constexpr size_t MAX_WINDOW_TITLE_SIZE = 32;
     char title[MAX_WINDOW_TITLE_SIZE];
     Resolution resolution = {};
-};
\ No newline at end of file
+};
+
+struct DirectoryListing {
+    static constexpr size_t MAX_ENTRIES = 64;
+
+    size_t count = 0;
+    char entries[MAX_ENTRIES][MAX_PATH];
+};
+
+//Notifications for files written or moved into a directory, not its subdirectories
+struct DirectoryWatch {
+    void* state = nullptr; //Owned by the platform layer
+};
+
+//Implemented by each platform layer. Fills listing with the regular file names in directory (no "." or "..")
+bool platform_list_directory(const char* directory, DirectoryListing* listing);
+bool platform_watch_directory(const char* directory, DirectoryWatch* watch);
+//Never blocks. Fills changed with the names of the files that changed since the last call, each name once
+bool platform_poll_directory_watch(DirectoryWatch* watch, DirectoryListing* changed);
+void platform_unwatch_directory(DirectoryWatch* watch);
\ No newline at end of file
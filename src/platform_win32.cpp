@@ -17,16 +17,24 @@ int WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmd_line, int sho
     window_create(&application.window);
     console_create();
 
+    //v.exe --trace FILE records a Chrome trace of the run
+    if(strncmp(cmd_line, "--trace ", 8) == 0 && !trace_start(cmd_line + 8)) {
+        printf("trace_start() failed.\n");
+    }
+
     VulkanRendererInitInfo vulkan_renderer_init_info = {
         .renderer = &application.renderer,
         .application_name = application.window.description.title,
         .window_handle = application.window.handle,
-        .window_instance = application.window.instance
+        .window_instance = application.window.instance,
+        .shader_hot_reload = true
     };
 
     VkResult result = create_renderer(&vulkan_renderer_init_info);
     if(result != VK_SUCCESS) {
         printf("Renderer creation failed: %s\n", string_VkResult(result));
+        destroy_renderer(&application.renderer);
+        trace_write();
     } else {
         printf("Renderer created.\n");
         application.initialized = true;
@@ -44,6 +52,7 @@ int WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmd_line, int sho
             .fps = {
                 .measurement_start_time = start_time }
         };
+        application.renderer.profiler = &application.session.profiler;
 
         ShowWindow(application.window.handle, show_cmd_line);
 
@@ -56,6 +65,9 @@ int WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmd_line, int sho
             // } else {
             //     break;
             // }
+            //Sleeps off the time the last frame spent blocked before any input is read, when the latency wait is on
+            frame_pacing_wait(&application.renderer);
+
             MSG win32_message;
             while(PeekMessage(&win32_message, application.window.handle, 0, 0, PM_REMOVE)) {
                 TranslateMessage(&win32_message);
@@ -76,15 +88,14 @@ int WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmd_line, int sho
             application_render(&application, delta_time);
         }
 
-        vkDeviceWaitIdle(application.renderer.devices.logical.device);
+        destroy_renderer(&application.renderer);
+        trace_write();
     }
 
     session_debug_print(&application.session);
 
     while(getchar()) {};
 
-    vkFreeMemory(application.renderer.devices.logical.device, application.renderer.graphics_pipeline.vertex_buffer.device_memory, nullptr);
-
     return 0;
 }
 
@@ -137,6 +148,32 @@ LRESULT window_callback(HWND handle, UINT message, WPARAM wparam, LPARAM lparam)
                         printf("resize() failed.\nError: %s", string_VkResult(vkresult));
                     }
                 }
+                if(strcmp(keyName, "P") == 0) {
+                    //Cycles FIFO, MAILBOX, IMMEDIATE and FIFO_RELAXED, rebuilding just the swapchain
+                    static constexpr VkPresentModeKHR PRESENT_MODES[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+                    static constexpr size_t PRESENT_MODE_COUNT = sizeof(PRESENT_MODES) / sizeof(PRESENT_MODES[0]);
+
+                    FramePacingConfig frame_pacing = application->renderer.frame_pacing;
+                    size_t present_mode_index = 0;
+                    while(present_mode_index < PRESENT_MODE_COUNT && PRESENT_MODES[present_mode_index] != frame_pacing.present_mode) {
+                        ++present_mode_index;
+                    }
+                    frame_pacing.present_mode = PRESENT_MODES[(present_mode_index + 1) % PRESENT_MODE_COUNT];
+                    VkResult vkresult = apply_frame_pacing(&application->renderer, &frame_pacing);
+                    if(vkresult != VK_SUCCESS) {
+                        printf("apply_frame_pacing() failed.\nError: %s", string_VkResult(vkresult));
+                    }
+                }
+                if(strcmp(keyName, "L") == 0) {
+                    //Toggles between the low latency setup and the default throughput one
+                    FramePacingConfig frame_pacing = application->renderer.frame_pacing;
+                    frame_pacing.latency_wait = !frame_pacing.latency_wait;
+                    frame_pacing.frames_in_flight = frame_pacing.latency_wait ? 1 : FramePacingConfig{}.frames_in_flight;
+                    VkResult vkresult = apply_frame_pacing(&application->renderer, &frame_pacing);
+                    if(vkresult != VK_SUCCESS) {
+                        printf("apply_frame_pacing() failed.\nError: %s", string_VkResult(vkresult));
+                    }
+                }
                 if(strcmp(keyName, "F") == 0) {
                     if(application->session.display_fps) {
                         SetWindowTextA(handle, application->window.description.title);
@@ -202,6 +239,7 @@ void console_create() {
 
 void application_update(ApplicationWin32Vulkan* application, Time::Duration delta_time) {
     session_update(&application->session, delta_time);
+    update_sprites(&application->renderer);
 }
 
 void application_render(ApplicationWin32Vulkan* application, Time::Duration delta_time) {
@@ -215,8 +253,9 @@ void application_render(ApplicationWin32Vulkan* application, Time::Duration delt
         session_render(&application->session);
 
         if(application->session.display_fps) {
-            char fps[16];
-            sprintf_s(fps, "FPS: %.2f", application->session.fps.last_measurement);
+            char fps[64];
+            FrameTimeStats frame_stats = profiler_frame_stats(&application->session.profiler);
+            sprintf_s(fps, "FPS: %.2f  p99: %.2f ms", application->session.fps.last_measurement, frame_stats.p99_ms);
             //SetConsoleTitleA(title);
             SetWindowTextA(application->window.handle, fps);
         }
@@ -226,4 +265,124 @@ void application_render(ApplicationWin32Vulkan* application, Time::Duration delt
             printf("draw_frame() failed: %s\n", string_VkResult(result));
         }
     }
+}
+
+bool platform_list_directory(const char* directory, DirectoryListing* listing) {
+    char search[MAX_PATH];
+    strcpy_s(search, MAX_PATH, directory);
+    strcat_s(search, MAX_PATH, "*");
+
+    WIN32_FIND_DATAA file_data;
+    HANDLE find = FindFirstFileA(search, &file_data);
+    if(find == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    listing->count = 0;
+    do {
+        if(strcmp(file_data.cFileName, ".") == 0 || strcmp(file_data.cFileName, "..") == 0 || (file_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            continue;
+        }
+
+        if(listing->count >= DirectoryListing::MAX_ENTRIES) {
+            printf("platform_list_directory() truncated. [More than %zd files in %s]\n", DirectoryListing::MAX_ENTRIES, directory);
+            break;
+        }
+
+        strcpy_s(listing->entries[listing->count++], MAX_PATH, file_data.cFileName);
+    } while(FindNextFileA(find, &file_data) != 0);
+    FindClose(find);
+
+    return true;
+}
+
+struct DirectoryWatchWin32 {
+    HANDLE directory;
+    OVERLAPPED overlapped;
+    alignas(DWORD) u8 buffer[4096];
+};
+
+//Queues the next overlapped read, whatever changes after this lands in buffer
+bool directory_watch_read(DirectoryWatchWin32* state) {
+    DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+    return ReadDirectoryChangesW(state->directory, state->buffer, sizeof(state->buffer), FALSE, filter, nullptr, &state->overlapped, nullptr) != 0;
+}
+
+bool platform_watch_directory(const char* directory, DirectoryWatch* watch) {
+    DirectoryWatchWin32* state = (DirectoryWatchWin32*)calloc(1, sizeof(DirectoryWatchWin32));
+    if(!state) {
+        return false;
+    }
+
+    state->directory = CreateFileA(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    state->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    if(state->directory == INVALID_HANDLE_VALUE || !state->overlapped.hEvent || !directory_watch_read(state)) {
+        printf("ReadDirectoryChangesW() failed. [%s]\n", directory);
+        if(state->overlapped.hEvent) {
+            CloseHandle(state->overlapped.hEvent);
+        }
+        if(state->directory != INVALID_HANDLE_VALUE) {
+            CloseHandle(state->directory);
+        }
+        free(state);
+        return false;
+    }
+
+    watch->state = state;
+    return true;
+}
+
+bool platform_poll_directory_watch(DirectoryWatch* watch, DirectoryListing* changed) {
+    changed->count = 0;
+    DirectoryWatchWin32* state = (DirectoryWatchWin32*)watch->state;
+    if(!state) {
+        return false;
+    }
+
+    DWORD bytes = 0;
+    if(!GetOverlappedResult(state->directory, &state->overlapped, &bytes, FALSE)) {
+        return GetLastError() == ERROR_IO_INCOMPLETE;
+    }
+
+    //0 bytes means the buffer overflowed and the changes were dropped
+    for(size_t offset = 0; bytes > 0;) {
+        FILE_NOTIFY_INFORMATION* information = (FILE_NOTIFY_INFORMATION*)(state->buffer + offset);
+        bool written = information->Action == FILE_ACTION_MODIFIED || information->Action == FILE_ACTION_ADDED || information->Action == FILE_ACTION_RENAMED_NEW_NAME;
+
+        char name[MAX_PATH] = "";
+        i32 length = WideCharToMultiByte(CP_UTF8, 0, information->FileName, information->FileNameLength / sizeof(WCHAR), name, MAX_PATH - 1, nullptr, nullptr);
+        name[length > 0 ? length : 0] = '\0';
+
+        bool seen = !written || length <= 0;
+        for(size_t index = 0; index < changed->count && !seen; ++index) {
+            seen = strcmp(changed->entries[index], name) == 0;
+        }
+        if(!seen && changed->count < DirectoryListing::MAX_ENTRIES) {
+            strcpy_s(changed->entries[changed->count++], MAX_PATH, name);
+        }
+
+        if(information->NextEntryOffset == 0) {
+            break;
+        }
+        offset += information->NextEntryOffset;
+    }
+
+    ResetEvent(state->overlapped.hEvent);
+    return directory_watch_read(state);
+}
+
+void platform_unwatch_directory(DirectoryWatch* watch) {
+    DirectoryWatchWin32* state = (DirectoryWatchWin32*)watch->state;
+    if(!state) {
+        return;
+    }
+
+    //The cancelled read still owns the buffer until it completes
+    DWORD bytes = 0;
+    CancelIo(state->directory);
+    GetOverlappedResult(state->directory, &state->overlapped, &bytes, TRUE);
+    CloseHandle(state->overlapped.hEvent);
+    CloseHandle(state->directory);
+    free(state);
+    watch->state = nullptr;
 }
\ No newline at end of file
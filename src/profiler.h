@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stdio.h>
+#include <algorithm>
+#include "types.h"
+#include "time.h"
+#include "trace.h"
+
+//CPU-side stages of draw_frame(), timed every frame
+enum class ProfileZone : size_t {
+    FRAME_WAIT,
+    ACQUIRE,
+    UNIFORM_UPDATE,
+    RECORD,
+    SUBMIT,
+    PRESENT,
+    COUNT
+};
+
+static constexpr size_t PROFILE_ZONE_COUNT = static_cast<size_t>(ProfileZone::COUNT);
+static constexpr const char* PROFILE_ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+    "Frame Wait",
+    "Acquire",
+    "Uniform Update",
+    "Record",
+    "Submit",
+    "Present"
+};
+
+//GPU work bracketed by timestamp queries. FRAME spans the whole command buffer, passes nest inside it
+enum class GpuZone : size_t {
+    FRAME,
+    SPRITE_PASS,
+    COUNT
+};
+
+static constexpr size_t GPU_ZONE_COUNT = static_cast<size_t>(GpuZone::COUNT);
+static constexpr const char* GPU_ZONE_NAMES[GPU_ZONE_COUNT] = {
+    "GPU Frame",
+    "GPU Sprite Pass"
+};
+
+//The most recent CAPACITY samples, oldest overwritten first
+struct FrameTimeRing {
+    static constexpr size_t CAPACITY = 1024;
+
+    Time::Duration samples[CAPACITY] = {};
+    size_t head = 0;
+    size_t count = 0;
+};
+
+struct FrameTimeStats {
+    size_t samples = 0;
+    f64 mean_ms = 0.0;
+    f64 p50_ms = 0.0;
+    f64 p95_ms = 0.0;
+    f64 p99_ms = 0.0;
+    f64 max_ms = 0.0;
+};
+
+struct Profiler {
+    FrameTimeRing frames = {};
+    FrameTimeRing zones[PROFILE_ZONE_COUNT] = {};
+    FrameTimeRing gpu_zones[GPU_ZONE_COUNT] = {}; //Pushed a frame or two late, once the frame's submit has completed
+    Time::Stamp zone_start[PROFILE_ZONE_COUNT] = {};
+    Time::Stamp last_frame = {};
+    bool frame_started = false;
+};
+
+void frame_time_ring_push(FrameTimeRing* ring, Time::Duration sample) {
+    ring->samples[ring->head] = sample;
+    ring->head = (ring->head + 1) % FrameTimeRing::CAPACITY;
+    if(ring->count < FrameTimeRing::CAPACITY) {
+        ++ring->count;
+    }
+}
+
+f64 duration_ms(Time::Duration duration) {
+    return static_cast<f64>(duration.count()) / 1'000'000.0;
+}
+
+//Nearest-rank percentiles over whatever the ring currently holds
+[[nodiscard]] FrameTimeStats frame_time_ring_stats(FrameTimeRing* ring) {
+    FrameTimeStats stats = {};
+    if(ring->count == 0) {
+        return stats;
+    }
+
+    Time::Duration sorted[FrameTimeRing::CAPACITY];
+    std::copy(ring->samples, ring->samples + ring->count, sorted);
+    std::sort(sorted, sorted + ring->count);
+
+    Time::Duration total = Time::Duration::zero();
+    for(size_t i = 0; i < ring->count; ++i) {
+        total += sorted[i];
+    }
+
+    auto percentile = [&](size_t percent) {
+        size_t rank = (percent * ring->count + 99) / 100;
+        return duration_ms(sorted[rank > 0 ? rank - 1 : 0]);
+    };
+
+    stats.samples = ring->count;
+    stats.mean_ms = duration_ms(total) / static_cast<f64>(ring->count);
+    stats.p50_ms = percentile(50);
+    stats.p95_ms = percentile(95);
+    stats.p99_ms = percentile(99);
+    stats.max_ms = duration_ms(sorted[ring->count - 1]);
+
+    return stats;
+}
+
+//Called once per rendered frame, records the time since the previous call
+void profiler_frame(Profiler* profiler) {
+    Time::Stamp now = Time::Clock::now();
+    if(profiler->frame_started) {
+        frame_time_ring_push(&profiler->frames, now - profiler->last_frame);
+    }
+    profiler->last_frame = now;
+    profiler->frame_started = true;
+}
+
+//Zone calls accept a null profiler so callers don't have to check whether one is attached. Zones are traced either way
+void profiler_zone_begin(Profiler* profiler, ProfileZone zone) {
+    trace_begin(PROFILE_ZONE_NAMES[static_cast<size_t>(zone)]);
+    if(profiler) {
+        profiler->zone_start[static_cast<size_t>(zone)] = Time::Clock::now();
+    }
+}
+
+void profiler_zone_end(Profiler* profiler, ProfileZone zone) {
+    trace_end(PROFILE_ZONE_NAMES[static_cast<size_t>(zone)]);
+    if(profiler) {
+        size_t zone_index = static_cast<size_t>(zone);
+        frame_time_ring_push(&profiler->zones[zone_index], Time::Clock::now() - profiler->zone_start[zone_index]);
+    }
+}
+
+void profiler_gpu_zone_record(Profiler* profiler, GpuZone zone, Time::Duration duration) {
+    if(profiler) {
+        frame_time_ring_push(&profiler->gpu_zones[static_cast<size_t>(zone)], duration);
+    }
+}
+
+[[nodiscard]] FrameTimeStats profiler_frame_stats(Profiler* profiler) {
+    return frame_time_ring_stats(&profiler->frames);
+}
+
+[[nodiscard]] FrameTimeStats profiler_zone_stats(Profiler* profiler, ProfileZone zone) {
+    return frame_time_ring_stats(&profiler->zones[static_cast<size_t>(zone)]);
+}
+
+[[nodiscard]] FrameTimeStats profiler_gpu_zone_stats(Profiler* profiler, GpuZone zone) {
+    return frame_time_ring_stats(&profiler->gpu_zones[static_cast<size_t>(zone)]);
+}
+
+void profiler_print_stats(const char* name, FrameTimeStats* stats) {
+    printf("%-16s %8.3f %8.3f %8.3f %8.3f %8.3f  %zd\n", name, stats->mean_ms, stats->p50_ms, stats->p95_ms, stats->p99_ms, stats->max_ms, stats->samples);
+}
+
+void profiler_print_report(Profiler* profiler) {
+    printf("%-16s %8s %8s %8s %8s %8s  %s\n", "Frame Times (ms)", "Mean", "p50", "p95", "p99", "Max", "Samples");
+
+    FrameTimeStats frame_stats = profiler_frame_stats(profiler);
+    profiler_print_stats("Frame", &frame_stats);
+
+    for(size_t zone_index = 0; zone_index < PROFILE_ZONE_COUNT; ++zone_index) {
+        FrameTimeStats zone_stats = profiler_zone_stats(profiler, ProfileZone(zone_index));
+        if(zone_stats.samples > 0) {
+            profiler_print_stats(PROFILE_ZONE_NAMES[zone_index], &zone_stats);
+        }
+    }
+
+    for(size_t zone_index = 0; zone_index < GPU_ZONE_COUNT; ++zone_index) {
+        FrameTimeStats zone_stats = profiler_gpu_zone_stats(profiler, GpuZone(zone_index));
+        if(zone_stats.samples > 0) {
+            profiler_print_stats(GPU_ZONE_NAMES[zone_index], &zone_stats);
+        }
+    }
+
+    //A GPU that is busy for nearly the whole frame is what's holding the frame rate, otherwise the CPU is
+    FrameTimeStats gpu_stats = profiler_gpu_zone_stats(profiler, GpuZone::FRAME);
+    if(gpu_stats.samples > 0 && frame_stats.p50_ms > 0.0) {
+        f64 gpu_busy = gpu_stats.p50_ms / frame_stats.p50_ms;
+        printf("GPU busy %.0f%% of the median frame, likely %s-bound\n", gpu_busy * 100.0, gpu_busy >= 0.9 ? "GPU" : "CPU");
+    }
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "types.h"
 #include "time.h"
+#include "profiler.h"
 
 struct FPS {
     static constexpr Time::Duration MEASUREMENT_INTERVAL = Time::Milliseconds(300);
@@ -17,6 +18,7 @@ struct Session {
     u64 ticks = 0;
     Time::Stamp start = Time::Clock::now();
     FPS fps = {};
+    Profiler profiler = {};
     bool display_fps = false;
 };
 
@@ -28,8 +30,6 @@ void session_update(Session* session, Time::Duration delta_time) {
     ++session->ticks;
     timer_accumulate(&session->fps.timer, delta_time);
 
-    new FPS();
-
     if(timer_ready(&session->fps.timer)) {
         Time::Stamp now = Time::Clock::now();
         f64 measurement_delta = std::chrono::duration_cast<std::chrono::duration<f64, std::chrono::seconds::period>>(now - session->fps.measurement_start_time).count();
@@ -43,6 +43,7 @@ void session_update(Session* session, Time::Duration delta_time) {
 void session_render(Session* session) {
     ++session->frames;
     ++session->fps.frames;
+    profiler_frame(&session->profiler);
 }
 
 void session_debug_print(Session* session) {
@@ -55,5 +56,7 @@ void session_debug_print(Session* session) {
 
     printf("Elapsed Time: %02d:%02d:%05.2f\n", hours, minutes, seconds);
     printf("Total Frames: %zd\n", session->frames);
-    printf("Average FPS: %00007.2f", static_cast<f64>(session->frames / elapsed_time_seconds));
+    printf("Average FPS: %00007.2f\n\n", static_cast<f64>(session->frames / elapsed_time_seconds));
+
+    profiler_print_report(&session->profiler);
 }
\ No newline at end of file
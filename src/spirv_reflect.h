@@ -0,0 +1,540 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "types.h"
+
+//Reads the interface of SPIR-V modules: descriptor bindings, push constant ranges and vertex inputs. Modules of one
+//pipeline are reflected into the same ShaderInterface, bindings that several stages declare are merged. Only the
+//instructions that describe the interface are looked at, see https://registry.khronos.org/SPIR-V/specs/unified1/SPIRV.html
+namespace Spirv {
+    static constexpr u32 MAGIC = 0x07230203;
+    static constexpr size_t HEADER_WORDS = 5;
+
+    enum Op : u32 {
+        OP_ENTRY_POINT = 15,
+        OP_TYPE_BOOL = 20,
+        OP_TYPE_INT = 21,
+        OP_TYPE_FLOAT = 22,
+        OP_TYPE_VECTOR = 23,
+        OP_TYPE_MATRIX = 24,
+        OP_TYPE_IMAGE = 25,
+        OP_TYPE_SAMPLER = 26,
+        OP_TYPE_SAMPLED_IMAGE = 27,
+        OP_TYPE_ARRAY = 28,
+        OP_TYPE_RUNTIME_ARRAY = 29,
+        OP_TYPE_STRUCT = 30,
+        OP_TYPE_POINTER = 32,
+        OP_CONSTANT = 43,
+        OP_VARIABLE = 59,
+        OP_DECORATE = 71,
+        OP_MEMBER_DECORATE = 72,
+        OP_TYPE_ACCELERATION_STRUCTURE = 5341
+    };
+
+    enum Decoration : u32 {
+        DECORATION_BLOCK = 2,
+        DECORATION_BUFFER_BLOCK = 3,
+        DECORATION_ARRAY_STRIDE = 6,
+        DECORATION_MATRIX_STRIDE = 7,
+        DECORATION_BUILT_IN = 11,
+        DECORATION_LOCATION = 30,
+        DECORATION_BINDING = 33,
+        DECORATION_DESCRIPTOR_SET = 34,
+        DECORATION_OFFSET = 35
+    };
+
+    enum StorageClass : u32 {
+        STORAGE_UNIFORM_CONSTANT = 0,
+        STORAGE_INPUT = 1,
+        STORAGE_UNIFORM = 2,
+        STORAGE_PUSH_CONSTANT = 9,
+        STORAGE_STORAGE_BUFFER = 12
+    };
+
+    enum ExecutionModel : u32 {
+        EXECUTION_VERTEX = 0,
+        EXECUTION_TESSELLATION_CONTROL = 1,
+        EXECUTION_TESSELLATION_EVALUATION = 2,
+        EXECUTION_GEOMETRY = 3,
+        EXECUTION_FRAGMENT = 4,
+        EXECUTION_GL_COMPUTE = 5
+    };
+
+    static constexpr u32 DIM_BUFFER = 5;
+    static constexpr u32 DIM_SUBPASS_DATA = 6;
+
+    //What the module says about one result id, filled in as the instructions that define and decorate it go by
+    struct Id {
+        u32 opcode;
+        u32 type; //Result type of variables and constants, pointee of pointers, element of vectors, matrices and arrays
+        u32 storage_class;
+        u32 count; //Components of vectors and matrices, width of scalars, length id of arrays
+        u32 value; //Constants, signedness of integers
+        u32 image_dim;
+        u32 image_sampled;
+        u32 set;
+        u32 binding;
+        u32 location;
+        u32 array_stride;
+        u32 member_count;
+        const u32* members; //Member type ids of structs, inside the module
+        bool has_binding;
+        bool has_location;
+        bool built_in;
+        bool block;
+        bool buffer_block;
+    };
+}
+
+enum class NumericType : u32 {
+    FLOAT,
+    SINT,
+    UINT
+};
+
+struct ReflectedBinding {
+    u32 set;
+    u32 binding;
+    VkDescriptorType type;
+    u32 count; //0 for runtime arrays, sized when the layout is made
+    VkShaderStageFlags stages;
+};
+
+struct ReflectedInput {
+    u32 location;
+    VkFormat format; //What the shader declares, 32-bit components
+    NumericType numeric_type;
+    u32 component_count;
+};
+
+struct ShaderInterface {
+    static constexpr size_t MAX_BINDINGS = 32;
+    static constexpr size_t MAX_INPUTS = 16;
+    static constexpr size_t MAX_PUSH_CONSTANT_RANGES = 4;
+
+    VkShaderStageFlags stages = 0;
+    size_t binding_count = 0;
+    ReflectedBinding bindings[MAX_BINDINGS] = {}; //Sorted by set, then binding
+    size_t input_count = 0;
+    ReflectedInput inputs[MAX_INPUTS] = {}; //Vertex stage only, sorted by location
+    size_t push_constant_range_count = 0;
+    VkPushConstantRange push_constant_ranges[MAX_PUSH_CONSTANT_RANGES] = {};
+};
+
+VkShaderStageFlagBits spirv_stage(u32 execution_model) {
+    switch(execution_model) {
+        case Spirv::EXECUTION_VERTEX: return VK_SHADER_STAGE_VERTEX_BIT;
+        case Spirv::EXECUTION_TESSELLATION_CONTROL: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case Spirv::EXECUTION_TESSELLATION_EVALUATION: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case Spirv::EXECUTION_GEOMETRY: return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case Spirv::EXECUTION_FRAGMENT: return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case Spirv::EXECUTION_GL_COMPUTE: return VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    return VK_SHADER_STAGE_ALL;
+}
+
+VkFormat vertex_format(NumericType numeric_type, u32 component_count) {
+    static constexpr VkFormat FORMATS[3][4] = {
+        { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT },
+        { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT },
+        { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT }
+    };
+    return component_count >= 1 && component_count <= 4 ? FORMATS[static_cast<u32>(numeric_type)][component_count - 1] : VK_FORMAT_UNDEFINED;
+}
+
+//How a vertex buffer format reads in a shader: normalized and scaled formats arrive as floats
+bool vertex_format_numeric_type(VkFormat format, NumericType* numeric_type) {
+    switch(format) {
+        case VK_FORMAT_R32_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+        case VK_FORMAT_R32G32B32_SFLOAT:
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SNORM:
+        case VK_FORMAT_R16G16_UNORM:
+        case VK_FORMAT_R16G16_SNORM:
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SNORM:
+            *numeric_type = NumericType::FLOAT;
+            return true;
+        case VK_FORMAT_R32_SINT:
+        case VK_FORMAT_R32G32_SINT:
+        case VK_FORMAT_R32G32B32_SINT:
+        case VK_FORMAT_R32G32B32A32_SINT:
+        case VK_FORMAT_R8G8B8A8_SINT:
+        case VK_FORMAT_R16G16_SINT:
+            *numeric_type = NumericType::SINT;
+            return true;
+        case VK_FORMAT_R32_UINT:
+        case VK_FORMAT_R32G32_UINT:
+        case VK_FORMAT_R32G32B32_UINT:
+        case VK_FORMAT_R32G32B32A32_UINT:
+        case VK_FORMAT_R8G8B8A8_UINT:
+        case VK_FORMAT_R16G16_UINT:
+            *numeric_type = NumericType::UINT;
+            return true;
+        default:
+            return false;
+    }
+}
+
+//Strips arrays and returns the element type, count receives the element count (0 for runtime arrays)
+u32 spirv_array_element(Spirv::Id* ids, u32 type, u32* count) {
+    *count = 1;
+    while(ids[type].opcode == Spirv::OP_TYPE_ARRAY || ids[type].opcode == Spirv::OP_TYPE_RUNTIME_ARRAY) {
+        *count = ids[type].opcode == Spirv::OP_TYPE_RUNTIME_ARRAY ? 0 : *count * ids[ids[type].count].value;
+        type = ids[type].type;
+    }
+    return type;
+}
+
+bool spirv_descriptor_type(Spirv::Id* ids, u32 storage_class, u32 type, VkDescriptorType* descriptor_type) {
+    Spirv::Id* id = &ids[type];
+    if(storage_class == Spirv::STORAGE_STORAGE_BUFFER || (storage_class == Spirv::STORAGE_UNIFORM && id->buffer_block)) {
+        *descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        return true;
+    }
+    if(storage_class == Spirv::STORAGE_UNIFORM) {
+        *descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        return true;
+    }
+
+    switch(id->opcode) {
+        case Spirv::OP_TYPE_SAMPLER: *descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLER; return true;
+        case Spirv::OP_TYPE_SAMPLED_IMAGE: *descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; return true;
+        case Spirv::OP_TYPE_ACCELERATION_STRUCTURE: *descriptor_type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR; return true;
+        case Spirv::OP_TYPE_IMAGE:
+            if(id->image_dim == Spirv::DIM_SUBPASS_DATA) {
+                *descriptor_type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            } else if(id->image_dim == Spirv::DIM_BUFFER) {
+                *descriptor_type = id->image_sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            } else {
+                *descriptor_type = id->image_sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            return true;
+    }
+    return false;
+}
+
+//Bytes a member of type occupies inside a block, using the strides the module was decorated with
+u32 spirv_type_size(Spirv::Id* ids, const u32* code, size_t word_count, u32 type, u32 matrix_stride);
+
+u32 spirv_struct_size(Spirv::Id* ids, const u32* code, size_t word_count, u32 type) {
+    //Member offsets and matrix strides are member decorations, look them up for this struct only
+    u32 size = 0;
+    for(size_t word = Spirv::HEADER_WORDS; word < word_count;) {
+        u32 length = code[word] >> 16;
+        u32 opcode = code[word] & 0xFFFF;
+        if(length == 0) {
+            break;
+        }
+
+        if(opcode == Spirv::OP_MEMBER_DECORATE && length >= 5 && code[word + 1] == type && code[word + 3] == Spirv::DECORATION_OFFSET) {
+            u32 member = code[word + 2];
+            u32 matrix_stride = 0;
+            for(size_t inner = Spirv::HEADER_WORDS; inner < word_count && member < ids[type].member_count;) {
+                u32 inner_length = code[inner] >> 16;
+                if(inner_length == 0) {
+                    break;
+                }
+                if((code[inner] & 0xFFFF) == Spirv::OP_MEMBER_DECORATE && inner_length >= 5 && code[inner + 1] == type && code[inner + 2] == member && code[inner + 3] == Spirv::DECORATION_MATRIX_STRIDE) {
+                    matrix_stride = code[inner + 4];
+                }
+                inner += inner_length;
+            }
+
+            if(member < ids[type].member_count) {
+                u32 end = code[word + 4] + spirv_type_size(ids, code, word_count, ids[type].members[member], matrix_stride);
+                size = end > size ? end : size;
+            }
+        }
+        word += length;
+    }
+    return size;
+}
+
+u32 spirv_type_size(Spirv::Id* ids, const u32* code, size_t word_count, u32 type, u32 matrix_stride) {
+    Spirv::Id* id = &ids[type];
+    switch(id->opcode) {
+        case Spirv::OP_TYPE_BOOL: return 4;
+        case Spirv::OP_TYPE_INT:
+        case Spirv::OP_TYPE_FLOAT: return id->count / 8;
+        case Spirv::OP_TYPE_VECTOR: return id->count * spirv_type_size(ids, code, word_count, id->type, 0);
+        case Spirv::OP_TYPE_MATRIX: return id->count * (matrix_stride ? matrix_stride : spirv_type_size(ids, code, word_count, id->type, 0));
+        case Spirv::OP_TYPE_ARRAY: return ids[id->count].value * (id->array_stride ? id->array_stride : spirv_type_size(ids, code, word_count, id->type, matrix_stride));
+        case Spirv::OP_TYPE_STRUCT: return spirv_struct_size(ids, code, word_count, type);
+    }
+    return 0;
+}
+
+bool shader_interface_add_binding(ShaderInterface* interface, ReflectedBinding binding) {
+    size_t index = 0;
+    while(index < interface->binding_count && (interface->bindings[index].set < binding.set || (interface->bindings[index].set == binding.set && interface->bindings[index].binding < binding.binding))) {
+        ++index;
+    }
+
+    ReflectedBinding* existing = &interface->bindings[index];
+    if(index < interface->binding_count && existing->set == binding.set && existing->binding == binding.binding) {
+        if(existing->type != binding.type || existing->count != binding.count) {
+            printf("spirv_reflect() failed. [Set %u binding %u is declared differently by two stages]\n", binding.set, binding.binding);
+            return false;
+        }
+        existing->stages |= binding.stages;
+        return true;
+    }
+
+    if(interface->binding_count == ShaderInterface::MAX_BINDINGS) {
+        printf("spirv_reflect() failed. [More than %zd bindings]\n", ShaderInterface::MAX_BINDINGS);
+        return false;
+    }
+
+    memmove(existing + 1, existing, sizeof(ReflectedBinding) * (interface->binding_count - index));
+    *existing = binding;
+    ++interface->binding_count;
+    return true;
+}
+
+bool shader_interface_add_input(ShaderInterface* interface, ReflectedInput input) {
+    size_t index = 0;
+    while(index < interface->input_count && interface->inputs[index].location < input.location) {
+        ++index;
+    }
+
+    if(index < interface->input_count && interface->inputs[index].location == input.location) {
+        if(interface->inputs[index].format != input.format) {
+            printf("spirv_reflect() failed. [Vertex input %u is declared differently by two modules]\n", input.location);
+            return false;
+        }
+        return true;
+    }
+
+    if(interface->input_count == ShaderInterface::MAX_INPUTS) {
+        printf("spirv_reflect() failed. [More than %zd vertex inputs]\n", ShaderInterface::MAX_INPUTS);
+        return false;
+    }
+
+    memmove(&interface->inputs[index + 1], &interface->inputs[index], sizeof(ReflectedInput) * (interface->input_count - index));
+    interface->inputs[index] = input;
+    ++interface->input_count;
+    return true;
+}
+
+//Stages that see the same block share one range
+bool shader_interface_add_push_constant_range(ShaderInterface* interface, VkPushConstantRange range) {
+    for(size_t index = 0; index < interface->push_constant_range_count; ++index) {
+        VkPushConstantRange* existing = &interface->push_constant_ranges[index];
+        if(existing->offset == range.offset && existing->size == range.size) {
+            existing->stageFlags |= range.stageFlags;
+            return true;
+        }
+    }
+
+    if(interface->push_constant_range_count == ShaderInterface::MAX_PUSH_CONSTANT_RANGES) {
+        printf("spirv_reflect() failed. [More than %zd push constant ranges]\n", ShaderInterface::MAX_PUSH_CONSTANT_RANGES);
+        return false;
+    }
+    interface->push_constant_ranges[interface->push_constant_range_count++] = range;
+    return true;
+}
+
+//Adds one module to interface. size is in bytes. Modules with several entry points are reflected as the first one
+bool spirv_reflect(const u32* code, size_t size, ShaderInterface* interface) {
+    size_t word_count = size / sizeof(u32);
+    if(word_count < Spirv::HEADER_WORDS || code[0] != Spirv::MAGIC) {
+        printf("spirv_reflect() failed. [Not SPIR-V]\n");
+        return false;
+    }
+
+    u32 bound = code[3];
+    Spirv::Id* ids = (Spirv::Id*)calloc(bound, sizeof(Spirv::Id));
+    if(!ids) {
+        printf("calloc() failed. [%u SPIR-V ids]\n", bound);
+        return false;
+    }
+
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+    bool valid = true;
+    for(size_t word = Spirv::HEADER_WORDS; word < word_count && valid;) {
+        u32 length = code[word] >> 16;
+        u32 opcode = code[word] & 0xFFFF;
+        const u32* operands = &code[word + 1];
+        if(length == 0 || word + length > word_count) {
+            printf("spirv_reflect() failed. [Truncated instruction at word %zd]\n", word);
+            valid = false;
+            break;
+        }
+
+        if(opcode == Spirv::OP_ENTRY_POINT) {
+            if(stage == VK_SHADER_STAGE_ALL && length > 1) {
+                stage = spirv_stage(operands[0]);
+            }
+            word += length;
+            continue;
+        }
+
+        //Every other instruction below defines or decorates the id in its first or second operand
+        u32 target = opcode == Spirv::OP_CONSTANT || opcode == Spirv::OP_VARIABLE ? 1 : 0;
+        target = target + 1 < length ? operands[target] : bound;
+        if(target >= bound) {
+            word += length;
+            continue;
+        }
+
+        Spirv::Id* id = &ids[target];
+        switch(opcode) {
+            case Spirv::OP_TYPE_BOOL:
+            case Spirv::OP_TYPE_SAMPLER:
+            case Spirv::OP_TYPE_ACCELERATION_STRUCTURE:
+                id->opcode = opcode;
+                break;
+            case Spirv::OP_TYPE_INT:
+                *id = { .opcode = opcode, .count = operands[1], .value = operands[2] };
+                break;
+            case Spirv::OP_TYPE_FLOAT:
+                *id = { .opcode = opcode, .count = operands[1] };
+                break;
+            case Spirv::OP_TYPE_VECTOR:
+            case Spirv::OP_TYPE_MATRIX:
+            case Spirv::OP_TYPE_ARRAY:
+                id->opcode = opcode;
+                id->type = operands[1];
+                id->count = operands[2];
+                break;
+            case Spirv::OP_TYPE_RUNTIME_ARRAY:
+            case Spirv::OP_TYPE_SAMPLED_IMAGE:
+                id->opcode = opcode;
+                id->type = operands[1];
+                break;
+            case Spirv::OP_TYPE_IMAGE:
+                id->opcode = opcode;
+                id->type = operands[1];
+                id->image_dim = operands[2];
+                id->image_sampled = operands[6];
+                break;
+            case Spirv::OP_TYPE_STRUCT:
+                id->opcode = opcode;
+                id->member_count = length - 2;
+                id->members = &operands[1];
+                break;
+            case Spirv::OP_TYPE_POINTER:
+                id->opcode = opcode;
+                id->storage_class = operands[1];
+                id->type = operands[2];
+                break;
+            case Spirv::OP_CONSTANT:
+                id->opcode = opcode;
+                id->type = operands[0];
+                id->value = operands[2];
+                break;
+            case Spirv::OP_VARIABLE:
+                id->opcode = opcode;
+                id->type = operands[0];
+                id->storage_class = operands[2];
+                break;
+            case Spirv::OP_DECORATE:
+                switch(operands[1]) {
+                    case Spirv::DECORATION_BLOCK: id->block = true; break;
+                    case Spirv::DECORATION_BUFFER_BLOCK: id->buffer_block = true; break;
+                    case Spirv::DECORATION_ARRAY_STRIDE: id->array_stride = operands[2]; break;
+                    case Spirv::DECORATION_BUILT_IN: id->built_in = true; break;
+                    case Spirv::DECORATION_LOCATION: id->location = operands[2]; id->has_location = true; break;
+                    case Spirv::DECORATION_BINDING: id->binding = operands[2]; id->has_binding = true; break;
+                    case Spirv::DECORATION_DESCRIPTOR_SET: id->set = operands[2]; break;
+                }
+                break;
+        }
+        word += length;
+    }
+
+    if(valid && stage == VK_SHADER_STAGE_ALL) {
+        printf("spirv_reflect() failed. [No entry point]\n");
+        valid = false;
+    }
+
+    //Types and decorations are all known now, walk the module-scope variables
+    for(u32 variable_id = 0; variable_id < bound && valid; ++variable_id) {
+        Spirv::Id* variable = &ids[variable_id];
+        if(variable->opcode != Spirv::OP_VARIABLE || variable->type >= bound) {
+            continue;
+        }
+        u32 type = ids[variable->type].type;
+
+        if(variable->storage_class == Spirv::STORAGE_UNIFORM_CONSTANT || variable->storage_class == Spirv::STORAGE_UNIFORM || variable->storage_class == Spirv::STORAGE_STORAGE_BUFFER) {
+            if(!variable->has_binding) {
+                continue;
+            }
+
+            ReflectedBinding binding = { .set = variable->set, .binding = variable->binding, .stages = static_cast<VkShaderStageFlags>(stage) };
+            u32 element = spirv_array_element(ids, type, &binding.count);
+            if(!spirv_descriptor_type(ids, variable->storage_class, element, &binding.type)) {
+                printf("spirv_reflect() failed. [Set %u binding %u has an unknown descriptor type]\n", binding.set, binding.binding);
+                valid = false;
+                break;
+            }
+            valid = shader_interface_add_binding(interface, binding);
+        } else if(variable->storage_class == Spirv::STORAGE_PUSH_CONSTANT) {
+            VkPushConstantRange range = { .stageFlags = static_cast<VkShaderStageFlags>(stage), .offset = 0, .size = spirv_struct_size(ids, code, word_count, type) };
+            valid = shader_interface_add_push_constant_range(interface, range);
+        } else if(variable->storage_class == Spirv::STORAGE_INPUT && stage == VK_SHADER_STAGE_VERTEX_BIT && !variable->built_in && ids[type].opcode != Spirv::OP_TYPE_STRUCT) {
+            //Matrices take one location per column
+            u32 columns = 1;
+            if(ids[type].opcode == Spirv::OP_TYPE_MATRIX) {
+                columns = ids[type].count;
+                type = ids[type].type;
+            }
+
+            u32 component_count = ids[type].opcode == Spirv::OP_TYPE_VECTOR ? ids[type].count : 1;
+            Spirv::Id* scalar = &ids[ids[type].opcode == Spirv::OP_TYPE_VECTOR ? ids[type].type : type];
+            if((scalar->opcode != Spirv::OP_TYPE_FLOAT && scalar->opcode != Spirv::OP_TYPE_INT) || scalar->count != 32 || !variable->has_location) {
+                printf("spirv_reflect() failed. [Vertex input %u is not a 32-bit scalar, vector or matrix]\n", variable_id);
+                valid = false;
+                break;
+            }
+
+            NumericType numeric_type = scalar->opcode == Spirv::OP_TYPE_FLOAT ? NumericType::FLOAT : (scalar->value ? NumericType::SINT : NumericType::UINT);
+            for(u32 column = 0; column < columns && valid; ++column) {
+                ReflectedInput input = {
+                    .location = variable->location + column,
+                    .format = vertex_format(numeric_type, component_count),
+                    .numeric_type = numeric_type,
+                    .component_count = component_count
+                };
+                valid = shader_interface_add_input(interface, input);
+            }
+        }
+    }
+
+    free(ids);
+    if(valid) {
+        interface->stages |= stage;
+    }
+    return valid;
+}
+
+//Whether a and b need the same pipeline layout. Vertex inputs don't take part, they only change the vertex input state
+bool shader_interface_layout_equal(const ShaderInterface* a, const ShaderInterface* b) {
+    if(a->binding_count != b->binding_count || a->push_constant_range_count != b->push_constant_range_count) {
+        return false;
+    }
+
+    for(size_t index = 0; index < a->binding_count; ++index) {
+        const ReflectedBinding* x = &a->bindings[index];
+        const ReflectedBinding* y = &b->bindings[index];
+        if(x->set != y->set || x->binding != y->binding || x->type != y->type || x->count != y->count || x->stages != y->stages) {
+            return false;
+        }
+    }
+    for(size_t index = 0; index < a->push_constant_range_count; ++index) {
+        const VkPushConstantRange* x = &a->push_constant_ranges[index];
+        const VkPushConstantRange* y = &b->push_constant_ranges[index];
+        if(x->stageFlags != y->stageFlags || x->offset != y->offset || x->size != y->size) {
+            return false;
+        }
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <stdio.h>
+#include "types.h"
+#include "math.h"
+#include "memory.h"
+
+//Column-major 3x2 affine transform, laid out like a GLSL mat3x2 (three vec2 columns)
+struct Affine2D {
+    f32 x_axis[2];
+    f32 y_axis[2];
+    f32 translation[2];
+};
+
+//Structure-of-arrays sprite transforms, each field is contiguous so the update pass can work on several sprites per instruction
+struct TransformSoA {
+    f32* position_x = nullptr;
+    f32* position_y = nullptr;
+    f32* rotation = nullptr; //Radians
+    f32* scale_x = nullptr;
+    f32* scale_y = nullptr;
+};
+
+//Sub-rectangle of the bound texture in normalized coordinates, an atlas page holds many sprites' images
+struct UvRect {
+    f32 min[2];
+    f32 max[2];
+};
+
+static constexpr UvRect UV_RECT_FULL = { .min = { 0.0f, 0.0f }, .max = { 1.0f, 1.0f } };
+
+struct SpriteBatch {
+    static constexpr size_t SIMD_WIDTH = 4;
+    static constexpr size_t STREAM_ALIGNMENT = 64;
+
+    size_t capacity = 0;
+    size_t count = 0;
+    TransformSoA transforms = {};
+    u32* texture_ids = nullptr;
+    u32* tints = nullptr; //RGBA8, red in the low byte
+    UvRect* uv_rects = nullptr;
+    Affine2D* model_matrices = nullptr;
+};
+
+//Per-instance vertex stream layout, read by shader.vert at locations 3-8
+struct SpriteInstance {
+    Affine2D model;
+    u32 texture_index;
+    u32 tint;
+    UvRect uv_rect;
+};
+
+static constexpr u32 SPRITE_TINT_WHITE = 0xFFFFFFFF;
+
+//Sprites are addressed by their slot in the batch
+struct Sprite {
+    SpriteBatch* batch = nullptr;
+    u32 index = UINT32_MAX;
+};
+
+SpriteBatch* sprite_batch_create(MemoryArena* arena, size_t capacity) {
+    SpriteBatch* batch = push_struct<SpriteBatch>(arena);
+    if(!batch) {
+        printf("sprite_batch_create() failed. [SpriteBatch object allocation]\n");
+        return nullptr;
+    }
+
+    *batch = {};
+
+    //Rounded up so the update pass can always load full SIMD_WIDTH lanes
+    batch->capacity = (capacity + SpriteBatch::SIMD_WIDTH - 1) & ~(SpriteBatch::SIMD_WIDTH - 1);
+
+    f32** fields[] = {
+        &batch->transforms.position_x,
+        &batch->transforms.position_y,
+        &batch->transforms.rotation,
+        &batch->transforms.scale_x,
+        &batch->transforms.scale_y
+    };
+
+    //Each stream starts on a cache line, so a SIMD_WIDTH load never splits across two lines
+    for(f32** field : fields) {
+        *field = push_array<f32>(arena, batch->capacity, SpriteBatch::STREAM_ALIGNMENT);
+        if(!*field) {
+            printf("sprite_batch_create() failed. [Transform allocation, %zd sprites]\n", batch->capacity);
+            return nullptr;
+        }
+    }
+
+    batch->texture_ids = push_array<u32>(arena, batch->capacity, SpriteBatch::STREAM_ALIGNMENT);
+    batch->tints = push_array<u32>(arena, batch->capacity, SpriteBatch::STREAM_ALIGNMENT);
+    batch->uv_rects = push_array<UvRect>(arena, batch->capacity, SpriteBatch::STREAM_ALIGNMENT);
+    batch->model_matrices = push_array<Affine2D>(arena, batch->capacity, SpriteBatch::STREAM_ALIGNMENT);
+    if(!batch->texture_ids || !batch->tints || !batch->uv_rects || !batch->model_matrices) {
+        printf("sprite_batch_create() failed. [Sprite data allocation, %zd sprites]\n", batch->capacity);
+        return nullptr;
+    }
+
+    return batch;
+}
+
+//New sprites start at the origin with no rotation, unit scale and a white tint
+Sprite sprite_batch_add(SpriteBatch* batch, u32 texture_id, UvRect uv_rect = UV_RECT_FULL) {
+    Sprite sprite = { .batch = batch };
+    if(batch->count >= batch->capacity) {
+        printf("sprite_batch_add() failed. [Batch full, %zd sprites]\n", batch->capacity);
+        return sprite;
+    }
+
+    size_t index = batch->count++;
+    batch->transforms.position_x[index] = 0.0f;
+    batch->transforms.position_y[index] = 0.0f;
+    batch->transforms.rotation[index] = 0.0f;
+    batch->transforms.scale_x[index] = 1.0f;
+    batch->transforms.scale_y[index] = 1.0f;
+    batch->texture_ids[index] = texture_id;
+    batch->tints[index] = SPRITE_TINT_WHITE;
+    batch->uv_rects[index] = uv_rect;
+    batch->model_matrices[index] = { .x_axis = { 1.0f, 0.0f }, .y_axis = { 0.0f, 1.0f }, .translation = { 0.0f, 0.0f } };
+
+    sprite.index = static_cast<u32>(index);
+    return sprite;
+}
+
+//Swaps the last sprite into the removed slot, so any Sprite referring to the last index now refers to sprite.index
+void sprite_batch_remove(SpriteBatch* batch, Sprite sprite) {
+    if(sprite.index >= batch->count) {
+        return;
+    }
+
+    size_t last = --batch->count;
+    batch->transforms.position_x[sprite.index] = batch->transforms.position_x[last];
+    batch->transforms.position_y[sprite.index] = batch->transforms.position_y[last];
+    batch->transforms.rotation[sprite.index] = batch->transforms.rotation[last];
+    batch->transforms.scale_x[sprite.index] = batch->transforms.scale_x[last];
+    batch->transforms.scale_y[sprite.index] = batch->transforms.scale_y[last];
+    batch->texture_ids[sprite.index] = batch->texture_ids[last];
+    batch->tints[sprite.index] = batch->tints[last];
+    batch->uv_rects[sprite.index] = batch->uv_rects[last];
+    batch->model_matrices[sprite.index] = batch->model_matrices[last];
+}
+
+//Cephes style sin/cos: reduce to [-pi/4, pi/4] around the nearest multiple of pi/2, evaluate both polynomials and
+//pick/negate by quadrant. Accurate to a few ulp for the angle ranges sprites use (|angle| < ~8000)
+namespace SinCos {
+    static constexpr f32 TWO_OVER_PI = 0.636619772367581343f;
+    static constexpr f32 HALF_PI_1 = 1.5703125f; //Cody-Waite split of pi/2
+    static constexpr f32 HALF_PI_2 = 4.837512969970703125e-4f;
+    static constexpr f32 HALF_PI_3 = 7.54978995489188216e-8f;
+    static constexpr f32 SIN_1 = -1.9515295891e-4f;
+    static constexpr f32 SIN_2 = 8.3321608736e-3f;
+    static constexpr f32 SIN_3 = -1.6666654611e-1f;
+    static constexpr f32 COS_1 = 2.443315711809948e-5f;
+    static constexpr f32 COS_2 = -1.388731625493765e-3f;
+    static constexpr f32 COS_3 = 4.166664568298827e-2f;
+}
+
+void sincos_approximate(f32 angle, f32* sine, f32* cosine) {
+    i32 quadrant = static_cast<i32>(nearbyintf(angle * SinCos::TWO_OVER_PI));
+    f32 quadrant_f32 = static_cast<f32>(quadrant);
+    f32 r = angle - quadrant_f32 * SinCos::HALF_PI_1 - quadrant_f32 * SinCos::HALF_PI_2 - quadrant_f32 * SinCos::HALF_PI_3;
+    f32 z = r * r;
+
+    f32 sin_r = r + r * z * ((SinCos::SIN_1 * z + SinCos::SIN_2) * z + SinCos::SIN_3);
+    f32 cos_r = 1.0f - 0.5f * z + z * z * ((SinCos::COS_1 * z + SinCos::COS_2) * z + SinCos::COS_3);
+
+    f32 s = (quadrant & 1) ? cos_r : sin_r;
+    f32 c = (quadrant & 1) ? sin_r : cos_r;
+    *sine = (quadrant & 2) ? -s : s;
+    *cosine = ((quadrant + 1) & 2) ? -c : c;
+}
+
+//model = translation * rotation * scale
+void affine_compose(f32 position_x, f32 position_y, f32 rotation, f32 scale_x, f32 scale_y, Affine2D* affine) {
+    f32 sine;
+    f32 cosine;
+    sincos_approximate(rotation, &sine, &cosine);
+
+    affine->x_axis[0] = cosine * scale_x;
+    affine->x_axis[1] = sine * scale_x;
+    affine->y_axis[0] = -sine * scale_y;
+    affine->y_axis[1] = cosine * scale_y;
+    affine->translation[0] = position_x;
+    affine->translation[1] = position_y;
+}
+
+void sprite_batch_update_transforms(SpriteBatch* batch) {
+    TransformSoA* transforms = &batch->transforms;
+    Affine2D* model_matrices = batch->model_matrices;
+    size_t index = 0;
+
+#if defined(MATH_SIMD_SSE)
+    const __m128 two_over_pi = _mm_set1_ps(SinCos::TWO_OVER_PI);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+
+    for(; index + SpriteBatch::SIMD_WIDTH <= batch->count; index += SpriteBatch::SIMD_WIDTH) {
+        __m128 rotation = _mm_loadu_ps(transforms->rotation + index);
+
+        __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(rotation, two_over_pi));
+        __m128 quadrant_f32 = _mm_cvtepi32_ps(quadrant);
+        __m128 r = _mm_sub_ps(rotation, _mm_mul_ps(quadrant_f32, _mm_set1_ps(SinCos::HALF_PI_1)));
+        r = _mm_sub_ps(r, _mm_mul_ps(quadrant_f32, _mm_set1_ps(SinCos::HALF_PI_2)));
+        r = _mm_sub_ps(r, _mm_mul_ps(quadrant_f32, _mm_set1_ps(SinCos::HALF_PI_3)));
+        __m128 z = _mm_mul_ps(r, r);
+
+        __m128 sin_r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SinCos::SIN_1), z), _mm_set1_ps(SinCos::SIN_2));
+        sin_r = _mm_add_ps(_mm_mul_ps(sin_r, z), _mm_set1_ps(SinCos::SIN_3));
+        sin_r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sin_r));
+
+        __m128 cos_r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SinCos::COS_1), z), _mm_set1_ps(SinCos::COS_2));
+        cos_r = _mm_add_ps(_mm_mul_ps(cos_r, z), _mm_set1_ps(SinCos::COS_3));
+        cos_r = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_mul_ps(_mm_mul_ps(z, z), cos_r));
+
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+        __m128 sine = _mm_or_ps(_mm_and_ps(swap, cos_r), _mm_andnot_ps(swap, sin_r));
+        __m128 cosine = _mm_or_ps(_mm_and_ps(swap, sin_r), _mm_andnot_ps(swap, cos_r));
+        sine = _mm_xor_ps(sine, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30)));
+        cosine = _mm_xor_ps(cosine, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30)));
+
+        __m128 scale_x = _mm_loadu_ps(transforms->scale_x + index);
+        __m128 scale_y = _mm_loadu_ps(transforms->scale_y + index);
+        __m128 x_axis_x = _mm_mul_ps(cosine, scale_x);
+        __m128 x_axis_y = _mm_mul_ps(sine, scale_x);
+        __m128 y_axis_x = _mm_xor_ps(_mm_mul_ps(sine, scale_y), _mm_set1_ps(-0.0f));
+        __m128 y_axis_y = _mm_mul_ps(cosine, scale_y);
+
+        //Transposing the four axis components gives each sprite's first 16 bytes, translations follow as pairs
+        _MM_TRANSPOSE4_PS(x_axis_x, x_axis_y, y_axis_x, y_axis_y);
+        __m128 position_x = _mm_loadu_ps(transforms->position_x + index);
+        __m128 position_y = _mm_loadu_ps(transforms->position_y + index);
+        __m128 translations_low = _mm_unpacklo_ps(position_x, position_y);
+        __m128 translations_high = _mm_unpackhi_ps(position_x, position_y);
+
+        Affine2D* out = model_matrices + index;
+        _mm_storeu_ps(out[0].x_axis, x_axis_x);
+        _mm_storel_pi(reinterpret_cast<__m64*>(out[0].translation), translations_low);
+        _mm_storeu_ps(out[1].x_axis, x_axis_y);
+        _mm_storeh_pi(reinterpret_cast<__m64*>(out[1].translation), translations_low);
+        _mm_storeu_ps(out[2].x_axis, y_axis_x);
+        _mm_storel_pi(reinterpret_cast<__m64*>(out[2].translation), translations_high);
+        _mm_storeu_ps(out[3].x_axis, y_axis_y);
+        _mm_storeh_pi(reinterpret_cast<__m64*>(out[3].translation), translations_high);
+    }
+#elif defined(MATH_SIMD_NEON)
+    for(; index + SpriteBatch::SIMD_WIDTH <= batch->count; index += SpriteBatch::SIMD_WIDTH) {
+        float32x4_t rotation = vld1q_f32(transforms->rotation + index);
+
+        int32x4_t quadrant = vcvtnq_s32_f32(vmulq_n_f32(rotation, SinCos::TWO_OVER_PI));
+        float32x4_t quadrant_f32 = vcvtq_f32_s32(quadrant);
+        float32x4_t r = vsubq_f32(rotation, vmulq_n_f32(quadrant_f32, SinCos::HALF_PI_1));
+        r = vsubq_f32(r, vmulq_n_f32(quadrant_f32, SinCos::HALF_PI_2));
+        r = vsubq_f32(r, vmulq_n_f32(quadrant_f32, SinCos::HALF_PI_3));
+        float32x4_t z = vmulq_f32(r, r);
+
+        float32x4_t sin_r = vaddq_f32(vmulq_n_f32(z, SinCos::SIN_1), vdupq_n_f32(SinCos::SIN_2));
+        sin_r = vaddq_f32(vmulq_f32(sin_r, z), vdupq_n_f32(SinCos::SIN_3));
+        sin_r = vaddq_f32(r, vmulq_f32(vmulq_f32(r, z), sin_r));
+
+        float32x4_t cos_r = vaddq_f32(vmulq_n_f32(z, SinCos::COS_1), vdupq_n_f32(SinCos::COS_2));
+        cos_r = vaddq_f32(vmulq_f32(cos_r, z), vdupq_n_f32(SinCos::COS_3));
+        cos_r = vaddq_f32(vsubq_f32(vdupq_n_f32(1.0f), vmulq_n_f32(z, 0.5f)), vmulq_f32(vmulq_f32(z, z), cos_r));
+
+        uint32x4_t quadrant_bits = vreinterpretq_u32_s32(quadrant);
+        uint32x4_t swap = vtstq_u32(quadrant_bits, vdupq_n_u32(1));
+        float32x4_t sine = vbslq_f32(swap, cos_r, sin_r);
+        float32x4_t cosine = vbslq_f32(swap, sin_r, cos_r);
+        sine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sine), vshlq_n_u32(vandq_u32(quadrant_bits, vdupq_n_u32(2)), 30)));
+        cosine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cosine), vshlq_n_u32(vandq_u32(vaddq_u32(quadrant_bits, vdupq_n_u32(1)), vdupq_n_u32(2)), 30)));
+
+        float32x4_t scale_x = vld1q_f32(transforms->scale_x + index);
+        float32x4_t scale_y = vld1q_f32(transforms->scale_y + index);
+        float32x4_t x_axis_x = vmulq_f32(cosine, scale_x);
+        float32x4_t x_axis_y = vmulq_f32(sine, scale_x);
+        float32x4_t y_axis_x = vnegq_f32(vmulq_f32(sine, scale_y));
+        float32x4_t y_axis_y = vmulq_f32(cosine, scale_y);
+        float32x4_t position_x = vld1q_f32(transforms->position_x + index);
+        float32x4_t position_y = vld1q_f32(transforms->position_y + index);
+
+        //Zipping gives (x, y) pairs, low halves belong to sprites 0/2 and high halves to sprites 1/3
+        float32x4_t x_axes_low = vzip1q_f32(x_axis_x, x_axis_y);
+        float32x4_t x_axes_high = vzip2q_f32(x_axis_x, x_axis_y);
+        float32x4_t y_axes_low = vzip1q_f32(y_axis_x, y_axis_y);
+        float32x4_t y_axes_high = vzip2q_f32(y_axis_x, y_axis_y);
+        float32x4_t translations_low = vzip1q_f32(position_x, position_y);
+        float32x4_t translations_high = vzip2q_f32(position_x, position_y);
+
+        Affine2D* out = model_matrices + index;
+        vst1_f32(out[0].x_axis, vget_low_f32(x_axes_low));
+        vst1_f32(out[0].y_axis, vget_low_f32(y_axes_low));
+        vst1_f32(out[0].translation, vget_low_f32(translations_low));
+        vst1_f32(out[1].x_axis, vget_high_f32(x_axes_low));
+        vst1_f32(out[1].y_axis, vget_high_f32(y_axes_low));
+        vst1_f32(out[1].translation, vget_high_f32(translations_low));
+        vst1_f32(out[2].x_axis, vget_low_f32(x_axes_high));
+        vst1_f32(out[2].y_axis, vget_low_f32(y_axes_high));
+        vst1_f32(out[2].translation, vget_low_f32(translations_high));
+        vst1_f32(out[3].x_axis, vget_high_f32(x_axes_high));
+        vst1_f32(out[3].y_axis, vget_high_f32(y_axes_high));
+        vst1_f32(out[3].translation, vget_high_f32(translations_high));
+    }
+#endif
+
+    for(; index < batch->count; ++index) {
+        affine_compose(transforms->position_x[index], transforms->position_y[index], transforms->rotation[index], transforms->scale_x[index], transforms->scale_y[index], &model_matrices[index]);
+    }
+}
+
+//Interleaves the batch into the instance stream layout, returns the number of instances written
+size_t sprite_batch_write_instances(SpriteBatch* batch, SpriteInstance* instances, size_t max_instances) {
+    size_t count = batch->count < max_instances ? batch->count : max_instances;
+    for(size_t index = 0; index < count; ++index) {
+        instances[index] = {
+            .model = batch->model_matrices[index],
+            .texture_index = batch->texture_ids[index],
+            .tint = batch->tints[index],
+            .uv_rect = batch->uv_rects[index]
+        };
+    }
+
+    return count;
+}
\ No newline at end of file
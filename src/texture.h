@@ -1,22 +1,212 @@
 #pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "types.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+//Formats an image can arrive in. The values are the matching VkFormat, which is also what KTX2 stores, so this header
+//doesn't need vulkan.h
+enum class ImageFormat : u32 {
+    RGBA8_SRGB = 43,
+    BC1_RGBA_SRGB = 134,
+    BC3_SRGB = 138,
+    BC7_SRGB = 146,
+    ASTC_4X4_SRGB = 158
+};
+
+//Who owns ImageData::pixels
+enum class ImageMemory : u32 {
+    HEAP, //malloc()
+    STB, //stbi_load()
+    MAPPED //Read-only view into an asset pack, never written or freed
+};
+
 struct ImageData {
+    static constexpr u32 MAX_LEVELS = 16;
+
     u8* pixels;
     u32 width;
     u32 height;
-    u64 size;
+    u64 size; //Every level
+    ImageFormat format;
+    u32 level_count; //Mip levels present in pixels, level 0 first
+    u64 level_offsets[MAX_LEVELS]; //Into pixels
+    u64 level_sizes[MAX_LEVELS];
+    ImageMemory memory;
 };
 
+bool image_format_compressed(ImageFormat format) {
+    return format != ImageFormat::RGBA8_SRGB;
+}
+
+//Bytes per 4x4 block for compressed formats, per texel otherwise
+u32 image_format_block_size(ImageFormat format) {
+    switch(format) {
+        case ImageFormat::RGBA8_SRGB: return 4;
+        case ImageFormat::BC1_RGBA_SRGB: return 8;
+        case ImageFormat::BC3_SRGB: return 16;
+        case ImageFormat::BC7_SRGB: return 16;
+        case ImageFormat::ASTC_4X4_SRGB: return 16;
+    }
+    return 0;
+}
+
+u64 image_level_size(ImageFormat format, u32 width, u32 height) {
+    if(image_format_compressed(format)) {
+        return static_cast<u64>((width + 3) / 4) * ((height + 3) / 4) * image_format_block_size(format);
+    }
+    return static_cast<u64>(width) * height * image_format_block_size(format);
+}
+
+void image_free(ImageData* image_data) {
+    if(image_data->memory == ImageMemory::STB) {
+        stbi_image_free(image_data->pixels);
+    } else if(image_data->memory == ImageMemory::HEAP) {
+        free(image_data->pixels);
+    }
+    image_data->pixels = nullptr;
+}
+
+//KTX2 container, see https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html. Only the parts a 2D texture uses
+namespace Ktx2 {
+    static constexpr u8 IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct Header {
+        u8 identifier[12];
+        u32 vk_format;
+        u32 type_size;
+        u32 pixel_width;
+        u32 pixel_height;
+        u32 pixel_depth;
+        u32 layer_count;
+        u32 face_count;
+        u32 level_count;
+        u32 supercompression_scheme;
+        u32 dfd_byte_offset;
+        u32 dfd_byte_length;
+        u32 kvd_byte_offset;
+        u32 kvd_byte_length;
+        u64 sgd_byte_offset;
+        u64 sgd_byte_length;
+    };
+
+    struct LevelIndex {
+        u64 byte_offset;
+        u64 byte_length;
+        u64 uncompressed_byte_length;
+    };
+
+    static_assert(sizeof(Header) == 80);
+    static_assert(sizeof(LevelIndex) == 24);
+}
+
+bool load_ktx2(const char* filename, ImageData* image_data) {
+    *image_data = {};
+
+    FILE* file = fopen(filename, "rb");
+    if(!file) {
+        printf("Could not open %s.\n", filename);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    Ktx2::Header header = {};
+    Ktx2::LevelIndex levels[ImageData::MAX_LEVELS] = {};
+    bool header_read = file_size >= static_cast<long>(sizeof(header)) && fread(&header, sizeof(header), 1, file) == 1;
+    if(!header_read || memcmp(header.identifier, Ktx2::IDENTIFIER, sizeof(Ktx2::IDENTIFIER)) != 0) {
+        printf("%s is not a KTX2 file.\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    ImageFormat format = static_cast<ImageFormat>(header.vk_format);
+    u32 level_count = header.level_count > 0 ? header.level_count : 1;
+    if(image_format_block_size(format) == 0 || header.supercompression_scheme != 0 || header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1 || level_count > ImageData::MAX_LEVELS) {
+        printf("%s is not a plain 2D texture in a supported format. [vkFormat %u, supercompression %u]\n", filename, header.vk_format, header.supercompression_scheme);
+        fclose(file);
+        return false;
+    }
+
+    if(fread(levels, sizeof(Ktx2::LevelIndex), level_count, file) != level_count) {
+        printf("%s has a truncated level index.\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    //Levels are packed back to back, largest first, each starting on 16 bytes so they can be copied as they are
+    u64 size = 0;
+    for(u32 level = 0; level < level_count; ++level) {
+        u32 level_width = header.pixel_width >> level ? header.pixel_width >> level : 1;
+        u32 level_height = header.pixel_height >> level ? header.pixel_height >> level : 1;
+        u64 level_size = image_level_size(format, level_width, level_height);
+        if(levels[level].byte_length != level_size || levels[level].byte_offset + level_size > static_cast<u64>(file_size)) {
+            printf("%s level %u is %llu bytes, expected %llu.\n", filename, level, (unsigned long long)levels[level].byte_length, (unsigned long long)level_size);
+            fclose(file);
+            return false;
+        }
+
+        image_data->level_offsets[level] = size;
+        image_data->level_sizes[level] = level_size;
+        size = (size + level_size + 15) & ~15ull;
+    }
+
+    image_data->pixels = (u8*)malloc(size);
+    if(!image_data->pixels) {
+        printf("malloc() failed. [%s, %llu bytes]\n", filename, (unsigned long long)size);
+        fclose(file);
+        return false;
+    }
+
+    for(u32 level = 0; level < level_count; ++level) {
+        fseek(file, static_cast<long>(levels[level].byte_offset), SEEK_SET);
+        if(fread(image_data->pixels + image_data->level_offsets[level], 1, image_data->level_sizes[level], file) != image_data->level_sizes[level]) {
+            printf("%s level %u could not be read.\n", filename, level);
+            image_free(image_data);
+            fclose(file);
+            return false;
+        }
+    }
+
+    fclose(file);
+
+    image_data->width = header.pixel_width;
+    image_data->height = header.pixel_height;
+    image_data->size = size;
+    image_data->format = format;
+    image_data->level_count = level_count;
+    image_data->memory = ImageMemory::HEAP;
+
+    return true;
+}
+
+//.ktx2 files are loaded as they are, block-compressed with their own mip chain. Anything else is decoded to RGBA8
 bool load_image(const char* filename, ImageData* image_data) {
+    size_t length = strlen(filename);
+    if(length > 5 && strcmp(filename + length - 5, ".ktx2") == 0) {
+        return load_ktx2(filename, image_data);
+    }
+
     i32 channels = 0;
     i32 width = 0;
     i32 height = 0;
+    *image_data = {};
     image_data->pixels = stbi_load(filename, &width, &height, &channels, 4);
-    image_data->size = width * height * 4;
+    if(!image_data->pixels) {
+        printf("Could not decode %s. [%s]\n", filename, stbi_failure_reason());
+        return false;
+    }
+
+    image_data->size = static_cast<u64>(width) * height * 4;
     image_data->width = width;
     image_data->height = height;
+    image_data->format = ImageFormat::RGBA8_SRGB;
+    image_data->level_count = 1;
+    image_data->level_sizes[0] = image_data->size;
+    image_data->memory = ImageMemory::STB;
     return true;
 }
\ No newline at end of file
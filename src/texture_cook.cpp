@@ -0,0 +1,415 @@
+//Offline texture cooker: decodes an image, builds its mip chain and writes it block-compressed into a KTX2 file that
+//load_image() uploads as it is. BC1 for opaque images, BC3 when any texel has partial alpha
+//Build: c++ -std=c++20 -O2 -I include src/texture_cook.cpp -o texture_cook
+//       cl -std:c++20 -O2 -EHsc -I ..\include ..\src\texture_cook.cpp
+//Usage: texture_cook <input.png> <output.ktx2> [--bc1 | --bc3] [--no-mips]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "types.h"
+#include "texture.h"
+
+struct CookLevel {
+    u8* pixels; //RGBA8
+    u32 width;
+    u32 height;
+    u8* blocks;
+    u64 block_size;
+};
+
+//Data Format Descriptor model and channel ids from the Khronos Data Format spec
+namespace Dfd {
+    static constexpr u32 MODEL_BC1A = 128;
+    static constexpr u32 MODEL_BC3 = 130;
+    static constexpr u32 CHANNEL_BC1A_ALPHA_PRESENT = 1;
+    static constexpr u32 CHANNEL_BC3_COLOR = 0;
+    static constexpr u32 CHANNEL_BC3_ALPHA = 15;
+    static constexpr u32 PRIMARIES_BT709 = 1;
+    static constexpr u32 TRANSFER_SRGB = 2;
+}
+
+static f32 srgb_to_linear_table[256];
+
+void build_srgb_table() {
+    for(u32 value = 0; value < 256; ++value) {
+        f32 srgb = static_cast<f32>(value) / 255.0f;
+        srgb_to_linear_table[value] = srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+u8 linear_to_srgb(f32 linear) {
+    f32 srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+    f32 scaled = srgb * 255.0f + 0.5f;
+    return static_cast<u8>(scaled < 0.0f ? 0.0f : (scaled > 255.0f ? 255.0f : scaled));
+}
+
+//2x2 box filter in linear light, odd edges clamp onto the last row or column
+bool downsample(CookLevel* source, CookLevel* destination) {
+    destination->width = source->width > 1 ? source->width / 2 : 1;
+    destination->height = source->height > 1 ? source->height / 2 : 1;
+    destination->pixels = (u8*)malloc(static_cast<size_t>(destination->width) * destination->height * 4);
+    if(!destination->pixels) {
+        printf("malloc() failed. [Mip level %ux%u]\n", destination->width, destination->height);
+        return false;
+    }
+
+    for(u32 y = 0; y < destination->height; ++y) {
+        for(u32 x = 0; x < destination->width; ++x) {
+            u32 x0 = std::min(x * 2, source->width - 1);
+            u32 x1 = std::min(x * 2 + 1, source->width - 1);
+            u32 y0 = std::min(y * 2, source->height - 1);
+            u32 y1 = std::min(y * 2 + 1, source->height - 1);
+            u8* taps[4] = {
+                source->pixels + (static_cast<size_t>(y0) * source->width + x0) * 4,
+                source->pixels + (static_cast<size_t>(y0) * source->width + x1) * 4,
+                source->pixels + (static_cast<size_t>(y1) * source->width + x0) * 4,
+                source->pixels + (static_cast<size_t>(y1) * source->width + x1) * 4
+            };
+
+            u8* out = destination->pixels + (static_cast<size_t>(y) * destination->width + x) * 4;
+            for(u32 channel = 0; channel < 3; ++channel) {
+                f32 sum = 0.0f;
+                for(u8* tap : taps) {
+                    sum += srgb_to_linear_table[tap[channel]];
+                }
+                out[channel] = linear_to_srgb(sum * 0.25f);
+            }
+            out[3] = static_cast<u8>((taps[0][3] + taps[1][3] + taps[2][3] + taps[3][3] + 2) / 4);
+        }
+    }
+
+    return true;
+}
+
+u16 pack_565(const f32 color[3]) {
+    u32 r = static_cast<u32>(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    u32 g = static_cast<u32>(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+    u32 b = static_cast<u32>(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    return static_cast<u16>((r << 11) | (g << 5) | b);
+}
+
+void unpack_565(u16 packed, f32 color[3]) {
+    color[0] = static_cast<f32>((packed >> 11) & 31) * 255.0f / 31.0f;
+    color[1] = static_cast<f32>((packed >> 5) & 63) * 255.0f / 63.0f;
+    color[2] = static_cast<f32>(packed & 31) * 255.0f / 31.0f;
+}
+
+//Endpoints are the extremes of the block along its principal axis, indices pick the nearest of the four palette colors
+void encode_bc1_block(u8 texels[16][4], u8* block) {
+    f32 mean[3] = {};
+    for(u32 texel = 0; texel < 16; ++texel) {
+        for(u32 channel = 0; channel < 3; ++channel) {
+            mean[channel] += texels[texel][channel] / 16.0f;
+        }
+    }
+
+    f32 covariance[6] = {}; //rr rg rb gg gb bb
+    for(u32 texel = 0; texel < 16; ++texel) {
+        f32 r = texels[texel][0] - mean[0];
+        f32 g = texels[texel][1] - mean[1];
+        f32 b = texels[texel][2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    //A few rounds of power iteration are plenty for a 3x3 matrix
+    f32 axis[3] = { 1.0f, 1.0f, 1.0f };
+    for(u32 iteration = 0; iteration < 8; ++iteration) {
+        f32 next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+        };
+        f32 length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if(length < 1e-6f) {
+            break;
+        }
+        axis[0] = next[0] / length;
+        axis[1] = next[1] / length;
+        axis[2] = next[2] / length;
+    }
+
+    f32 min_projection = 1e9f;
+    f32 max_projection = -1e9f;
+    for(u32 texel = 0; texel < 16; ++texel) {
+        f32 projection = (texels[texel][0] - mean[0]) * axis[0] + (texels[texel][1] - mean[1]) * axis[1] + (texels[texel][2] - mean[2]) * axis[2];
+        min_projection = std::min(min_projection, projection);
+        max_projection = std::max(max_projection, projection);
+    }
+
+    f32 low[3];
+    f32 high[3];
+    for(u32 channel = 0; channel < 3; ++channel) {
+        low[channel] = mean[channel] + axis[channel] * min_projection;
+        high[channel] = mean[channel] + axis[channel] * max_projection;
+    }
+
+    //color0 > color1 selects the opaque four color mode
+    u16 color0 = pack_565(high);
+    u16 color1 = pack_565(low);
+    if(color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    u32 indices = 0;
+    if(color0 != color1) {
+        f32 palette[4][3];
+        unpack_565(color0, palette[0]);
+        unpack_565(color1, palette[1]);
+        for(u32 channel = 0; channel < 3; ++channel) {
+            palette[2][channel] = (2.0f * palette[0][channel] + palette[1][channel]) / 3.0f;
+            palette[3][channel] = (palette[0][channel] + 2.0f * palette[1][channel]) / 3.0f;
+        }
+
+        for(u32 texel = 0; texel < 16; ++texel) {
+            u32 best_index = 0;
+            f32 best_error = 1e30f;
+            for(u32 index = 0; index < 4; ++index) {
+                f32 dr = texels[texel][0] - palette[index][0];
+                f32 dg = texels[texel][1] - palette[index][1];
+                f32 db = texels[texel][2] - palette[index][2];
+                f32 error = dr * dr + dg * dg + db * db;
+                if(error < best_error) {
+                    best_error = error;
+                    best_index = index;
+                }
+            }
+            indices |= best_index << (texel * 2);
+        }
+    }
+
+    block[0] = static_cast<u8>(color0 & 0xFF);
+    block[1] = static_cast<u8>(color0 >> 8);
+    block[2] = static_cast<u8>(color1 & 0xFF);
+    block[3] = static_cast<u8>(color1 >> 8);
+    memcpy(block + 4, &indices, 4);
+}
+
+//BC4 style: alpha0 > alpha1 selects eight interpolated levels between the block's extremes
+void encode_bc3_alpha_block(u8 texels[16][4], u8* block) {
+    u8 alpha_min = 255;
+    u8 alpha_max = 0;
+    for(u32 texel = 0; texel < 16; ++texel) {
+        alpha_min = std::min(alpha_min, texels[texel][3]);
+        alpha_max = std::max(alpha_max, texels[texel][3]);
+    }
+
+    u64 indices = 0;
+    if(alpha_max != alpha_min) {
+        f32 palette[8];
+        palette[0] = alpha_max;
+        palette[1] = alpha_min;
+        for(u32 index = 1; index < 7; ++index) {
+            palette[index + 1] = ((7 - index) * palette[0] + index * palette[1]) / 7.0f;
+        }
+
+        for(u32 texel = 0; texel < 16; ++texel) {
+            u64 best_index = 0;
+            f32 best_error = 1e30f;
+            for(u32 index = 0; index < 8; ++index) {
+                f32 error = fabsf(texels[texel][3] - palette[index]);
+                if(error < best_error) {
+                    best_error = error;
+                    best_index = index;
+                }
+            }
+            indices |= best_index << (texel * 3);
+        }
+    }
+
+    block[0] = alpha_max;
+    block[1] = alpha_min;
+    for(u32 byte = 0; byte < 6; ++byte) {
+        block[2 + byte] = static_cast<u8>(indices >> (byte * 8));
+    }
+}
+
+bool encode_level(CookLevel* level, ImageFormat format) {
+    u32 blocks_x = (level->width + 3) / 4;
+    u32 blocks_y = (level->height + 3) / 4;
+    u32 block_bytes = image_format_block_size(format);
+    level->block_size = image_level_size(format, level->width, level->height);
+    level->blocks = (u8*)malloc(level->block_size);
+    if(!level->blocks) {
+        printf("malloc() failed. [%llu bytes of blocks]\n", (unsigned long long)level->block_size);
+        return false;
+    }
+
+    for(u32 block_y = 0; block_y < blocks_y; ++block_y) {
+        for(u32 block_x = 0; block_x < blocks_x; ++block_x) {
+            //Blocks hanging over the edge repeat the last row and column
+            u8 texels[16][4];
+            for(u32 texel = 0; texel < 16; ++texel) {
+                u32 x = std::min(block_x * 4 + texel % 4, level->width - 1);
+                u32 y = std::min(block_y * 4 + texel / 4, level->height - 1);
+                memcpy(texels[texel], level->pixels + (static_cast<size_t>(y) * level->width + x) * 4, 4);
+            }
+
+            u8* block = level->blocks + (static_cast<size_t>(block_y) * blocks_x + block_x) * block_bytes;
+            if(format == ImageFormat::BC3_SRGB) {
+                encode_bc3_alpha_block(texels, block);
+                encode_bc1_block(texels, block + 8);
+            } else {
+                encode_bc1_block(texels, block);
+            }
+        }
+    }
+
+    return true;
+}
+
+void write_u32(u8* destination, u32 value) {
+    memcpy(destination, &value, 4);
+}
+
+//Levels go into the file smallest first, each aligned to its block size, as KTX2 requires
+bool write_ktx2(const char* filename, ImageFormat format, CookLevel* levels, u32 level_count) {
+    bool bc3 = format == ImageFormat::BC3_SRGB;
+    u32 sample_count = bc3 ? 2 : 1;
+    u32 block_bytes = image_format_block_size(format);
+
+    u8 dfd[4 + 24 + 2 * 16] = {};
+    u32 dfd_size = 4 + 24 + 16 * sample_count;
+    write_u32(dfd, dfd_size);
+    write_u32(dfd + 4, 0); //Khronos vendor, basic descriptor block
+    write_u32(dfd + 8, 2 | ((24 + 16 * sample_count) << 16));
+    write_u32(dfd + 12, (bc3 ? Dfd::MODEL_BC3 : Dfd::MODEL_BC1A) | (Dfd::PRIMARIES_BT709 << 8) | (Dfd::TRANSFER_SRGB << 16));
+    write_u32(dfd + 16, 3 | (3 << 8)); //4x4x1x1 texel blocks, stored minus one
+    write_u32(dfd + 20, block_bytes);
+    for(u32 sample = 0; sample < sample_count; ++sample) {
+        u8* sample_data = dfd + 28 + sample * 16;
+        u32 channel = bc3 ? (sample == 0 ? Dfd::CHANNEL_BC3_ALPHA : Dfd::CHANNEL_BC3_COLOR) : Dfd::CHANNEL_BC1A_ALPHA_PRESENT;
+        write_u32(sample_data, (sample * 64) | (63 << 16) | (channel << 24));
+        write_u32(sample_data + 12, UINT32_MAX);
+    }
+
+    Ktx2::Header header = {
+        .vk_format = static_cast<u32>(format),
+        .type_size = 1,
+        .pixel_width = levels[0].width,
+        .pixel_height = levels[0].height,
+        .pixel_depth = 0,
+        .layer_count = 0,
+        .face_count = 1,
+        .level_count = level_count,
+        .supercompression_scheme = 0,
+        .dfd_byte_offset = static_cast<u32>(sizeof(Ktx2::Header) + sizeof(Ktx2::LevelIndex) * level_count),
+        .dfd_byte_length = dfd_size
+    };
+    memcpy(header.identifier, Ktx2::IDENTIFIER, sizeof(Ktx2::IDENTIFIER));
+
+    Ktx2::LevelIndex level_index[ImageData::MAX_LEVELS] = {};
+    u64 offset = header.dfd_byte_offset + dfd_size;
+    for(u32 level = level_count; level-- > 0;) {
+        offset = (offset + block_bytes - 1) / block_bytes * block_bytes;
+        level_index[level] = { .byte_offset = offset, .byte_length = levels[level].block_size, .uncompressed_byte_length = levels[level].block_size };
+        offset += levels[level].block_size;
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if(!file) {
+        printf("Could not open %s for writing.\n", filename);
+        return false;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(level_index, sizeof(Ktx2::LevelIndex), level_count, file);
+    fwrite(dfd, 1, dfd_size, file);
+
+    static constexpr u8 zeros[16] = {};
+    u64 written = header.dfd_byte_offset + dfd_size;
+    for(u32 level = level_count; level-- > 0;) {
+        fwrite(zeros, 1, level_index[level].byte_offset - written, file);
+        fwrite(levels[level].blocks, 1, levels[level].block_size, file);
+        written = level_index[level].byte_offset + levels[level].block_size;
+    }
+
+    bool success = ferror(file) == 0;
+    fclose(file);
+    if(!success) {
+        printf("Writing %s failed.\n", filename);
+    }
+
+    return success;
+}
+
+int main(int argument_count, char** arguments) {
+    if(argument_count < 3) {
+        printf("Usage: texture_cook <input.png> <output.ktx2> [--bc1 | --bc3] [--no-mips]\n");
+        return 1;
+    }
+
+    bool force_bc1 = false;
+    bool force_bc3 = false;
+    bool mips = true;
+    for(i32 argument_index = 3; argument_index < argument_count; ++argument_index) {
+        if(strcmp(arguments[argument_index], "--bc1") == 0) {
+            force_bc1 = true;
+        } else if(strcmp(arguments[argument_index], "--bc3") == 0) {
+            force_bc3 = true;
+        } else if(strcmp(arguments[argument_index], "--no-mips") == 0) {
+            mips = false;
+        } else {
+            printf("Unknown option %s.\n", arguments[argument_index]);
+            return 1;
+        }
+    }
+
+    i32 width = 0;
+    i32 height = 0;
+    i32 channels = 0;
+    u8* pixels = stbi_load(arguments[1], &width, &height, &channels, 4);
+    if(!pixels) {
+        printf("Could not decode %s. [%s]\n", arguments[1], stbi_failure_reason());
+        return 1;
+    }
+
+    bool translucent = false;
+    for(size_t texel = 0; texel < static_cast<size_t>(width) * height; ++texel) {
+        translucent |= pixels[texel * 4 + 3] != 255;
+    }
+    ImageFormat format = force_bc3 || (translucent && !force_bc1) ? ImageFormat::BC3_SRGB : ImageFormat::BC1_RGBA_SRGB;
+
+    build_srgb_table();
+
+    CookLevel levels[ImageData::MAX_LEVELS] = {};
+    levels[0] = { .pixels = pixels, .width = static_cast<u32>(width), .height = static_cast<u32>(height) };
+    u32 level_count = 1;
+    while(mips && level_count < ImageData::MAX_LEVELS && (levels[level_count - 1].width > 1 || levels[level_count - 1].height > 1)) {
+        if(!downsample(&levels[level_count - 1], &levels[level_count])) {
+            return 1;
+        }
+        ++level_count;
+    }
+
+    u64 compressed_size = 0;
+    for(u32 level = 0; level < level_count; ++level) {
+        if(!encode_level(&levels[level], format)) {
+            return 1;
+        }
+        compressed_size += levels[level].block_size;
+    }
+
+    if(!write_ktx2(arguments[2], format, levels, level_count)) {
+        return 1;
+    }
+
+    u64 rgba_size = static_cast<u64>(width) * height * 4;
+    printf("%s: %dx%d %s, %u levels, %llu bytes (level 0 was %llu bytes as RGBA8)\n", arguments[2], width, height, format == ImageFormat::BC3_SRGB ? "BC3" : "BC1", level_count, (unsigned long long)compressed_size, (unsigned long long)rgba_size);
+
+    stbi_image_free(pixels);
+    for(u32 level = 0; level < level_count; ++level) {
+        if(level > 0) {
+            free(levels[level].pixels);
+        }
+        free(levels[level].blocks);
+    }
+
+    return 0;
+}
\ No newline at end of file
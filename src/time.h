@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <thread>
 #include "types.h"
 
 namespace Time {
@@ -44,4 +45,17 @@ void timer_consume(Timer* timer) {
         timer->accumulator -= timer->interval;
         ++timer->cycles;
     }
+}
+
+//OS sleeps overshoot by up to a scheduler tick, so the last SPIN_THRESHOLD is spent spinning
+void time_sleep_until(Time::Stamp wake) {
+    static constexpr Time::Duration SPIN_THRESHOLD = Time::Milliseconds(1);
+
+    if(wake - Time::Clock::now() > SPIN_THRESHOLD) {
+        std::this_thread::sleep_until(wake - SPIN_THRESHOLD);
+    }
+
+    while(Time::Clock::now() < wake) {
+        std::this_thread::yield();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include "types.h"
+#include "time.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define TRACE_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+//Chrome trace (chrome://tracing, ui.perfetto.dev) recording. Every thread appends to its own fixed-size buffer, so
+//recording takes no locks. Names must be string literals, only the pointer is stored
+struct TraceEvent {
+    const char* name;
+    u64 timestamp; //trace_timestamp() ticks
+    char phase; //'B'egin or 'E'nd
+};
+
+struct TraceBuffer {
+    static constexpr size_t CAPACITY = 1 << 18;
+
+    TraceEvent* events = nullptr;
+    size_t count = 0;
+    size_t dropped = 0;
+    u32 thread_id = 0;
+    const char* thread_name = nullptr;
+};
+
+struct Trace {
+    static constexpr size_t MAX_THREADS = 64;
+
+    std::atomic<bool> enabled = false;
+    std::atomic<u32> thread_count = 0;
+    TraceBuffer buffers[MAX_THREADS];
+    Time::Stamp start = {};
+    u64 start_ticks = 0; //trace_timestamp() at start, converted against the clock when written
+    const char* output_path = nullptr;
+};
+
+static Trace global_trace;
+static thread_local TraceBuffer* trace_thread_buffer = nullptr;
+static thread_local bool trace_thread_failed = false; //Registration failed once, the thread records nothing
+
+//The TSC where available, reading steady_clock costs about as much as the whole 50 ns event budget on some systems.
+//Assumes an invariant TSC, which every x64 CPU of the last decade has
+u64 trace_timestamp() {
+#if defined(TRACE_TSC)
+    return __rdtsc();
+#else
+    return static_cast<u64>(Time::Clock::now().time_since_epoch().count());
+#endif
+}
+
+//Claims a buffer for the calling thread. Threads that record without registering are named by their id. A thread that
+//can't get a buffer is told once and isn't retried, trace_record() keeps calling this
+TraceBuffer* trace_register_thread(const char* thread_name) {
+    if(trace_thread_buffer || trace_thread_failed) {
+        return trace_thread_buffer;
+    }
+    trace_thread_failed = true;
+
+    if(global_trace.thread_count.load(std::memory_order_relaxed) >= Trace::MAX_THREADS) {
+        printf("trace_register_thread() failed. [More than %zd threads]\n", Trace::MAX_THREADS);
+        return nullptr;
+    }
+
+    TraceEvent* events = (TraceEvent*)malloc(sizeof(TraceEvent) * TraceBuffer::CAPACITY);
+    if(!events) {
+        printf("malloc() failed. [TraceBuffer %zd events]\n", TraceBuffer::CAPACITY);
+        return nullptr;
+    }
+
+    //The slot is only claimed once the buffer exists, so failures neither use one up nor push thread_count past MAX_THREADS
+    u32 thread_index = global_trace.thread_count.load(std::memory_order_relaxed);
+    while(thread_index < Trace::MAX_THREADS && !global_trace.thread_count.compare_exchange_weak(thread_index, thread_index + 1, std::memory_order_relaxed)) {
+    }
+    if(thread_index >= Trace::MAX_THREADS) {
+        free(events);
+        printf("trace_register_thread() failed. [More than %zd threads]\n", Trace::MAX_THREADS);
+        return nullptr;
+    }
+
+    //Touch every page now so recording never takes a page fault
+    memset(events, 0, sizeof(TraceEvent) * TraceBuffer::CAPACITY);
+    TraceBuffer* buffer = &global_trace.buffers[thread_index];
+    buffer->events = events;
+    buffer->thread_id = thread_index + 1;
+    buffer->thread_name = thread_name;
+
+    trace_thread_failed = false;
+    trace_thread_buffer = buffer;
+    return buffer;
+}
+
+//Turns recording on for the rest of the run. trace_write() saves everything to output_path
+bool trace_start(const char* output_path) {
+    global_trace.start = Time::Clock::now();
+    global_trace.start_ticks = trace_timestamp();
+    global_trace.output_path = output_path;
+    if(!trace_register_thread("Main")) {
+        return false;
+    }
+
+    global_trace.enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void trace_record(const char* name, char phase) {
+    if(!global_trace.enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    TraceBuffer* buffer = trace_thread_buffer ? trace_thread_buffer : trace_register_thread(nullptr);
+    if(!buffer) {
+        return;
+    }
+
+    if(buffer->count == TraceBuffer::CAPACITY) {
+        ++buffer->dropped;
+        return;
+    }
+
+    buffer->events[buffer->count++] = { .name = name, .timestamp = trace_timestamp(), .phase = phase };
+}
+
+void trace_begin(const char* name) {
+    trace_record(name, 'B');
+}
+
+void trace_end(const char* name) {
+    trace_record(name, 'E');
+}
+
+//Begin/end pair for the enclosing scope
+struct TraceScope {
+    const char* name;
+
+    explicit TraceScope(const char* name) : name(name) { trace_begin(name); }
+    ~TraceScope() { trace_end(name); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+//Call once every recording thread has finished
+bool trace_write() {
+    if(!global_trace.enabled.load(std::memory_order_acquire)) {
+        return true;
+    }
+    global_trace.enabled.store(false, std::memory_order_relaxed);
+
+    //Ticks per microsecond measured over the whole run
+    f64 elapsed_us = static_cast<f64>(std::chrono::duration_cast<Time::Nanoseconds>(Time::Clock::now() - global_trace.start).count()) / 1000.0;
+    f64 elapsed_ticks = static_cast<f64>(trace_timestamp() - global_trace.start_ticks);
+    f64 ticks_per_us = elapsed_us > 0.0 && elapsed_ticks > 0.0 ? elapsed_ticks / elapsed_us : 1000.0;
+
+    FILE* trace_file = fopen(global_trace.output_path, "wb");
+    if(!trace_file) {
+        printf("Could not open %s for writing.\n", global_trace.output_path);
+        return false;
+    }
+
+    size_t event_count = 0;
+    size_t dropped_count = 0;
+    bool first_event = true;
+    fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    u32 thread_count = global_trace.thread_count.load(std::memory_order_acquire);
+    thread_count = thread_count < Trace::MAX_THREADS ? thread_count : static_cast<u32>(Trace::MAX_THREADS);
+    for(u32 thread_index = 0; thread_index < thread_count; ++thread_index) {
+        TraceBuffer* buffer = &global_trace.buffers[thread_index];
+        if(!buffer->events) {
+            continue;
+        }
+
+        if(buffer->thread_name) {
+            fprintf(trace_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first_event ? "" : ",\n", buffer->thread_id, buffer->thread_name);
+            first_event = false;
+        }
+
+        for(size_t event_index = 0; event_index < buffer->count; ++event_index) {
+            TraceEvent* event = &buffer->events[event_index];
+            f64 timestamp_us = static_cast<f64>(event->timestamp - global_trace.start_ticks) / ticks_per_us;
+            fprintf(trace_file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", first_event ? "" : ",\n", event->name, event->phase, timestamp_us, buffer->thread_id);
+            first_event = false;
+        }
+
+        event_count += buffer->count;
+        dropped_count += buffer->dropped;
+        free(buffer->events);
+        buffer->events = nullptr;
+    }
+
+    fprintf(trace_file, "\n]}\n");
+    fclose(trace_file);
+
+    printf("Trace written to %s. [%zd events, %zd dropped]\n", global_trace.output_path, event_count, dropped_count);
+
+    return true;
+}
\ No newline at end of file
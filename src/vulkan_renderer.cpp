@@ -1,27 +1,55 @@
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <vector>
 #include "vulkan_renderer.h"
 
+//Scratch memory. Functions open a TempScope on it, draw_frame() resets it at the start of every frame
 static MemoryArena* temporary_memory = nullptr;
 
 VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_renderer");
 
     VulkanRenderer* renderer = vulkan_renderer_init_info->renderer;
+    renderer->offscreen = vulkan_renderer_init_info->offscreen;
+    renderer->frame_pacing = vulkan_renderer_init_info->frame_pacing;
+    renderer->swapchain.frames_in_flight = std::clamp<size_t>(renderer->frame_pacing.frames_in_flight, 1, Swapchain::MAX_FRAMES_IN_FLIGHT);
     renderer->heap_data = memory_arena_create(MB(500));
     temporary_memory = memory_arena_create(MB(500));
 
+    renderer->job_pool = job_pool_create(renderer->heap_data, vulkan_renderer_init_info->worker_count);
+    if(!renderer->job_pool) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+        printf("job_pool_create() failed.\n");
+        return result;
+    }
+
+    const char* asset_pack_path = vulkan_renderer_init_info->asset_pack_path;
+    if(asset_pack_path && asset_pack_open(asset_pack_path, &renderer->asset_pack)) {
+        printf("Mapped %s. [%u assets]\n", asset_pack_path, renderer->asset_pack.header->entry_count);
+    } else {
+        printf("No asset pack, loading loose files.\n");
+    }
+
     result = create_instance(vulkan_renderer_init_info);
     if(result != VK_SUCCESS) {
         printf("create_instance() failed.\n");
         return result;
     }
 
-    result = create_win32_surface(vulkan_renderer_init_info);
-    if(result != VK_SUCCESS) {
-        printf("create_win32_surface failed.\n");
-        return result;
+    if(!renderer->offscreen) {
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+        result = create_win32_surface(vulkan_renderer_init_info);
+        if(result != VK_SUCCESS) {
+            printf("create_win32_surface failed.\n");
+            return result;
+        }
+#else
+        printf("No window surface available on this platform. [Use offscreen mode]\n");
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+#endif
     }
 
     result = choose_physical_device(renderer);
@@ -50,25 +78,76 @@ VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info) {
         return result;
     }
 
-    //Let's revisit this and customize to our liking, this is basically defaults from the tutorial
-    result = query_swapchain_support(renderer);
+    renderer->gpu_allocator = (GpuAllocator*)memory_arena_allocate(renderer->heap_data, sizeof(GpuAllocator));
+    if(!renderer->gpu_allocator) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("memory_arena_allocate() failed. [GpuAllocator]\n");
+        return result;
+    }
+    gpu_allocator_create(renderer->gpu_allocator, renderer->devices.logical.device, renderer->devices.physical.device);
+
+    result = create_deletion_queue(renderer);
     if(result != VK_SUCCESS) {
-        printf("query_swapchain_support() failed.\n");
+        printf("create_deletion_queue() failed.\n");
         return result;
     }
 
-    result = create_swapchain(renderer);
+    if(renderer->offscreen) {
+        renderer->swapchain.extent = {
+            .width = vulkan_renderer_init_info->offscreen_resolution.width,
+            .height = vulkan_renderer_init_info->offscreen_resolution.height
+        };
+
+        result = create_offscreen_targets(renderer);
+        if(result != VK_SUCCESS) {
+            printf("create_offscreen_targets() failed.\n");
+            return result;
+        }
+    } else {
+        //Let's revisit this and customize to our liking, this is basically defaults from the tutorial
+        result = query_swapchain_support(renderer);
+        if(result != VK_SUCCESS) {
+            printf("query_swapchain_support() failed.\n");
+            return result;
+        }
+
+        result = create_swapchain(renderer);
+        if(result != VK_SUCCESS) {
+            printf("create_swapchain() failed.\n");
+            return result;
+        }
+
+        printf("Frame pacing: %zd frames in flight, %zd images, %s\n", renderer->swapchain.frames_in_flight, renderer->swapchain.images.count, string_VkPresentModeKHR(renderer->swapchain.present_mode));
+    }
+
+    //The pipeline layout needs the bindless texture set layout
+    result = create_texture_atlas(renderer);
     if(result != VK_SUCCESS) {
-        printf("create_swapchain() failed.\n");
+        printf("create_texture_atlas() failed.\n");
+        return result;
+    }
+
+    result = create_pipeline_cache(renderer);
+    if(result != VK_SUCCESS) {
+        printf("create_pipeline_cache() failed.\n");
         return result;
     }
 
+    Time::Stamp pipeline_start = Time::Clock::now();
+
     result = create_graphics_pipeline(renderer);
     if(result != VK_SUCCESS) {
         printf("create_graphics_pipeline() failed.\n");
         return result;
     }
 
+    renderer->pipeline_cache.creation_time = Time::Clock::now() - pipeline_start;
+    printf("Pipeline creation: %.3f ms [%s cache]\n", static_cast<f64>(renderer->pipeline_cache.creation_time.count()) / 1'000'000.0, renderer->pipeline_cache.warm ? "warm" : "cold");
+
+    if(vulkan_renderer_init_info->shader_hot_reload) {
+        shader_reload_start(renderer);
+    }
+
     result = create_frame_buffers(renderer);
     if(result != VK_SUCCESS) {
         printf("create_frame_buffers() failed.\n");
@@ -81,12 +160,23 @@ VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info) {
         return result;
     }
 
+    result = create_timeline(renderer, &renderer->graphics_timeline);
+    if(result != VK_SUCCESS) {
+        printf("create_timeline() failed. [Graphics]\n");
+        return result;
+    }
+
+    result = create_timeline(renderer, &renderer->transfer_timeline);
+    if(result != VK_SUCCESS) {
+        printf("create_timeline() failed. [Transfer]\n");
+        return result;
+    }
+
     CommandBufferAllocationInfo draw_frame_command_buffer_allocation_info = {
         .pool_type = QueueFamilies::Type::GRAPHICS,
         .graphics_buffer_type = CommandBuffers::Graphics::DRAW_FRAME,
-        .buffer_count = renderer->swapchain.MAX_FRAMES_IN_FLIGHT,
-        .semaphore_count = 2,
-        .fence_count = 1
+        .buffer_count = Swapchain::MAX_FRAMES_IN_FLIGHT,
+        .semaphore_count = 2
     };
 
     result = allocate_command_buffers(renderer, &draw_frame_command_buffer_allocation_info);
@@ -99,8 +189,7 @@ VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info) {
         .pool_type = QueueFamilies::Type::GRAPHICS,
         .graphics_buffer_type = CommandBuffers::Graphics::TRANSITION_IMAGE_LAYOUT,
         .buffer_count = 1,
-        .semaphore_count = 0,
-        .fence_count = 0
+        .semaphore_count = 0
     };
 
     result = allocate_command_buffers(renderer, &transition_image_layout_command_buffer_allocation_info);
@@ -109,31 +198,15 @@ VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info) {
         return result;
     }
 
-    CommandBufferAllocationInfo buffer_to_buffer_command_buffer_allocation_info = {
-        .pool_type = QueueFamilies::Type::TRANSFER,
-        .transfer_buffer_type = CommandBuffers::Transfer::BUFFER_TO_BUFFER,
-        .buffer_count = 1,
-        .semaphore_count = 0,
-        .fence_count = 0
-    };
-
-    result = allocate_command_buffers(renderer, &buffer_to_buffer_command_buffer_allocation_info);
+    result = create_upload_manager(renderer);
     if(result != VK_SUCCESS) {
-        printf("allocate_command_buffers() [CommandBuffers::Transfer::BUFFER_TO_BUFFER] failed.\n");
+        printf("create_upload_manager() failed.\n");
         return result;
     }
 
-    CommandBufferAllocationInfo buffer_to_image_command_buffer_allocation_info = {
-        .pool_type = QueueFamilies::Type::TRANSFER,
-        .transfer_buffer_type = CommandBuffers::Transfer::BUFFER_TO_IMAGE,
-        .buffer_count = 1,
-        .semaphore_count = 0,
-        .fence_count = 0
-    };
-
-    result = allocate_command_buffers(renderer, &buffer_to_image_command_buffer_allocation_info);
+    result = create_gpu_timestamps(renderer);
     if(result != VK_SUCCESS) {
-        printf("allocate_command_buffers() failed.\n");
+        printf("create_gpu_timestamps() failed.\n");
         return result;
     }
 
@@ -149,21 +222,38 @@ VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info) {
         return result;
     }
 
-    result = create_uniform_buffers(renderer);
+    result = create_upload_ring(renderer);
     if(result != VK_SUCCESS) {
-        printf("create_index_buffer() failed.\n");
+        printf("create_upload_ring() failed.\n");
         return result;
     }
 
-    result = create_texture_atlas(renderer);
+    result = load_texture(renderer, "textures/pepe.png", nullptr);
     if(result != VK_SUCCESS) {
-        printf("create_texture_atlas() failed.\n");
+        printf("load_texture() failed.\n");
         return result;
     }
 
-    result = load_texture(renderer, "textures/pepe.png");
+    result = build_texture_atlas(renderer);
     if(result != VK_SUCCESS) {
-        printf("load_texture() failed.\n");
+        printf("build_texture_atlas() failed.\n");
+        return result;
+    }
+
+    renderer->sprite_batch = sprite_batch_create(renderer->heap_data, VulkanRenderer::MAX_SPRITES);
+    if(!renderer->sprite_batch) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("sprite_batch_create() failed.\n");
+        return result;
+    }
+
+    //Stands in for the single quad the renderer drew before sprites were instanced
+    create_sprite(renderer, 0);
+
+    //Everything above went into one batch, the first frame's submit is queued behind it without the CPU waiting
+    result = upload_manager_flush(renderer);
+    if(result != VK_SUCCESS) {
+        printf("upload_manager_flush() failed.\n");
         return result;
     }
 
@@ -179,13 +269,110 @@ VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info) {
         return result;
     }
 
-    memory_arena_free(temporary_memory);
+    gpu_allocator_print_stats(renderer->gpu_allocator);
+
+    memory_arena_reset(temporary_memory);
 
     return result;
 }
 
+//Everything goes through the deletion queue first, drained with the device idle, then the objects it doesn't cover
+//Also tears down a renderer that create_renderer() gave up on part way, whatever it didn't get to is still null
+void destroy_renderer(VulkanRenderer* renderer) {
+    if(renderer->devices.logical.device != VK_NULL_HANDLE) {
+        destroy_device(renderer);
+    }
+
+    if(renderer->surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(renderer->instance, renderer->surface, nullptr);
+        renderer->surface = VK_NULL_HANDLE;
+    }
+    vkDestroyInstance(renderer->instance, nullptr);
+    renderer->instance = VK_NULL_HANDLE;
+
+    if(renderer->job_pool) {
+        job_pool_destroy(renderer->job_pool);
+        renderer->job_pool = nullptr;
+    }
+    asset_pack_close(&renderer->asset_pack);
+    if(renderer->heap_data) {
+        memory_arena_free(renderer->heap_data);
+        renderer->heap_data = nullptr;
+    }
+    if(temporary_memory) {
+        memory_arena_free(temporary_memory);
+        temporary_memory = nullptr;
+    }
+}
+
+//Everything made from the logical device, the device last
+void destroy_device(VulkanRenderer* renderer) {
+    VkDevice device = renderer->devices.logical.device;
+    shader_reload_destroy(renderer);
+    vkDeviceWaitIdle(device);
+    destroy_pipeline_cache(renderer);
+
+    //Pipelines themselves belong to the pipeline cache
+    GraphicsPipeline* pipeline = &renderer->graphics_pipeline;
+    DeletionQueue::Entry pipeline_entries[] = {
+        { .kind = DeletionQueue::Kind::DESCRIPTOR_POOL, .handle = { .descriptor_pool = pipeline->descriptor_pool } },
+        { .kind = DeletionQueue::Kind::RENDER_PASS, .handle = { .render_pass = pipeline->render_pass } }
+    };
+    for(DeletionQueue::Entry& entry : pipeline_entries) {
+        deletion_queue_push(renderer, &entry);
+    }
+    defer_destroy_buffer(renderer, &pipeline->vertex_buffer);
+    defer_destroy_buffer(renderer, &pipeline->index_buffer);
+    destroy_layout_cache(renderer);
+
+    for(size_t page_index = 0; page_index < renderer->texture_atlas.page_count; ++page_index) {
+        defer_destroy_texture(renderer, &renderer->texture_atlas.pages[page_index]);
+    }
+    for(size_t region_index = renderer->texture_atlas.built_region_count; region_index < renderer->texture_atlas.region_count; ++region_index) {
+        image_free(&renderer->texture_atlas.region_images[region_index]);
+    }
+    DeletionQueue::Entry texture_atlas_entries[] = {
+        { .kind = DeletionQueue::Kind::SAMPLER, .handle = { .sampler = renderer->texture_atlas.sampler } },
+        { .kind = DeletionQueue::Kind::DESCRIPTOR_POOL, .handle = { .descriptor_pool = renderer->texture_atlas.descriptor_pool } },
+        { .kind = DeletionQueue::Kind::DESCRIPTOR_SET_LAYOUT, .handle = { .descriptor_set_layout = renderer->texture_atlas.set_layout } }
+    };
+    for(DeletionQueue::Entry& entry : texture_atlas_entries) {
+        deletion_queue_push(renderer, &entry);
+    }
+
+    defer_destroy_buffer(renderer, &renderer->upload_ring.buffer);
+    defer_destroy_buffer(renderer, &renderer->upload_manager.staging);
+
+    destroy_swapchain_images(renderer, &renderer->swapchain.images, true);
+    DeletionQueue::Entry swapchain_entry = { .kind = DeletionQueue::Kind::SWAPCHAIN, .handle = { .swapchain = renderer->swapchain.swapchain } };
+    deletion_queue_push(renderer, &swapchain_entry);
+
+    deletion_queue_collect(renderer, true);
+
+    CommandBuffers* draw_frame_buffers = &renderer->command_pools[static_cast<size_t>(QueueFamilies::Type::GRAPHICS)].buffers[static_cast<size_t>(CommandBuffers::Graphics::DRAW_FRAME)];
+    for(size_t frame_index = 0; frame_index < Swapchain::MAX_FRAMES_IN_FLIGHT; ++frame_index) {
+        vkDestroySemaphore(device, draw_frame_buffers->synchro[frame_index].semaphores[0], nullptr);
+        vkDestroySemaphore(device, draw_frame_buffers->synchro[frame_index].semaphores[1], nullptr);
+    }
+    vkDestroySemaphore(device, renderer->graphics_timeline.semaphore, nullptr);
+    vkDestroySemaphore(device, renderer->transfer_timeline.semaphore, nullptr);
+    vkDestroyQueryPool(device, renderer->gpu_timestamps.pool, nullptr);
+
+    //Frees every command buffer allocated from them
+    for(size_t command_pool_index = 0; command_pool_index < QueueFamilies::MAX_QUEUE_FAMILIES; ++command_pool_index) {
+        vkDestroyCommandPool(device, renderer->command_pools[command_pool_index].pool, nullptr);
+    }
+
+    if(renderer->gpu_allocator) {
+        gpu_allocator_destroy(renderer->gpu_allocator);
+    }
+    vkDestroyDevice(device, nullptr);
+    renderer->devices.logical.device = VK_NULL_HANDLE;
+}
+
 VkResult create_instance(VulkanRendererInitInfo* vulkan_renderer_init_info) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_instance");
 
     VkApplicationInfo application_info = {
         .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -203,7 +390,13 @@ VkResult create_instance(VulkanRendererInitInfo* vulkan_renderer_init_info) {
 
     // vkEnumerateInstanceExtensionProperties(nullptr, &instance_property_count, instance_properties);
 
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
     const char* extension_names[] = { "VK_KHR_surface", "VK_KHR_win32_surface" };
+    u32 extension_count = vulkan_renderer_init_info->offscreen ? 0 : 2;
+#else
+    const char** extension_names = nullptr;
+    u32 extension_count = 0;
+#endif
 
     // for(u32 property_index = 0; property_index < instance_property_count; ++property_index) {
     //     printf("Extension: %s\n", instance_properties[property_index].extensionName);
@@ -216,7 +409,7 @@ VkResult create_instance(VulkanRendererInitInfo* vulkan_renderer_init_info) {
         .pApplicationInfo = &application_info,
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = nullptr,
-        .enabledExtensionCount = 2,
+        .enabledExtensionCount = extension_count,
         .ppEnabledExtensionNames = extension_names
     };
 
@@ -229,6 +422,7 @@ VkResult create_instance(VulkanRendererInitInfo* vulkan_renderer_init_info) {
     return result;
 }
 
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
 VkResult create_win32_surface(VulkanRendererInitInfo* vulkan_renderer_init_info) {
     VkResult result = VK_ERROR_UNKNOWN;
 
@@ -248,9 +442,12 @@ VkResult create_win32_surface(VulkanRendererInitInfo* vulkan_renderer_init_info)
 
     return result;
 }
+#endif
 
 VkResult choose_physical_device(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("choose_physical_device");
+    TempScope scratch(temporary_memory);
 
     size_t device_count = 0;
     result = vkEnumeratePhysicalDevices(renderer->instance, reinterpret_cast<u32*>(&device_count), nullptr);
@@ -259,7 +456,7 @@ VkResult choose_physical_device(VulkanRenderer* renderer) {
         return result;
     }
 
-    VkPhysicalDevice* physical_devices = (VkPhysicalDevice*)memory_arena_allocate(temporary_memory, sizeof(VkPhysicalDevice) * device_count);
+    VkPhysicalDevice* physical_devices = push_array<VkPhysicalDevice>(temporary_memory, device_count);
     result = vkEnumeratePhysicalDevices(renderer->instance, reinterpret_cast<u32*>(&device_count), physical_devices);
     if(result != VK_SUCCESS) {
         printf("vkEnumeratePhysicalDevices() failed.\n");
@@ -280,11 +477,12 @@ VkResult choose_physical_device(VulkanRenderer* renderer) {
 
 VkResult query_queue_families(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TempScope scratch(temporary_memory);
 
     size_t queue_family_count = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(renderer->devices.physical.device, reinterpret_cast<u32*>(&queue_family_count), nullptr);
 
-    VkQueueFamilyProperties* queue_family_properties_list = (VkQueueFamilyProperties*)memory_arena_allocate(temporary_memory, sizeof(VkQueueFamilyProperties) * queue_family_count);
+    VkQueueFamilyProperties* queue_family_properties_list = push_array<VkQueueFamilyProperties>(temporary_memory, queue_family_count);
     vkGetPhysicalDeviceQueueFamilyProperties(renderer->devices.physical.device, reinterpret_cast<u32*>(&queue_family_count), queue_family_properties_list);
 
     for(size_t queue_family_index = 0; queue_family_index < queue_family_count; ++queue_family_index) {
@@ -302,11 +500,15 @@ VkResult query_queue_families(VulkanRenderer* renderer) {
         size_t transfer_index = static_cast<size_t>(QueueFamilies::Type::TRANSFER);
         if((queue_family_properties_list[queue_family_index].queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
            !(renderer->queue_families.populated_families & (1 << graphics_index))) {
-            result = vkGetPhysicalDeviceSurfaceSupportKHR(renderer->devices.physical.device, static_cast<u32>(queue_family_index), renderer->surface, &queue_family.surface_support);
-            if(result != VK_SUCCESS) {
-                printf("vkGetPhysicalDeviceSurfaceSupportKHR() failed.\n");
-                //free(queue_family_properties_list);
-                return result;
+            if(renderer->surface != VK_NULL_HANDLE) {
+                result = vkGetPhysicalDeviceSurfaceSupportKHR(renderer->devices.physical.device, static_cast<u32>(queue_family_index), renderer->surface, &queue_family.surface_support);
+                if(result != VK_SUCCESS) {
+                    printf("vkGetPhysicalDeviceSurfaceSupportKHR() failed.\n");
+                    //free(queue_family_properties_list);
+                    return result;
+                }
+            } else {
+                result = VK_SUCCESS;
             }
 
             renderer->queue_families.families[graphics_index] = queue_family;
@@ -319,18 +521,41 @@ VkResult query_queue_families(VulkanRenderer* renderer) {
         }
     }
 
+    //Software implementations (lavapipe) and some integrated GPUs expose a single family, so transfers share the graphics family
+    size_t graphics_index = static_cast<size_t>(QueueFamilies::Type::GRAPHICS);
+    size_t transfer_index = static_cast<size_t>(QueueFamilies::Type::TRANSFER);
+    if((renderer->queue_families.populated_families & (1 << graphics_index)) && !(renderer->queue_families.populated_families & (1 << transfer_index))) {
+        renderer->queue_families.families[transfer_index] = renderer->queue_families.families[graphics_index];
+        renderer->queue_families.populated_families |= (1 << transfer_index);
+    }
+
     //free(queue_family_properties_list);
     return result;
 }
 
 VkResult create_logical_device(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_logical_device");
+    TempScope scratch(temporary_memory);
 
     std::vector<const char*> device_extensions = {};
 
-    VkDeviceQueueCreateInfo* queue_create_infos = (VkDeviceQueueCreateInfo*)memory_arena_allocate(temporary_memory, sizeof(VkDeviceQueueCreateInfo) * QueueFamilies::MAX_QUEUE_FAMILIES);
+    u32 queue_create_info_count = 0;
+    VkDeviceQueueCreateInfo* queue_create_infos = push_array<VkDeviceQueueCreateInfo>(temporary_memory, QueueFamilies::MAX_QUEUE_FAMILIES);
     for(size_t queue_family_index = 0; queue_family_index < QueueFamilies::MAX_QUEUE_FAMILIES; ++queue_family_index) {
-        queue_create_infos[queue_family_index] = {
+        //A family may back more than one QueueFamilies::Type, but can only be requested once
+        bool already_requested = false;
+        for(size_t create_info_index = 0; create_info_index < queue_create_info_count; ++create_info_index) {
+            if(queue_create_infos[create_info_index].queueFamilyIndex == renderer->queue_families.families[queue_family_index].index) {
+                already_requested = true;
+            }
+        }
+
+        if(already_requested) {
+            continue;
+        }
+
+        queue_create_infos[queue_create_info_count++] = {
             .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
@@ -343,7 +568,7 @@ VkResult create_logical_device(VulkanRenderer* renderer) {
     size_t extension_properties_count = 0;
     vkEnumerateDeviceExtensionProperties(renderer->devices.physical.device, nullptr, reinterpret_cast<u32*>(&extension_properties_count), nullptr);
 
-    VkExtensionProperties* extension_properties = (VkExtensionProperties*)memory_arena_allocate(temporary_memory, sizeof(VkExtensionProperties) * extension_properties_count);
+    VkExtensionProperties* extension_properties = push_array<VkExtensionProperties>(temporary_memory, extension_properties_count);
     vkEnumerateDeviceExtensionProperties(renderer->devices.physical.device, nullptr, reinterpret_cast<u32*>(&extension_properties_count), extension_properties);
 
     for(size_t extension_index = 0; extension_index < extension_properties_count; ++extension_index) {
@@ -361,13 +586,34 @@ VkResult create_logical_device(VulkanRenderer* renderer) {
         .pNext = nullptr
     };
 
+    VkPhysicalDeviceVulkan12Features vulkan_12_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = &pageable_device_local_memory_feature_extension
+    };
+
     VkPhysicalDeviceFeatures2 physical_device_features = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
-        .pNext = &pageable_device_local_memory_feature_extension
+        .pNext = &vulkan_12_features
     };
 
     vkGetPhysicalDeviceFeatures2(renderer->devices.physical.device, &physical_device_features);
 
+    //Frame pacing and uploads are built on timeline semaphores, mandatory since 1.2
+    if(vulkan_12_features.timelineSemaphore != VK_TRUE) {
+        result = VK_ERROR_FEATURE_NOT_PRESENT;
+        printf("Timeline semaphores are not supported.\n");
+        return result;
+    }
+
+    //Bindless textures: a runtime-sized sampler2D array, indexed per instance, filled in as textures load
+    if(vulkan_12_features.runtimeDescriptorArray != VK_TRUE || vulkan_12_features.shaderSampledImageArrayNonUniformIndexing != VK_TRUE ||
+       vulkan_12_features.descriptorBindingPartiallyBound != VK_TRUE || vulkan_12_features.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE ||
+       vulkan_12_features.descriptorBindingVariableDescriptorCount != VK_TRUE) {
+        result = VK_ERROR_FEATURE_NOT_PRESENT;
+        printf("Descriptor indexing is not supported. [Bindless textures]\n");
+        return result;
+    }
+
     if(pageable_device_local_memory_feature_extension.pageableDeviceLocalMemory == VK_TRUE) {
         device_extensions.push_back(VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME);
     }
@@ -376,7 +622,7 @@ VkResult create_logical_device(VulkanRenderer* renderer) {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .pNext = &physical_device_features,
         .flags = 0,
-        .queueCreateInfoCount = QueueFamilies::MAX_QUEUE_FAMILIES,
+        .queueCreateInfoCount = queue_create_info_count,
         .pQueueCreateInfos = queue_create_infos,
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = nullptr,
@@ -455,32 +701,25 @@ VkResult query_swapchain_support(VulkanRenderer* renderer) {
         return result;
     }
 
-    //printf("Present Modes supported:\n");
-    renderer->swapchain.present_mode = VK_PRESENT_MODE_FIFO_KHR;
-    for(size_t i = 0; i < present_mode_count; ++i) {
-        VkPresentModeKHR present_mode = renderer->swapchain.support_info.present_modes[i];
-
-        //printf("%s\n", string_VkPresentModeKHR(present_mode));
-        if(present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            renderer->swapchain.present_mode = present_mode;
-        }
-    }
-    //printf("Selected Present Mode: %s\n", string_VkPresentModeKHR(renderer->swapchain.present_mode));
+    //The mode itself is picked in create_swapchain() from the FramePacingConfig
+    renderer->swapchain.support_info.present_mode_count = present_mode_count;
 
     return result;
 }
 
 VkResult create_swapchain(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_swapchain");
 
     renderer->swapchain.extent = renderer->swapchain.support_info.capabilities.currentExtent;
+    renderer->swapchain.present_mode = choose_present_mode(renderer, renderer->frame_pacing.present_mode);
 
     VkSwapchainCreateInfoKHR swapchain_create_info = {
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
         .pNext = nullptr,
         .flags = 0,
         .surface = renderer->surface,
-        .minImageCount = renderer->swapchain.support_info.capabilities.minImageCount + 1, //Adding +1 to the minimum image count allots us an extra frame to render to. Freeing us from waiting on device operations between frames.
+        .minImageCount = choose_image_count(renderer, renderer->frame_pacing.image_count),
         .imageFormat = renderer->swapchain.surface_format.format,
         .imageColorSpace = renderer->swapchain.surface_format.colorSpace,
         .imageExtent = renderer->swapchain.extent,
@@ -510,8 +749,12 @@ VkResult create_swapchain(VulkanRenderer* renderer) {
         //printf("Swapchain allocated %zd images\n", renderer->swapchain.images.count);
     }
 
-    //renderer->swapchain.images.images = (VkImage*)malloc(sizeof(VkImage) * renderer->swapchain.images.count);
-    renderer->swapchain.images.images = (VkImage*)memory_arena_allocate(renderer->heap_data, sizeof(VkImage) * renderer->swapchain.images.count);
+    if(renderer->swapchain.images.count > Swapchain::Images::MAX_IMAGES) {
+        result = VK_ERROR_TOO_MANY_OBJECTS;
+        printf("create_swapchain() failed. [%zd images, at most %zd supported]\n", renderer->swapchain.images.count, Swapchain::Images::MAX_IMAGES);
+        return result;
+    }
+
     result = vkGetSwapchainImagesKHR(renderer->devices.logical.device, renderer->swapchain.swapchain, reinterpret_cast<u32*>(&renderer->swapchain.images.count), renderer->swapchain.images.images);
     if(result != VK_SUCCESS) {
         printf("vkGetSwapchainImagesKHR() failed.\n");
@@ -519,8 +762,6 @@ VkResult create_swapchain(VulkanRenderer* renderer) {
         return result;
     }
 
-    //renderer->swapchain.images.views = (VkImageView*)malloc(sizeof(VkImageView) * renderer->swapchain.images.count);
-    renderer->swapchain.images.views = (VkImageView*)memory_arena_allocate(renderer->heap_data, sizeof(VkImageView) * renderer->swapchain.images.count);
     for(size_t image_index = 0; image_index < renderer->swapchain.images.count; ++image_index) {
         VkImageViewCreateInfo image_view_create_info = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -549,1164 +790,3009 @@ VkResult create_swapchain(VulkanRenderer* renderer) {
     return result;
 }
 
-VkResult load_shader_data(VulkanRenderer* renderer, size_t* shader_count, ShaderData* shader_data) {
-    VkResult result = VK_ERROR_UNKNOWN;
-
-    WIN32_FIND_DATAA file_data;
-    HANDLE find;
+//FIFO is the only mode every surface has to support
+VkPresentModeKHR choose_present_mode(VulkanRenderer* renderer, VkPresentModeKHR requested) {
+    for(size_t i = 0; i < renderer->swapchain.support_info.present_mode_count; ++i) {
+        if(renderer->swapchain.support_info.present_modes[i] == requested) {
+            return requested;
+        }
+    }
 
-    char shader_directory[MAX_PATH] = "shaders/compiled/";
-    char search[MAX_PATH];
-    strcpy_s(search, MAX_PATH, shader_directory);
-    strcat_s(search, MAX_PATH, "*");
+    printf("%s unsupported, falling back to VK_PRESENT_MODE_FIFO_KHR.\n", string_VkPresentModeKHR(requested));
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
 
-    find = FindFirstFileA(search, &file_data);
-    if(find == INVALID_HANDLE_VALUE) {
-        printf("No shaders found in ../shaders/compiled\n");
-        return result;
-    }
+//0 asks for one more than the minimum, an extra image to render to while the others are queued for presentation
+u32 choose_image_count(VulkanRenderer* renderer, u32 requested) {
+    VkSurfaceCapabilitiesKHR* capabilities = &renderer->swapchain.support_info.capabilities;
 
-    if(shader_data) {
-        shader_data->shaders = (Shader*)malloc(sizeof(Shader) * shader_data->count);
-        shader_data->modules = (VkShaderModule*)malloc(sizeof(VkShaderModule) * shader_data->count);
+    u32 image_count = requested > 0 ? requested : capabilities->minImageCount + 1;
+    image_count = std::max(image_count, capabilities->minImageCount);
+    if(capabilities->maxImageCount > 0) { //0 means no upper limit
+        image_count = std::min(image_count, capabilities->maxImageCount);
     }
+    image_count = std::min(image_count, static_cast<u32>(Swapchain::Images::MAX_IMAGES));
 
-    size_t shader_index = 0;
-    do {
-        if(strcmp(file_data.cFileName, ".") == 0 || strcmp(file_data.cFileName, "..") == 0) {
-            continue;
-        }
+    return image_count;
+}
 
-        char file_name[MAX_PATH] = "";
-        strcpy_s(file_name, MAX_PATH, file_data.cFileName);
+//Per-frame resources exist for MAX_FRAMES_IN_FLIGHT slots, so changing frames_in_flight only drains the graphics queue.
+//The swapchain is only rebuilt when the image count or present mode changes
+VkResult apply_frame_pacing(VulkanRenderer* renderer, FramePacingConfig* config) {
+    VkResult result = VK_SUCCESS;
+    TraceScope trace_scope("apply_frame_pacing");
 
-        char* extension = nullptr;
-        char shader_file_name[MAX_PATH] = "";
-        strcpy_s(shader_file_name, MAX_PATH, strtok_s(file_name, ".", &extension));
+    FramePacingConfig previous = renderer->frame_pacing;
+    renderer->frame_pacing = *config;
+    renderer->frame_pacing_state = {};
 
-        if(strcmp(extension, "spv") != 0) {
-            printf("Ignoring file: %s [Non-SPIRV (No .spv extension)]\n", file_data.cFileName);
-            continue;
+    size_t frames_in_flight = std::clamp<size_t>(config->frames_in_flight, 1, Swapchain::MAX_FRAMES_IN_FLIGHT);
+    if(frames_in_flight != renderer->swapchain.frames_in_flight) {
+        result = timeline_wait(renderer, &renderer->graphics_timeline, renderer->graphics_timeline.value);
+        if(result != VK_SUCCESS) {
+            printf("timeline_wait() failed.\n");
+            return result;
         }
 
-        if(shader_data == nullptr) {
-            ++*shader_count;
-            continue;
+        //Every slot is idle now, pick up timestamps from slots that are about to go unused
+        for(size_t frame_index = 0; frame_index < Swapchain::MAX_FRAMES_IN_FLIGHT; ++frame_index) {
+            collect_gpu_timestamps(renderer, frame_index);
         }
 
-        char* shader_type = nullptr;
-        strtok_s(shader_file_name, "_", &shader_type);
-
-        shader_data->shaders[shader_index] = {};
-        strcpy_s(shader_data->shaders[shader_index].file_path, MAX_PATH, shader_directory);
-        strcat_s(shader_data->shaders[shader_index].file_path, MAX_PATH, file_data.cFileName);
+        renderer->swapchain.frames_in_flight = frames_in_flight;
+        renderer->swapchain.current_frame_index = 0;
+    }
 
-        if(strcmp(shader_type, "vert") == 0) {
-            shader_data->shaders[shader_index].type = VK_SHADER_STAGE_VERTEX_BIT;
-        }
-        if(strcmp(shader_type, "frag") == 0) {
-            shader_data->shaders[shader_index].type = VK_SHADER_STAGE_FRAGMENT_BIT;
+    if(!renderer->offscreen && (config->image_count != previous.image_count || config->present_mode != previous.present_mode)) {
+        result = resize(renderer);
+        if(result != VK_SUCCESS) {
+            printf("resize() failed.\n");
+            return result;
         }
+    }
 
-        FILE* shader_file = fopen(shader_data->shaders[shader_index].file_path, "rb");
-        if(shader_file) {
-            fseek(shader_file, 0, SEEK_END);
-
-            shader_data->shaders[shader_index].file_size = ftell(shader_file);
-            shader_data->shaders[shader_index].data = malloc(shader_data->shaders[shader_index].file_size);
-
-            fseek(shader_file, 0, SEEK_SET);
-            if(fread(shader_data->shaders[shader_index].data, sizeof(char), shader_data->shaders[shader_index].file_size, shader_file) == shader_data->shaders[shader_index].file_size) {
-                VkShaderModuleCreateInfo shader_create_info = {
-                    .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-                    .pNext = nullptr,
-                    .flags = 0,
-                    .codeSize = shader_data->shaders[shader_index].file_size,
-                    .pCode = reinterpret_cast<const u32*>(shader_data->shaders[shader_index].data)
-                };
-
-                result = vkCreateShaderModule(renderer->devices.logical.device, &shader_create_info, nullptr, &shader_data->modules[shader_index]);
-                if(result != VK_SUCCESS) {
-                    printf("Failed to load %s\n", shader_data->shaders[shader_index].file_path);
-                    //free shader data stuff
-                    return result;
-                } else {
-                    printf("Loaded %s\n", shader_data->shaders[shader_index].file_path);
-                }
-
-            } else {
-                printf("File %s not found.\n", shader_data->shaders[shader_index].file_path);
-                //check shader_data null, delete if necessary
-                continue;
-            }
+    printf("Frame pacing: %zd frames in flight, %zd images, %s%s\n", renderer->swapchain.frames_in_flight, renderer->swapchain.images.count,
+        renderer->offscreen ? "offscreen" : string_VkPresentModeKHR(renderer->swapchain.present_mode), config->latency_wait ? ", latency wait" : "");
 
-            ++shader_index;
-        }
-        fclose(shader_file);
-    } while(FindNextFileA(find, &file_data) != 0);
-    FindClose(find);
+    return result;
+}
 
-    if(shader_data == nullptr) {
-        return VK_SUCCESS;
+//Called by the platform before it samples input. Sleeps off the time the last frame spent blocked on the GPU and
+//the swapchain, less the margin, so input is read as late as possible and the frame still lands on the next vsync.
+//Outside FIFO modes frames aren't held to vsync and there is nothing to wait for
+void frame_pacing_wait(VulkanRenderer* renderer) {
+    FramePacingState* state = &renderer->frame_pacing_state;
+    bool vsync_bound = renderer->swapchain.present_mode == VK_PRESENT_MODE_FIFO_KHR || renderer->swapchain.present_mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    if(!renderer->frame_pacing.latency_wait || renderer->offscreen || !vsync_bound || !state->measured) {
+        return;
     }
+    state->measured = false;
 
-    return result;
-}
+    //Creep towards the blocked time, back off a whole margin as soon as the frame comes close to missing vsync
+    Time::Duration margin = renderer->frame_pacing.latency_margin;
+    if(state->blocked < margin) {
+        state->delay -= margin;
+    } else {
+        state->delay += (state->blocked - margin) / 2;
+    }
+    state->delay = std::clamp(state->delay, Time::Duration::zero(), Time::Duration(Time::Milliseconds(100)));
 
-void destroy_shader_data(VulkanRenderer* renderer) {
+    if(state->delay > Time::Duration::zero()) {
+        TraceScope trace_scope("frame_pacing_wait");
+        time_sleep_until(Time::Clock::now() + state->delay);
+    }
 }
 
-VkResult create_graphics_pipeline(VulkanRenderer* renderer) {
+VkResult create_offscreen_targets(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_offscreen_targets");
 
-    result = load_shader_data(renderer, &renderer->graphics_pipeline.shader_data.count, nullptr);
-    if(renderer, renderer->graphics_pipeline.shader_data.count == 0) {
-        return result;
-    } else {
-        //printf("Shader Count: %zd\n", renderer->graphics_pipeline.shader_data.count);
-    }
+    renderer->swapchain.surface_format = {
+        .format = VK_FORMAT_B8G8R8A8_SRGB,
+        .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
+    };
 
-    result = load_shader_data(renderer, &renderer->graphics_pipeline.shader_data.count, &renderer->graphics_pipeline.shader_data);
-    if(result != VK_SUCCESS) {
-        destroy_shader_data(renderer);
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(renderer->devices.physical.device, renderer->swapchain.surface_format.format, &format_properties);
+    if(!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) {
+        result = VK_ERROR_FORMAT_NOT_SUPPORTED;
+        printf("Offscreen format %s is not renderable.\n", string_VkFormat(renderer->swapchain.surface_format.format));
         return result;
     }
 
-    VkPipelineShaderStageCreateInfo* pipeline_shader_stage_create_infos = (VkPipelineShaderStageCreateInfo*)memory_arena_allocate(temporary_memory, sizeof(VkPipelineShaderStageCreateInfo) * renderer->graphics_pipeline.shader_data.count);
-    for(size_t shader_index = 0; shader_index < renderer->graphics_pipeline.shader_data.count; ++shader_index) {
-        pipeline_shader_stage_create_infos[shader_index] = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+    //One target per frame slot, so draw_frame() can use the frame index as the image index whatever frames_in_flight is
+    renderer->swapchain.images.count = Swapchain::MAX_FRAMES_IN_FLIGHT;
+
+    for(size_t image_index = 0; image_index < renderer->swapchain.images.count; ++image_index) {
+        VkImageCreateInfo image_create_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .stage = renderer->graphics_pipeline.shader_data.shaders[shader_index].type,
-            .module = renderer->graphics_pipeline.shader_data.modules[shader_index],
-            .pName = "main",
-            .pSpecializationInfo = nullptr
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = renderer->swapchain.surface_format.format,
+            .extent = {
+                .width = renderer->swapchain.extent.width,
+                .height = renderer->swapchain.extent.height,
+                .depth = 1 },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
         };
-    }
-
-    VkVertexInputBindingDescription vertex_binding_description = {
-        .binding = 0,
-        .stride = sizeof(Vertex),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-    };
 
-    VkVertexInputAttributeDescription position_attribute_description = {
-        .location = 0,
-        .binding = 0,
-        .format = VkFormat::VK_FORMAT_R32G32_SFLOAT,
-        .offset = 0 //offsetof(Vertex, position)
-    };
+        result = vkCreateImage(renderer->devices.logical.device, &image_create_info, nullptr, &renderer->swapchain.images.images[image_index]);
+        if(result != VK_SUCCESS) {
+            printf("vkCreateImage() failed. Offscreen Target[%zd]\n", image_index);
+            return result;
+        }
 
-    VkVertexInputAttributeDescription color_attribute_description = {
-        .location = 1,
-        .binding = 0,
-        .format = VkFormat::VK_FORMAT_R32G32B32_SFLOAT,
-        .offset = 8 //offsetof(Vertex, color)
-    };
+        VkMemoryRequirements image_memory_requirements;
+        vkGetImageMemoryRequirements(renderer->devices.logical.device, renderer->swapchain.images.images[image_index], &image_memory_requirements);
 
-    VkVertexInputAttributeDescription texture_coord_attribute_description = {
-        .location = 2,
-        .binding = 0,
-        .format = VkFormat::VK_FORMAT_R32G32_SFLOAT,
-        .offset = 20
-    };
+        GpuAllocation* allocation = &renderer->swapchain.images.allocations[image_index];
+        result = gpu_allocate(renderer->gpu_allocator, &image_memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GpuResourceKind::OPTIMAL_IMAGE, allocation);
+        if(result != VK_SUCCESS) {
+            printf("gpu_allocate() failed. Offscreen Target[%zd]\n", image_index);
+            return result;
+        }
 
-    VkVertexInputBindingDescription vertex_input_binding_descriptions[] = {
-        vertex_binding_description
-    };
+        result = vkBindImageMemory(renderer->devices.logical.device, renderer->swapchain.images.images[image_index], allocation->memory, allocation->offset);
+        if(result != VK_SUCCESS) {
+            printf("vkBindImageMemory() failed. Offscreen Target[%zd]\n", image_index);
+            return result;
+        }
 
-    VkVertexInputAttributeDescription vertex_input_attribute_descriptions[] = {
-        position_attribute_description,
-        color_attribute_description,
-        texture_coord_attribute_description
+        VkImageViewCreateInfo image_view_create_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .image = renderer->swapchain.images.images[image_index],
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = renderer->swapchain.surface_format.format,
+            .components = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY },
+            .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1 }
+        };
+
+        result = vkCreateImageView(renderer->devices.logical.device, &image_view_create_info, nullptr, &renderer->swapchain.images.views[image_index]);
+        if(result != VK_SUCCESS) {
+            printf("vkCreateImageView() failed. Offscreen Target[%zd]\n", image_index);
+            return result;
+        }
+    }
+
+    return result;
+}
+
+//"shader_vert.spv" is a vertex shader: the stage is whatever follows the first '_' of the file name
+VkShaderStageFlagBits shader_stage_from_file_name(const char* file_name) {
+    const char* separator = strrchr(file_name, '/');
+    const char* stage = strchr(separator ? separator + 1 : file_name, '_');
+    if(!stage) {
+        return VK_SHADER_STAGE_ALL;
+    }
+
+    if(strncmp(stage + 1, "vert.", 5) == 0) {
+        return VK_SHADER_STAGE_VERTEX_BIT;
+    }
+    if(strncmp(stage + 1, "frag.", 5) == 0) {
+        return VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+    return VK_SHADER_STAGE_ALL;
+}
+
+//Same contract as load_shader_data(), for the shaders packed from shader_directory. Modules are created straight from
+//the mapping
+VkResult load_packed_shader_data(VulkanRenderer* renderer, const char* shader_directory, size_t* shader_count, ShaderData* shader_data) {
+    VkResult result = VK_SUCCESS;
+    MappedAssetPack* pack = &renderer->asset_pack;
+    size_t directory_length = strlen(shader_directory);
+
+    size_t shader_index = 0;
+    for(u32 slot = 0; slot < pack->header->table_capacity; ++slot) {
+        const AssetPack::Entry* entry = &pack->entries[slot];
+        const char* name = pack->strings + entry->name_offset;
+        if(entry->type != AssetPack::Type::SHADER || !asset_pack_entry_valid(pack, entry) || strncmp(name, shader_directory, directory_length) != 0) {
+            continue;
+        }
+
+        if(shader_data == nullptr) {
+            ++*shader_count;
+            continue;
+        }
+
+        if(shader_index >= shader_data->count) {
+            break;
+        }
+
+        Shader* shader = &shader_data->shaders[shader_index];
+        *shader = {
+            .type = shader_stage_from_file_name(name),
+            .file_size = entry->size,
+            .data = const_cast<u8*>(asset_pack_data(pack, entry)),
+            .mapped = true
+        };
+        strcpy_s(shader->file_path, MAX_PATH, name);
+
+        VkShaderModuleCreateInfo shader_create_info = {
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .codeSize = shader->file_size,
+            .pCode = reinterpret_cast<const u32*>(shader->data)
+        };
+
+        result = vkCreateShaderModule(renderer->devices.logical.device, &shader_create_info, nullptr, &shader_data->modules[shader_index]);
+        if(result != VK_SUCCESS) {
+            printf("Failed to load %s [Asset pack]\n", shader->file_path);
+            return result;
+        }
+        printf("Loaded %s [Asset pack]\n", shader->file_path);
+
+        ++shader_index;
+    }
+
+    return result;
+}
+
+VkResult load_shader_data(VulkanRenderer* renderer, size_t* shader_count, ShaderData* shader_data) {
+    const char* shader_directory = "shaders/compiled/";
+    size_t packed_shader_count = 0;
+    if(renderer->asset_pack.data && load_packed_shader_data(renderer, shader_directory, &packed_shader_count, nullptr) == VK_SUCCESS && packed_shader_count > 0) {
+        if(shader_data) {
+            shader_data->shaders = (Shader*)malloc(sizeof(Shader) * shader_data->count);
+            shader_data->modules = (VkShaderModule*)malloc(sizeof(VkShaderModule) * shader_data->count);
+        }
+        return load_packed_shader_data(renderer, shader_directory, shader_count, shader_data);
+    }
+
+    return load_loose_shader_data(renderer, shader_directory, shader_count, shader_data);
+}
+
+//Same contract as load_shader_data(), always from the files in shader_directory. Hot reload reads the freshly compiled
+//SPIR-V through here even when startup used the asset pack
+VkResult load_loose_shader_data(VulkanRenderer* renderer, const char* shader_directory, size_t* shader_count, ShaderData* shader_data) {
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    DirectoryListing listing = {};
+    if(!platform_list_directory(shader_directory, &listing) || listing.count == 0) {
+        printf("No shaders found in %s\n", shader_directory);
+        return result;
+    }
+
+    if(shader_data) {
+        shader_data->shaders = (Shader*)malloc(sizeof(Shader) * shader_data->count);
+        shader_data->modules = (VkShaderModule*)malloc(sizeof(VkShaderModule) * shader_data->count);
+    }
+
+    size_t shader_index = 0;
+    for(size_t entry_index = 0; entry_index < listing.count; ++entry_index) {
+        const char* entry_name = listing.entries[entry_index];
+
+        char file_name[MAX_PATH] = "";
+        strcpy_s(file_name, MAX_PATH, entry_name);
+
+        char* extension = nullptr;
+        strtok_s(file_name, ".", &extension);
+
+        if(strcmp(extension, "spv") != 0) {
+            printf("Ignoring file: %s [Non-SPIRV (No .spv extension)]\n", entry_name);
+            continue;
+        }
+
+        if(shader_data == nullptr) {
+            ++*shader_count;
+            continue;
+        }
+
+        shader_data->shaders[shader_index] = {};
+        strcpy_s(shader_data->shaders[shader_index].file_path, MAX_PATH, shader_directory);
+        strcat_s(shader_data->shaders[shader_index].file_path, MAX_PATH, entry_name);
+        shader_data->shaders[shader_index].type = shader_stage_from_file_name(entry_name);
+
+        FILE* shader_file = fopen(shader_data->shaders[shader_index].file_path, "rb");
+        if(shader_file) {
+            fseek(shader_file, 0, SEEK_END);
+
+            shader_data->shaders[shader_index].file_size = ftell(shader_file);
+            shader_data->shaders[shader_index].data = malloc(shader_data->shaders[shader_index].file_size);
+
+            fseek(shader_file, 0, SEEK_SET);
+            if(fread(shader_data->shaders[shader_index].data, sizeof(char), shader_data->shaders[shader_index].file_size, shader_file) == shader_data->shaders[shader_index].file_size) {
+                VkShaderModuleCreateInfo shader_create_info = {
+                    .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                    .pNext = nullptr,
+                    .flags = 0,
+                    .codeSize = shader_data->shaders[shader_index].file_size,
+                    .pCode = reinterpret_cast<const u32*>(shader_data->shaders[shader_index].data)
+                };
+
+                result = vkCreateShaderModule(renderer->devices.logical.device, &shader_create_info, nullptr, &shader_data->modules[shader_index]);
+                if(result != VK_SUCCESS) {
+                    printf("Failed to load %s\n", shader_data->shaders[shader_index].file_path);
+                    //free shader data stuff
+                    return result;
+                } else {
+                    printf("Loaded %s\n", shader_data->shaders[shader_index].file_path);
+                }
+
+            } else {
+                printf("File %s not found.\n", shader_data->shaders[shader_index].file_path);
+                //check shader_data null, delete if necessary
+                continue;
+            }
+
+            ++shader_index;
+        }
+        fclose(shader_file);
+    }
+
+    if(shader_data == nullptr) {
+        return VK_SUCCESS;
+    }
+
+    return result;
+}
+
+//Modules are only read while pipelines are created, so they can go as soon as vkCreateGraphicsPipelines() returns
+void destroy_shader_data(VulkanRenderer* renderer, ShaderData* shader_data) {
+    for(size_t shader_index = 0; shader_data->shaders && shader_index < shader_data->count; ++shader_index) {
+        if(shader_data->modules) {
+            vkDestroyShaderModule(renderer->devices.logical.device, shader_data->modules[shader_index], nullptr);
+        }
+        if(!shader_data->shaders[shader_index].mapped) {
+            free(shader_data->shaders[shader_index].data);
+        }
+    }
+
+    free(shader_data->shaders);
+    free(shader_data->modules);
+    shader_data->shaders = nullptr;
+    shader_data->modules = nullptr;
+    shader_data->count = 0;
+}
+
+//Reads the cache file written by the last run. The blob is only handed to the driver if its header was written by this
+//exact device and driver, otherwise we start cold. Also loads the shaders every cached pipeline is built from
+VkResult create_pipeline_cache(VulkanRenderer* renderer) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_pipeline_cache");
+    TempScope scratch(temporary_memory);
+
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+
+    void* initial_data = nullptr;
+    size_t initial_data_size = 0;
+
+    FILE* cache_file = fopen(PipelineCache::FILE_PATH, "rb");
+    if(cache_file) {
+        fseek(cache_file, 0, SEEK_END);
+        size_t file_size = ftell(cache_file);
+        fseek(cache_file, 0, SEEK_SET);
+
+        if(file_size >= sizeof(VkPipelineCacheHeaderVersionOne)) {
+            initial_data = push_array<u8>(temporary_memory, file_size);
+            if(initial_data && fread(initial_data, sizeof(char), file_size, cache_file) == file_size) {
+                initial_data_size = file_size;
+            }
+        }
+        fclose(cache_file);
+
+        if(initial_data_size > 0 && !pipeline_cache_compatible(renderer, initial_data, initial_data_size)) {
+            printf("Discarding %s. [Written by a different device or driver]\n", PipelineCache::FILE_PATH);
+            initial_data_size = 0;
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipeline_cache_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .initialDataSize = initial_data_size,
+        .pInitialData = initial_data_size > 0 ? initial_data : nullptr
+    };
+
+    result = vkCreatePipelineCache(renderer->devices.logical.device, &pipeline_cache_create_info, nullptr, &pipeline_cache->cache);
+    if(result != VK_SUCCESS) {
+        printf("vkCreatePipelineCache() failed.\n");
+        return result;
+    }
+
+    pipeline_cache->warm = initial_data_size > 0;
+    printf("Pipeline cache: %s [%zd bytes]\n", pipeline_cache->warm ? "warm" : "cold", initial_data_size);
+
+    void* entries = memory_arena_allocate(renderer->heap_data, sizeof(PipelineCache::Entry) * PipelineCache::CAPACITY, alignof(PipelineCache::Entry));
+    if(!entries) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("memory_arena_allocate() failed. [PipelineCache %zd entries]\n", PipelineCache::CAPACITY);
+        return result;
+    }
+    pipeline_cache->entries = (PipelineCache::Entry*)entries;
+    for(size_t slot = 0; slot < PipelineCache::CAPACITY; ++slot) {
+        new(&pipeline_cache->entries[slot]) PipelineCache::Entry();
+    }
+
+    //Every pipeline is built from these modules, a key names the ones it uses
+    ShaderData* shaders = &pipeline_cache->shaders;
+    result = load_shader_data(renderer, &shaders->count, nullptr);
+    if(result == VK_SUCCESS && shaders->count > 0) {
+        result = load_shader_data(renderer, &shaders->count, shaders);
+    }
+    if(result != VK_SUCCESS || shaders->count == 0) {
+        printf("load_shader_data() failed. [Shader Count: %zd]\n", shaders->count);
+        destroy_shader_data(renderer, shaders);
+        return result != VK_SUCCESS ? result : VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    return result;
+}
+
+bool pipeline_cache_compatible(VulkanRenderer* renderer, const void* data, size_t size) {
+    if(size < sizeof(VkPipelineCacheHeaderVersionOne)) {
+        return false;
+    }
+
+    VkPipelineCacheHeaderVersionOne header;
+    memcpy(&header, data, sizeof(header));
+
+    VkPhysicalDeviceProperties* properties = &renderer->devices.physical.properties;
+    return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties->vendorID &&
+           header.deviceID == properties->deviceID &&
+           memcmp(header.pipelineCacheUUID, properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+//Writes whatever the driver has accumulated back to disk for the next launch
+VkResult save_pipeline_cache(VulkanRenderer* renderer) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TempScope scratch(temporary_memory);
+
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+    if(pipeline_cache->cache == VK_NULL_HANDLE) {
+        return VK_SUCCESS;
+    }
+
+    size_t data_size = 0;
+    result = vkGetPipelineCacheData(renderer->devices.logical.device, pipeline_cache->cache, &data_size, nullptr);
+    if(result != VK_SUCCESS) {
+        printf("vkGetPipelineCacheData() failed.\n");
+        return result;
+    }
+
+    u8* data = push_array<u8>(temporary_memory, data_size);
+    if(!data) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("push_array() failed. [Pipeline Cache %zd bytes]\n", data_size);
+        return result;
+    }
+
+    result = vkGetPipelineCacheData(renderer->devices.logical.device, pipeline_cache->cache, &data_size, data);
+    if(result != VK_SUCCESS) {
+        printf("vkGetPipelineCacheData() failed.\n");
+        return result;
+    }
+
+    FILE* cache_file = fopen(PipelineCache::FILE_PATH, "wb");
+    if(!cache_file) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+        printf("Could not open %s for writing.\n", PipelineCache::FILE_PATH);
+        return result;
+    }
+
+    if(fwrite(data, sizeof(char), data_size, cache_file) != data_size) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+        printf("Could not write %s.\n", PipelineCache::FILE_PATH);
+    } else {
+        printf("Pipeline cache saved. [%zd bytes]\n", data_size);
+    }
+    fclose(cache_file);
+
+    return result;
+}
+
+void destroy_pipeline_cache(VulkanRenderer* renderer) {
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+    if(pipeline_cache->cache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    //Builds still running read the modules and write into the entries
+    pipeline_cache_wait(renderer);
+    for(size_t slot = 0; pipeline_cache->entries && slot < PipelineCache::CAPACITY; ++slot) {
+        PipelineCache::Entry* entry = &pipeline_cache->entries[slot];
+        if(entry->used && entry->pipeline != VK_NULL_HANDLE) {
+            DeletionQueue::Entry deletion_entry = { .kind = DeletionQueue::Kind::PIPELINE, .handle = { .pipeline = entry->pipeline } };
+            deletion_queue_push(renderer, &deletion_entry);
+        }
+    }
+    pipeline_cache->entries = nullptr;
+    pipeline_cache->entry_count = 0;
+    destroy_shader_data(renderer, &pipeline_cache->shaders);
+
+    save_pipeline_cache(renderer);
+    vkDestroyPipelineCache(renderer->devices.logical.device, pipeline_cache->cache, nullptr);
+    pipeline_cache->cache = VK_NULL_HANDLE;
+}
+
+//FNV-1a over the key's bytes
+u64 pipeline_key_hash(const PipelineKey* key) {
+    const u8* bytes = reinterpret_cast<const u8*>(key);
+    u64 hash = 0xCBF29CE484222325ull;
+    for(size_t index = 0; index < sizeof(PipelineKey); ++index) {
+        hash = (hash ^ bytes[index]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool pipeline_key_uses_shader(const PipelineKey* key, u64 name) {
+    for(size_t stage = 0; stage < PipelineKey::MAX_STAGES && key->shaders[stage] != 0; ++stage) {
+        if(key->shaders[stage] == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//The slot holding key, or the free slot it goes in. Null when neither exists
+PipelineCache::Entry* pipeline_cache_slot(PipelineCache* pipeline_cache, const PipelineKey* key, u64 hash) {
+    u64 mask = PipelineCache::CAPACITY - 1;
+    for(u64 probe = 0; probe <= mask; ++probe) {
+        PipelineCache::Entry* entry = &pipeline_cache->entries[(hash + probe) & mask];
+        if(!entry->used || (entry->hash == hash && memcmp(&entry->key, key, sizeof(PipelineKey)) == 0)) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+//Finds or makes the entry for key. New entries are reflected and get their layout here, on the calling thread, as the
+//layout cache isn't shared with workers. The pipeline itself isn't built yet
+PipelineCache::Entry* pipeline_cache_insert(VulkanRenderer* renderer, const PipelineKey* key) {
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+    u64 hash = pipeline_key_hash(key);
+    PipelineCache::Entry* entry = pipeline_cache_slot(pipeline_cache, key, hash);
+    if(!entry) {
+        printf("pipeline_cache_insert() failed. [More than %zd pipelines]\n", PipelineCache::CAPACITY);
+        return nullptr;
+    }
+    if(entry->used) {
+        return entry;
+    }
+
+    ShaderInterface shader_interface = {};
+    if(!reflect_shader_data(&pipeline_cache->shaders, key, &shader_interface)) {
+        return nullptr;
+    }
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layouts[LayoutCache::MAX_SETS] = {};
+    u32 set_count = 0;
+    if(layout_cache_pipeline_layout(renderer, &shader_interface, &layout, set_layouts, &set_count) != VK_SUCCESS) {
+        printf("layout_cache_pipeline_layout() failed.\n");
+        return nullptr;
+    }
+
+    entry->key = *key;
+    entry->hash = hash;
+    entry->used = true;
+    entry->renderer = renderer;
+    entry->layout = layout;
+    entry->shader_interface = shader_interface;
+    entry->pipeline = VK_NULL_HANDLE;
+    entry->result = VK_INCOMPLETE;
+    ++pipeline_cache->entry_count;
+    return entry;
+}
+
+//Null when key hasn't been built, or is still building
+VkPipeline pipeline_cache_find(VulkanRenderer* renderer, const PipelineKey* key) {
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+    PipelineCache::Entry* entry = pipeline_cache_slot(pipeline_cache, key, pipeline_key_hash(key));
+    if(!entry || !entry->used) {
+        return VK_NULL_HANDLE;
+    }
+
+    if(entry->building) {
+        if(entry->counter.pending.load(std::memory_order_acquire) > 0) {
+            return VK_NULL_HANDLE;
+        }
+        entry->building = false;
+        if(entry->result != VK_SUCCESS) {
+            printf("build_graphics_pipeline() failed. [Pipeline cache job, %s]\n", string_VkResult(entry->result));
+        }
+    }
+    return entry->pipeline;
+}
+
+//Builds key on the calling thread unless it was built before. Waits for a job already building it
+VkResult pipeline_cache_get(VulkanRenderer* renderer, const PipelineKey* key, VkPipeline* pipeline) {
+    PipelineCache::Entry* entry = pipeline_cache_insert(renderer, key);
+    if(!entry) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if(entry->building) {
+        job_pool_wait(renderer->job_pool, &entry->counter);
+        entry->building = false;
+    } else if(entry->result == VK_INCOMPLETE) {
+        entry->result = build_graphics_pipeline(renderer, &entry->key, &renderer->pipeline_cache.shaders, entry->layout, &entry->shader_interface, &entry->pipeline);
+    }
+
+    *pipeline = entry->pipeline;
+    return entry->result;
+}
+
+//The pipeline for key if it's ready. Otherwise starts building it on a job worker the first time it's asked for and
+//returns null until a later call finds it built, so the caller can draw with a fallback meanwhile
+VkPipeline pipeline_cache_request(VulkanRenderer* renderer, const PipelineKey* key) {
+    PipelineCache::Entry* entry = pipeline_cache_insert(renderer, key);
+    if(!entry) {
+        return VK_NULL_HANDLE;
+    }
+
+    if(!entry->building && entry->result == VK_INCOMPLETE) {
+        entry->building = true;
+        job_pool_submit(renderer->job_pool, pipeline_build_job, entry, &entry->counter);
+        return VK_NULL_HANDLE;
+    }
+    return pipeline_cache_find(renderer, key);
+}
+
+void pipeline_cache_wait(VulkanRenderer* renderer) {
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+    for(size_t slot = 0; pipeline_cache->entries && slot < PipelineCache::CAPACITY; ++slot) {
+        PipelineCache::Entry* entry = &pipeline_cache->entries[slot];
+        if(entry->used && entry->building) {
+            job_pool_wait(renderer->job_pool, &entry->counter);
+            entry->building = false;
+        }
+    }
+}
+
+void pipeline_build_job(void* data) {
+    PipelineCache::Entry* entry = (PipelineCache::Entry*)data;
+    VulkanRenderer* renderer = entry->renderer;
+    entry->result = build_graphics_pipeline(renderer, &entry->key, &renderer->pipeline_cache.shaders, entry->layout, &entry->shader_interface, &entry->pipeline);
+}
+
+//Index of the shader whose path hashes to name, shader_data->count when there's none
+size_t shader_data_find(ShaderData* shader_data, u64 name) {
+    size_t shader_index = 0;
+    while(shader_index < shader_data->count && AssetPack::hash_name(shader_data->shaders[shader_index].file_path) != name) {
+        ++shader_index;
+    }
+    return shader_index;
+}
+
+//Reflects the shaders key names, out of shader_data
+bool reflect_shader_data(ShaderData* shader_data, const PipelineKey* key, ShaderInterface* shader_interface) {
+    *shader_interface = {};
+    for(size_t stage = 0; stage < PipelineKey::MAX_STAGES && key->shaders[stage] != 0; ++stage) {
+        size_t shader_index = shader_data_find(shader_data, key->shaders[stage]);
+        if(shader_index == shader_data->count) {
+            printf("reflect_shader_data() failed. [Stage %zd isn't a loaded shader]\n", stage);
+            return false;
+        }
+
+        Shader* shader = &shader_data->shaders[shader_index];
+        if(!spirv_reflect(reinterpret_cast<const u32*>(shader->data), shader->file_size, shader_interface)) {
+            printf("reflect_shader_data() failed. [%s]\n", shader->file_path);
+            return false;
+        }
+    }
+    return true;
+}
+
+//Uniform buffers come out of the per-frame upload ring and are bound with a dynamic offset
+VkDescriptorType layout_descriptor_type(VkDescriptorType reflected_type) {
+    return reflected_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : reflected_type;
+}
+
+VkResult layout_cache_set_layout(VulkanRenderer* renderer, const VkDescriptorSetLayoutBinding* bindings, u32 binding_count, VkDescriptorSetLayout* set_layout) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    LayoutCache* cache = &renderer->layout_cache;
+
+    for(size_t layout_index = 0; layout_index < cache->set_layout_count; ++layout_index) {
+        LayoutCache::SetLayout* cached = &cache->set_layouts[layout_index];
+        bool equal = cached->binding_count == binding_count;
+        for(u32 binding_index = 0; binding_index < binding_count && equal; ++binding_index) {
+            const VkDescriptorSetLayoutBinding* a = &cached->bindings[binding_index];
+            const VkDescriptorSetLayoutBinding* b = &bindings[binding_index];
+            equal = a->binding == b->binding && a->descriptorType == b->descriptorType && a->descriptorCount == b->descriptorCount && a->stageFlags == b->stageFlags;
+        }
+
+        if(equal) {
+            *set_layout = cached->layout;
+            return VK_SUCCESS;
+        }
+    }
+
+    if(cache->set_layout_count == LayoutCache::MAX_SET_LAYOUTS) {
+        printf("layout_cache_set_layout() failed. [More than %zd set layouts]\n", LayoutCache::MAX_SET_LAYOUTS);
+        return result;
+    }
+
+    VkDescriptorSetLayoutCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .bindingCount = binding_count,
+        .pBindings = bindings
+    };
+
+    LayoutCache::SetLayout* cached = &cache->set_layouts[cache->set_layout_count];
+    result = vkCreateDescriptorSetLayout(renderer->devices.logical.device, &create_info, nullptr, &cached->layout);
+    if(result != VK_SUCCESS) {
+        printf("vkCreateDescriptorSetLayout() failed.\n");
+        return result;
+    }
+
+    cached->binding_count = binding_count;
+    memcpy(cached->bindings, bindings, sizeof(VkDescriptorSetLayoutBinding) * binding_count);
+    ++cache->set_layout_count;
+    *set_layout = cached->layout;
+    return result;
+}
+
+//One set layout per set up to the highest one the shaders use, sets in between get an empty layout. The bindless texture
+//set is made by create_texture_atlas(), shaders are only checked against it
+VkResult layout_cache_pipeline_layout(VulkanRenderer* renderer, const ShaderInterface* shader_interface, VkPipelineLayout* pipeline_layout, VkDescriptorSetLayout* set_layouts, u32* set_count) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    LayoutCache* cache = &renderer->layout_cache;
+
+    *set_count = shader_interface->binding_count > 0 ? shader_interface->bindings[shader_interface->binding_count - 1].set + 1 : 0;
+    if(*set_count > LayoutCache::MAX_SETS) {
+        printf("layout_cache_pipeline_layout() failed. [Set %u, at most %u sets]\n", *set_count - 1, LayoutCache::MAX_SETS);
+        return result;
+    }
+
+    size_t binding_index = 0;
+    for(u32 set = 0; set < *set_count; ++set) {
+        VkDescriptorSetLayoutBinding bindings[ShaderInterface::MAX_BINDINGS];
+        u32 binding_count = 0;
+        for(; binding_index < shader_interface->binding_count && shader_interface->bindings[binding_index].set == set; ++binding_index) {
+            const ReflectedBinding* reflected = &shader_interface->bindings[binding_index];
+            bindings[binding_count++] = {
+                .binding = reflected->binding,
+                .descriptorType = layout_descriptor_type(reflected->type),
+                .descriptorCount = reflected->count,
+                .stageFlags = reflected->stages,
+                .pImmutableSamplers = nullptr
+            };
+        }
+
+        if(set == TextureAtlas::DESCRIPTOR_SET) {
+            VkDescriptorSetLayoutBinding* textures = &bindings[0];
+            if(binding_count != 1 || textures->binding != 0 || textures->descriptorType != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || textures->descriptorCount > renderer->texture_atlas.capacity || (textures->stageFlags & ~VK_SHADER_STAGE_FRAGMENT_BIT) != 0) {
+                printf("layout_cache_pipeline_layout() failed. [Set %u is the bindless textures, a fragment shader sampler2D array at binding 0]\n", set);
+                return result;
+            }
+            set_layouts[set] = renderer->texture_atlas.set_layout;
+            continue;
+        }
+
+        for(u32 index = 0; index < binding_count; ++index) {
+            if(bindings[index].descriptorCount == 0) {
+                printf("layout_cache_pipeline_layout() failed. [Set %u binding %u is a runtime array outside the bindless textures]\n", set, bindings[index].binding);
+                return result;
+            }
+        }
+
+        result = layout_cache_set_layout(renderer, bindings, binding_count, &set_layouts[set]);
+        if(result != VK_SUCCESS) {
+            printf("layout_cache_set_layout() failed. [Set %u]\n", set);
+            return result;
+        }
+    }
+
+    u32 push_constant_range_count = static_cast<u32>(shader_interface->push_constant_range_count);
+    for(size_t layout_index = 0; layout_index < cache->pipeline_layout_count; ++layout_index) {
+        LayoutCache::PipelineLayout* cached = &cache->pipeline_layouts[layout_index];
+        bool equal = cached->set_count == *set_count && cached->push_constant_range_count == push_constant_range_count;
+        for(u32 set = 0; set < *set_count && equal; ++set) {
+            equal = cached->set_layouts[set] == set_layouts[set];
+        }
+        for(u32 range_index = 0; range_index < push_constant_range_count && equal; ++range_index) {
+            const VkPushConstantRange* a = &cached->push_constant_ranges[range_index];
+            const VkPushConstantRange* b = &shader_interface->push_constant_ranges[range_index];
+            equal = a->stageFlags == b->stageFlags && a->offset == b->offset && a->size == b->size;
+        }
+
+        if(equal) {
+            *pipeline_layout = cached->layout;
+            return VK_SUCCESS;
+        }
+    }
+
+    if(cache->pipeline_layout_count == LayoutCache::MAX_PIPELINE_LAYOUTS) {
+        printf("layout_cache_pipeline_layout() failed. [More than %zd pipeline layouts]\n", LayoutCache::MAX_PIPELINE_LAYOUTS);
+        return VK_ERROR_UNKNOWN;
+    }
+
+    VkPipelineLayoutCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .setLayoutCount = *set_count,
+        .pSetLayouts = set_layouts,
+        .pushConstantRangeCount = push_constant_range_count,
+        .pPushConstantRanges = shader_interface->push_constant_ranges
+    };
+
+    LayoutCache::PipelineLayout* cached = &cache->pipeline_layouts[cache->pipeline_layout_count];
+    result = vkCreatePipelineLayout(renderer->devices.logical.device, &create_info, nullptr, &cached->layout);
+    if(result != VK_SUCCESS) {
+        printf("vkCreatePipelineLayout() failed.\n");
+        return result;
+    }
+
+    cached->set_count = *set_count;
+    memcpy(cached->set_layouts, set_layouts, sizeof(VkDescriptorSetLayout) * *set_count);
+    cached->push_constant_range_count = push_constant_range_count;
+    memcpy(cached->push_constant_ranges, shader_interface->push_constant_ranges, sizeof(VkPushConstantRange) * push_constant_range_count);
+    ++cache->pipeline_layout_count;
+    *pipeline_layout = cached->layout;
+    return result;
+}
+
+void destroy_layout_cache(VulkanRenderer* renderer) {
+    LayoutCache* cache = &renderer->layout_cache;
+    for(size_t layout_index = 0; layout_index < cache->pipeline_layout_count; ++layout_index) {
+        DeletionQueue::Entry entry = { .kind = DeletionQueue::Kind::PIPELINE_LAYOUT, .handle = { .pipeline_layout = cache->pipeline_layouts[layout_index].layout } };
+        deletion_queue_push(renderer, &entry);
+    }
+    for(size_t layout_index = 0; layout_index < cache->set_layout_count; ++layout_index) {
+        DeletionQueue::Entry entry = { .kind = DeletionQueue::Kind::DESCRIPTOR_SET_LAYOUT, .handle = { .descriptor_set_layout = cache->set_layouts[layout_index].layout } };
+        deletion_queue_push(renderer, &entry);
+    }
+    *cache = {};
+}
+
+VkResult create_graphics_pipeline(VulkanRenderer* renderer) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_graphics_pipeline");
+
+    VkAttachmentDescription color_attachment = {
+        .flags = 0,
+        .format = renderer->swapchain.surface_format.format,
+        .samples = VkSampleCountFlagBits::VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VkAttachmentStoreOp::VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VkAttachmentStoreOp::VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
+        //Offscreen targets are left ready for readback instead of presentation
+        .finalLayout = renderer->offscreen ? VkImageLayout::VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VkImageLayout::VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+    };
+
+    VkAttachmentReference color_attachment_reference = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+
+    VkSubpassDescription subpass_description = {
+        .flags = 0,
+        .pipelineBindPoint = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .inputAttachmentCount = 0,
+        .pInputAttachments = VK_NULL_HANDLE,
+        //use swapchain.images.count if we need an attachment per frame buffer
+        .colorAttachmentCount = 1,
+        //The index of the attachment in this array is directly referenced from the fragment shader
+        //with the layout(location = 0) out vec4 outColor directive
+        .pColorAttachments = &color_attachment_reference,
+        .pResolveAttachments = VK_NULL_HANDLE,
+        .pDepthStencilAttachment = VK_NULL_HANDLE,
+        .preserveAttachmentCount = 0,
+        .pPreserveAttachments = VK_NULL_HANDLE
+    };
+
+    VkSubpassDependency subpass_dependency = {
+        .srcSubpass = VK_SUBPASS_EXTERNAL,
+        .dstSubpass = 0,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+    };
+
+    VkRenderPassCreateInfo render_pass_create_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .attachmentCount = 1,
+        .pAttachments = &color_attachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass_description,
+        .dependencyCount = 1,
+        .pDependencies = &subpass_dependency
+    };
+
+    result = vkCreateRenderPass(renderer->devices.logical.device, &render_pass_create_info, nullptr, &renderer->graphics_pipeline.render_pass);
+    if(result != VK_SUCCESS) {
+        printf("ckCreateRenderPass() failed.\n");
+        return result;
+    }
+
+    static constexpr const char* SPRITE_SHADERS[] = { "shaders/compiled/shader_vert.spv", "shaders/compiled/shader_frag.spv" };
+    GraphicsPipeline* graphics_pipeline = &renderer->graphics_pipeline;
+    graphics_pipeline->key = {
+        .render_pass = graphics_pipeline->render_pass,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .blend = PipelineBlend::REPLACE,
+        .vertex_layout = VertexLayout::SPRITE,
+        .cull_mode = VK_CULL_MODE_BACK_BIT
+    };
+    for(size_t shader_index = 0; shader_index < sizeof(SPRITE_SHADERS) / sizeof(SPRITE_SHADERS[0]); ++shader_index) {
+        graphics_pipeline->key.shaders[shader_index] = AssetPack::hash_name(SPRITE_SHADERS[shader_index]);
+    }
+
+    PipelineCache::Entry* entry = pipeline_cache_insert(renderer, &graphics_pipeline->key);
+    if(!entry) {
+        printf("pipeline_cache_insert() failed. [%s, %s]\n", SPRITE_SHADERS[0], SPRITE_SHADERS[1]);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkDescriptorSetLayout set_layouts[LayoutCache::MAX_SETS] = {};
+    u32 set_count = 0;
+    result = layout_cache_pipeline_layout(renderer, &entry->shader_interface, &graphics_pipeline->layout, set_layouts, &set_count);
+    if(result != VK_SUCCESS) {
+        printf("layout_cache_pipeline_layout() failed.\n");
+        return result;
+    }
+
+    //record_command_buffer() binds the frame's uniforms at set 0 binding 0 with one dynamic offset, then the bindless
+    //textures, so that's what the sprite shaders have to declare
+    ShaderInterface* shader_interface = &entry->shader_interface;
+    ReflectedBinding* uniform_binding = &shader_interface->bindings[0];
+    if(shader_interface->binding_count == 0 || set_count != TextureAtlas::DESCRIPTOR_SET + 1 || uniform_binding->set != 0 || uniform_binding->binding != 0 || uniform_binding->type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || (shader_interface->binding_count > 1 && shader_interface->bindings[1].set == 0)) {
+        printf("create_graphics_pipeline() failed. [The sprite shaders must declare a uniform block at set 0 binding 0 and the textures at set %u, shaders/compiled may be older than the sources]\n", TextureAtlas::DESCRIPTOR_SET);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    graphics_pipeline->descriptor_set_layout = set_layouts[0];
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    result = pipeline_cache_get(renderer, &graphics_pipeline->key, &pipeline);
+    if(result != VK_SUCCESS) {
+        printf("pipeline_cache_get() failed.\n");
+        return result;
+    }
+
+    return result;
+}
+
+//The pipeline key describes, with its shaders' modules taken from shader_data and shader_interface reflected from them.
+//Touches no shared renderer state, so pipeline cache and hot reload builds run it on job workers
+VkResult build_graphics_pipeline(VulkanRenderer* renderer, const PipelineKey* key, ShaderData* shader_data, VkPipelineLayout layout, const ShaderInterface* shader_interface, VkPipeline* pipeline) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("build_graphics_pipeline");
+
+    VkPipelineShaderStageCreateInfo pipeline_shader_stage_create_infos[PipelineKey::MAX_STAGES];
+    u32 stage_count = 0;
+    for(; stage_count < PipelineKey::MAX_STAGES && key->shaders[stage_count] != 0; ++stage_count) {
+        size_t shader_index = shader_data_find(shader_data, key->shaders[stage_count]);
+        if(shader_index == shader_data->count) {
+            printf("build_graphics_pipeline() failed. [No shader for stage %u]\n", stage_count);
+            return result;
+        }
+
+        pipeline_shader_stage_create_infos[stage_count] = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .stage = shader_data->shaders[shader_index].type,
+            .module = shader_data->modules[shader_index],
+            .pName = "main",
+            .pSpecializationInfo = nullptr
+        };
+    }
+
+    //VertexLayout::SPRITE, the only layout so far
+    VkVertexInputBindingDescription vertex_binding_description = {
+        .binding = 0,
+        .stride = sizeof(Vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+    };
+
+    VkVertexInputAttributeDescription position_attribute_description = {
+        .location = 0,
+        .binding = 0,
+        .format = VkFormat::VK_FORMAT_R32G32_SFLOAT,
+        .offset = 0 //offsetof(Vertex, position)
+    };
+
+    VkVertexInputAttributeDescription color_attribute_description = {
+        .location = 1,
+        .binding = 0,
+        .format = VkFormat::VK_FORMAT_R32G32B32_SFLOAT,
+        .offset = 8 //offsetof(Vertex, color)
+    };
+
+    VkVertexInputAttributeDescription texture_coord_attribute_description = {
+        .location = 2,
+        .binding = 0,
+        .format = VkFormat::VK_FORMAT_R32G32_SFLOAT,
+        .offset = 20
+    };
+
+    //Binding 1 advances once per sprite, every quad vertex sees the same SpriteInstance
+    VkVertexInputBindingDescription instance_binding_description = {
+        .binding = 1,
+        .stride = sizeof(SpriteInstance),
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
+    };
+
+    VkVertexInputAttributeDescription model_x_axis_attribute_description = {
+        .location = 3,
+        .binding = 1,
+        .format = VkFormat::VK_FORMAT_R32G32_SFLOAT,
+        .offset = offsetof(SpriteInstance, model.x_axis)
+    };
+
+    VkVertexInputAttributeDescription model_y_axis_attribute_description = {
+        .location = 4,
+        .binding = 1,
+        .format = VkFormat::VK_FORMAT_R32G32_SFLOAT,
+        .offset = offsetof(SpriteInstance, model.y_axis)
+    };
+
+    VkVertexInputAttributeDescription model_translation_attribute_description = {
+        .location = 5,
+        .binding = 1,
+        .format = VkFormat::VK_FORMAT_R32G32_SFLOAT,
+        .offset = offsetof(SpriteInstance, model.translation)
+    };
+
+    VkVertexInputAttributeDescription texture_index_attribute_description = {
+        .location = 6,
+        .binding = 1,
+        .format = VkFormat::VK_FORMAT_R32_UINT,
+        .offset = offsetof(SpriteInstance, texture_index)
+    };
+
+    VkVertexInputAttributeDescription tint_attribute_description = {
+        .location = 7,
+        .binding = 1,
+        .format = VkFormat::VK_FORMAT_R8G8B8A8_UNORM,
+        .offset = offsetof(SpriteInstance, tint)
+    };
+
+    VkVertexInputAttributeDescription uv_rect_attribute_description = {
+        .location = 8,
+        .binding = 1,
+        .format = VkFormat::VK_FORMAT_R32G32B32A32_SFLOAT,
+        .offset = offsetof(SpriteInstance, uv_rect)
+    };
+
+    VkVertexInputBindingDescription vertex_input_binding_descriptions[] = {
+        vertex_binding_description,
+        instance_binding_description
+    };
+
+    //Everything Vertex and SpriteInstance hold. SPIR-V doesn't say where an input lives in host memory or that the tint
+    //is packed, so the vertex shader's reflected inputs only pick the attributes the pipeline fetches
+    VkVertexInputAttributeDescription stream_attribute_descriptions[] = {
+        position_attribute_description,
+        color_attribute_description,
+        texture_coord_attribute_description,
+        model_x_axis_attribute_description,
+        model_y_axis_attribute_description,
+        model_translation_attribute_description,
+        texture_index_attribute_description,
+        tint_attribute_description,
+        uv_rect_attribute_description
+    };
+
+    VkVertexInputAttributeDescription vertex_input_attribute_descriptions[ShaderInterface::MAX_INPUTS];
+    u32 vertex_input_attribute_count = 0;
+    for(size_t input_index = 0; input_index < shader_interface->input_count; ++input_index) {
+        const ReflectedInput* input = &shader_interface->inputs[input_index];
+        VkVertexInputAttributeDescription* attribute = nullptr;
+        for(VkVertexInputAttributeDescription& stream_attribute : stream_attribute_descriptions) {
+            attribute = stream_attribute.location == input->location ? &stream_attribute : attribute;
+        }
+
+        if(!attribute) {
+            printf("build_graphics_pipeline() failed. [The vertex shader reads location %u, no vertex stream has it]\n", input->location);
+            return result;
+        }
+
+        //Normalized formats read as floats, integer inputs need integer formats
+        NumericType numeric_type = NumericType::FLOAT;
+        if(!vertex_format_numeric_type(attribute->format, &numeric_type) || numeric_type != input->numeric_type) {
+            printf("build_graphics_pipeline() failed. [Location %u is %s in the vertex shader and %s in the vertex stream]\n", input->location, string_VkFormat(input->format), string_VkFormat(attribute->format));
+            return result;
+        }
+
+        vertex_input_attribute_descriptions[vertex_input_attribute_count++] = *attribute;
+    }
+
+    VkPipelineVertexInputStateCreateInfo pipeline_vertex_input_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .vertexBindingDescriptionCount = 2,
+        .pVertexBindingDescriptions = vertex_input_binding_descriptions,
+        .vertexAttributeDescriptionCount = vertex_input_attribute_count,
+        .pVertexAttributeDescriptions = vertex_input_attribute_descriptions
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo pipeline_input_assembly_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .topology = key->topology,
+        .primitiveRestartEnable = VK_FALSE
+    };
+
+    VkPipelineTessellationStateCreateInfo pipeline_tesselation_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .patchControlPoints = 0
+    };
+
+    //We're trying out the dynamic states, but this is the explicit version, maybe the source of our triangle not being scaled/centered on resize
+    // VkViewport viewport = {
+    //     .x = 0,
+    //     .y = 0,
+    //     .width = static_cast<f32>(renderer->swapchain.extent.width),
+    //     .height = static_cast<f32>(renderer->swapchain.extent.height),
+    //     .minDepth = 0.0f,
+    //     .maxDepth = 1.0f
+    // };
+
+    // VkRect2D scissor = {
+    //     .offset = { 0, 0 },
+    //     .extent = renderer->swapchain.extent
+    // };
+
+    VkPipelineViewportStateCreateInfo pipeline_viewport_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .viewportCount = 1,
+        .pViewports = nullptr, //&viewport,
+        .scissorCount = 1,
+        .pScissors = nullptr //&scissor
+    };
+
+    VkPipelineRasterizationStateCreateInfo pipeline_rasterization_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VkPolygonMode::VK_POLYGON_MODE_FILL,
+        .cullMode = key->cull_mode,
+        .frontFace = VkFrontFace::VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .depthBiasConstantFactor = 0.0f,
+        .depthBiasClamp = 0.0f,
+        .depthBiasSlopeFactor = 0.0f,
+        .lineWidth = 1.0f
+    };
+
+    VkPipelineMultisampleStateCreateInfo pipeline_multisample_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .rasterizationSamples = VkSampleCountFlagBits::VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+        .minSampleShading = 1.0f,
+        .pSampleMask = nullptr,
+        .alphaToCoverageEnable = VK_FALSE,
+        .alphaToOneEnable = VK_FALSE
+    };
+
+    VkPipelineDepthStencilStateCreateInfo pipeline_depth_stencil_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+        .front = {},
+        .back = {},
+        .minDepthBounds = 0.0f,
+        .maxDepthBounds = 1.0f
+    };
+
+    //The tutorial only has one attachment, let's try that
+    // VkPipelineColorBlendAttachmentState* pipeline_color_blend_attachment_states = (VkPipelineColorBlendAttachmentState*)malloc(sizeof(VkPipelineColorBlendAttachmentState) * renderer->swapchain.images.count);
+    // for(size_t image_index = 0; image_index < renderer->swapchain.images.count; ++image_index) {
+    //     pipeline_color_blend_attachment_states[image_index] = {
+    //         .blendEnable = VK_FALSE,
+    //         .srcColorBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ONE,
+    //         .dstColorBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ZERO,
+    //         .colorBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
+    //         .srcAlphaBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ONE,
+    //         .dstAlphaBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ZERO,
+    //         .alphaBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
+    //         .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    //     };
+    // }
+
+    VkPipelineColorBlendAttachmentState pipeline_color_blend_attachment_state = {
+        .blendEnable = key->blend != PipelineBlend::REPLACE,
+        .srcColorBlendFactor = key->blend == PipelineBlend::REPLACE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = key->blend == PipelineBlend::ALPHA ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : (key->blend == PipelineBlend::ADDITIVE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO),
+        .colorBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = key->blend == PipelineBlend::ALPHA ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : (key->blend == PipelineBlend::ADDITIVE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO),
+        .alphaBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    };
+
+    VkPipelineColorBlendStateCreateInfo pipeline_color_blend_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0, //Do we want VK_PIPELINE_COLOR_BLEND_STATE_CREATE_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_BIT_EXT to hook into the implicit synchro steps? Probably not
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VkLogicOp::VK_LOGIC_OP_COPY,
+        .attachmentCount = 1, //static_cast<u32>(renderer->swapchain.images.count),
+        .pAttachments = &pipeline_color_blend_attachment_state,
+        .blendConstants = { 0.0f, 0.0f, 0.0f, 0.0f }
+    };
+
+    //Here's our dynamic states, see above
+    VkDynamicState dynamic_states[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo pipeline_dynamic_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .dynamicStateCount = 2,
+        .pDynamicStates = dynamic_states
+    };
+
+    VkGraphicsPipelineCreateInfo graphics_pipeline_create_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        //Consider the optional VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR and VK_PIPELINE_CREATE_CAPTURE_INTERNAL_REPRESENTATIONS_BIT_KHR flags to deduce some debug info?
+        .flags = 0,
+        .stageCount = stage_count,
+        .pStages = pipeline_shader_stage_create_infos,
+        .pVertexInputState = &pipeline_vertex_input_state_create_info,
+        .pInputAssemblyState = &pipeline_input_assembly_state_create_info,
+        .pTessellationState = &pipeline_tesselation_state_create_info,
+        .pViewportState = &pipeline_viewport_state_create_info,
+        .pRasterizationState = &pipeline_rasterization_state_create_info,
+        .pMultisampleState = &pipeline_multisample_state_create_info,
+        .pDepthStencilState = &pipeline_depth_stencil_state_create_info,
+        .pColorBlendState = &pipeline_color_blend_state_create_info,
+        //VVV This was true before, we're trying dynamic states at the moment
+        //Our pipeline is completely explicit, no dynamic state involved
+        .pDynamicState = &pipeline_dynamic_state_create_info,
+        .layout = layout,
+        .renderPass = key->render_pass,
+        .subpass = 0,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1
+    };
+
+    result = vkCreateGraphicsPipelines(renderer->devices.logical.device, renderer->pipeline_cache.cache, 1, &graphics_pipeline_create_info, nullptr, pipeline);
+    if(result != VK_SUCCESS) {
+        printf("vkCreateGraphicsPipelines() failed.\n");
+        return result;
+    }
+
+    return result;
+}
+
+//Hot reload is a development convenience, failing to watch the sources only leaves it off
+bool shader_reload_start(VulkanRenderer* renderer) {
+    if(!platform_watch_directory(ShaderReload::SOURCE_DIRECTORY, &renderer->shader_reload.watch)) {
+        printf("Shader hot reload off. [Can't watch %s]\n", ShaderReload::SOURCE_DIRECTORY);
+        return false;
+    }
+
+    printf("Watching %s for shader changes.\n", ShaderReload::SOURCE_DIRECTORY);
+    return true;
+}
+
+void shader_compile_job(void* data) {
+    ShaderReload::Compile* compile = (ShaderReload::Compile*)data;
+    TraceScope trace_scope("shader_compile");
+
+    //GLSLC names the compiler outright, otherwise the SDK's copy, otherwise whatever is on PATH
+    char compiler[MAX_PATH] = "glslc";
+    const char* compiler_path = getenv("GLSLC");
+    const char* sdk_path = getenv("VULKAN_SDK");
+    if(compiler_path) {
+        strcpy_s(compiler, MAX_PATH, compiler_path);
+    } else if(sdk_path) {
+        snprintf(compiler, MAX_PATH, "%s/bin/glslc", sdk_path);
+    }
+
+    char command[3 * MAX_PATH + 16];
+#if defined(_WIN32)
+    //cmd.exe strips the outermost pair of quotes when a command has more than two
+    snprintf(command, sizeof(command), "\"\"%s\" \"%s\" -o \"%s\"\"", compiler, compile->source_path, compile->spirv_path);
+#else
+    snprintf(command, sizeof(command), "\"%s\" \"%s\" -o \"%s\"", compiler, compile->source_path, compile->spirv_path);
+#endif
+
+    //glslc prints its own diagnostics and leaves the old SPIR-V in place on error
+    compile->compiled = system(command) == 0;
+}
+
+//Every edited source compiles on its own worker, then the pipelines built from them are rebuilt here, against the
+//pipeline cache, so the frame that swaps them in never waits on the driver
+void shader_reload_job(void* data) {
+    VulkanRenderer* renderer = (VulkanRenderer*)data;
+    ShaderReload* reload = &renderer->shader_reload;
+    TraceScope trace_scope("shader_reload");
+
+    JobCounter counter;
+    for(size_t compile_index = 0; compile_index < reload->compile_count; ++compile_index) {
+        job_pool_submit(renderer->job_pool, shader_compile_job, &reload->compiles[compile_index], &counter);
+    }
+    job_pool_wait(renderer->job_pool, &counter);
+
+    for(size_t compile_index = 0; compile_index < reload->compile_count; ++compile_index) {
+        ShaderReload::Compile* compile = &reload->compiles[compile_index];
+        if(!compile->compiled) {
+            printf("%s failed to compile, keeping the current pipelines.\n", compile->source_path);
+            return;
+        }
+    }
+
+    //Loaded even when no built pipeline uses the edited shaders, later builds take their modules from here
+    ShaderData* shader_data = &reload->shaders;
+    VkResult result = load_loose_shader_data(renderer, ShaderReload::COMPILED_DIRECTORY, &shader_data->count, nullptr);
+    if(result == VK_SUCCESS && shader_data->count > 0) {
+        result = load_loose_shader_data(renderer, ShaderReload::COMPILED_DIRECTORY, &shader_data->count, shader_data);
+    } else if(result == VK_SUCCESS) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    //Layouts are shared and draw_frame() keeps binding against them, only new vertex inputs can be taken without a restart.
+    //The entries were made before the reload started and only the main thread changes them between reloads
+    size_t built_count = 0;
+    for(; result == VK_SUCCESS && built_count < reload->entry_count; ++built_count) {
+        PipelineCache::Entry* entry = reload->entries[built_count];
+        ShaderInterface shader_interface = {};
+        if(!reflect_shader_data(shader_data, &entry->key, &shader_interface)) {
+            result = VK_ERROR_INITIALIZATION_FAILED;
+        } else if(!shader_interface_layout_equal(&shader_interface, &entry->shader_interface)) {
+            printf("The shaders' descriptor sets or push constants changed, restart to pick them up.\n");
+            result = VK_ERROR_INITIALIZATION_FAILED;
+        } else {
+            result = build_graphics_pipeline(renderer, &entry->key, shader_data, entry->layout, &shader_interface, &reload->pipelines[built_count]);
+        }
+    }
+
+    if(result != VK_SUCCESS) {
+        printf("Shader reload failed, keeping the current pipelines. [%s]\n", string_VkResult(result));
+        for(size_t pipeline_index = 0; pipeline_index < built_count; ++pipeline_index) {
+            vkDestroyPipeline(renderer->devices.logical.device, reload->pipelines[pipeline_index], nullptr);
+            reload->pipelines[pipeline_index] = VK_NULL_HANDLE;
+        }
+        destroy_shader_data(renderer, shader_data);
+        return;
+    }
+
+    reload->succeeded = true;
+}
+
+bool shader_reload_edited(ShaderReload* reload, const PipelineKey* key) {
+    for(size_t compile_index = 0; compile_index < reload->compile_count; ++compile_index) {
+        if(pipeline_key_uses_shader(key, AssetPack::hash_name(reload->compiles[compile_index].spirv_path))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//Builds again, on job workers, every cached pipeline the reload didn't rebuild that came from the old modules: ones
+//that were still building when it started, built since, or whose build failed. Runs once the new modules are in
+void shader_reload_requeue(VulkanRenderer* renderer) {
+    ShaderReload* reload = &renderer->shader_reload;
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+    for(size_t slot = 0; slot < PipelineCache::CAPACITY; ++slot) {
+        PipelineCache::Entry* entry = &pipeline_cache->entries[slot];
+        if(!entry->used || entry->building || entry->result == VK_INCOMPLETE || !shader_reload_edited(reload, &entry->key)) {
+            continue;
+        }
+
+        bool rebuilt = false;
+        for(size_t entry_index = 0; entry_index < reload->entry_count && !rebuilt; ++entry_index) {
+            rebuilt = reload->entries[entry_index] == entry;
+        }
+        if(rebuilt) {
+            continue;
+        }
+
+        ShaderInterface shader_interface = {};
+        if(!reflect_shader_data(&pipeline_cache->shaders, &entry->key, &shader_interface) || !shader_interface_layout_equal(&shader_interface, &entry->shader_interface)) {
+            printf("A pipeline's descriptor sets or push constants changed, restart to pick them up.\n");
+            continue;
+        }
+
+        if(entry->pipeline != VK_NULL_HANDLE) {
+            DeletionQueue::Entry deletion_entry = { .kind = DeletionQueue::Kind::PIPELINE, .handle = { .pipeline = entry->pipeline } };
+            deletion_queue_push(renderer, &deletion_entry);
+        }
+        entry->shader_interface = shader_interface;
+        entry->pipeline = VK_NULL_HANDLE;
+        entry->result = VK_INCOMPLETE;
+        entry->building = true;
+        job_pool_submit(renderer->job_pool, pipeline_build_job, entry, &entry->counter);
+    }
+}
+
+//Called by draw_frame() between frames: swaps in what a finished reload built and starts a reload for sources saved
+//since. Never waits on a running one
+void shader_reload_update(VulkanRenderer* renderer) {
+    ShaderReload* reload = &renderer->shader_reload;
+    if(!reload->watch.state) {
+        return;
+    }
+
+    DirectoryListing changed = {};
+    platform_poll_directory_watch(&reload->watch, &changed);
+    for(size_t entry_index = 0; entry_index < changed.count; ++entry_index) {
+        const char* extension = strrchr(changed.entries[entry_index], '.');
+        if(!extension || (strcmp(extension, ".vert") != 0 && strcmp(extension, ".frag") != 0)) {
+            continue;
+        }
+
+        bool seen = false;
+        for(size_t pending_index = 0; pending_index < reload->pending_count && !seen; ++pending_index) {
+            seen = strcmp(reload->pending[pending_index], changed.entries[entry_index]) == 0;
+        }
+        if(!seen && reload->pending_count < ShaderReload::MAX_SOURCES) {
+            strcpy_s(reload->pending[reload->pending_count++], MAX_PATH, changed.entries[entry_index]);
+        }
+    }
+
+    if(reload->running) {
+        if(reload->counter.pending.load(std::memory_order_acquire) > 0) {
+            return;
+        }
+        reload->running = false;
+
+        //Frames already submitted keep drawing with the old pipelines, they go once those have all completed. Pipeline
+        //cache builds still reading the old modules finish first, then build again from the new ones
+        if(reload->succeeded) {
+            reload->succeeded = false;
+            pipeline_cache_wait(renderer);
+            for(size_t entry_index = 0; entry_index < reload->entry_count; ++entry_index) {
+                PipelineCache::Entry* cache_entry = reload->entries[entry_index];
+                DeletionQueue::Entry entry = { .kind = DeletionQueue::Kind::PIPELINE, .handle = { .pipeline = cache_entry->pipeline } };
+                deletion_queue_push(renderer, &entry);
+                cache_entry->pipeline = reload->pipelines[entry_index];
+                reload->pipelines[entry_index] = VK_NULL_HANDLE;
+            }
+            destroy_shader_data(renderer, &renderer->pipeline_cache.shaders);
+            renderer->pipeline_cache.shaders = reload->shaders;
+            reload->shaders = {};
+            shader_reload_requeue(renderer);
+
+            f64 milliseconds = static_cast<f64>(std::chrono::duration_cast<Time::Nanoseconds>(Time::Clock::now() - reload->start).count()) / 1'000'000.0;
+            printf("Shaders reloaded in %.1f ms\n", milliseconds);
+        }
+    }
+
+    if(reload->pending_count == 0) {
+        return;
+    }
+
+    //Sources and the pending list share names: "shader.vert" compiles to shaders/compiled/shader_vert.spv
+    for(size_t pending_index = 0; pending_index < reload->pending_count; ++pending_index) {
+        ShaderReload::Compile* compile = &reload->compiles[pending_index];
+        char stage_name[MAX_PATH] = "";
+        strcpy_s(stage_name, MAX_PATH, reload->pending[pending_index]);
+        *strrchr(stage_name, '.') = '_';
+
+        snprintf(compile->source_path, MAX_PATH, "%s%s", ShaderReload::SOURCE_DIRECTORY, reload->pending[pending_index]);
+        snprintf(compile->spirv_path, MAX_PATH, "%s%s.spv", ShaderReload::COMPILED_DIRECTORY, stage_name);
+        compile->compiled = false;
+    }
+    reload->compile_count = reload->pending_count;
+    reload->pending_count = 0;
+
+    //Cached pipelines built from an edited shader. Ones still building are requeued after the swap instead
+    PipelineCache* pipeline_cache = &renderer->pipeline_cache;
+    reload->entry_count = 0;
+    for(size_t slot = 0; slot < PipelineCache::CAPACITY; ++slot) {
+        PipelineCache::Entry* entry = &pipeline_cache->entries[slot];
+        if(entry->used && !entry->building && entry->pipeline != VK_NULL_HANDLE && shader_reload_edited(reload, &entry->key)) {
+            reload->entries[reload->entry_count++] = entry;
+        }
+    }
+
+    reload->running = true;
+    reload->succeeded = false;
+    reload->start = Time::Clock::now();
+    job_pool_submit(renderer->job_pool, shader_reload_job, renderer, &reload->counter);
+}
+
+void shader_reload_destroy(VulkanRenderer* renderer) {
+    ShaderReload* reload = &renderer->shader_reload;
+    if(reload->running) {
+        job_pool_wait(renderer->job_pool, &reload->counter);
+        reload->running = false;
+    }
+
+    for(size_t entry_index = 0; entry_index < reload->entry_count; ++entry_index) {
+        if(reload->pipelines[entry_index] != VK_NULL_HANDLE) {
+            vkDestroyPipeline(renderer->devices.logical.device, reload->pipelines[entry_index], nullptr);
+            reload->pipelines[entry_index] = VK_NULL_HANDLE;
+        }
+    }
+    reload->entry_count = 0;
+    destroy_shader_data(renderer, &reload->shaders);
+    platform_unwatch_directory(&reload->watch);
+}
+
+VkResult create_frame_buffers(VulkanRenderer* renderer) {
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    for(size_t image_index = 0; image_index < renderer->swapchain.images.count; ++image_index) {
+        VkFramebufferCreateInfo frame_buffer_create_info = {
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .renderPass = renderer->graphics_pipeline.render_pass,
+            .attachmentCount = 1,
+            .pAttachments = &renderer->swapchain.images.views[image_index],
+            .width = renderer->swapchain.extent.width,
+            .height = renderer->swapchain.extent.height,
+            .layers = 1
+        };
+
+        result = vkCreateFramebuffer(renderer->devices.logical.device, &frame_buffer_create_info, nullptr, &renderer->swapchain.images.frame_buffers[image_index]);
+        if(result != VK_SUCCESS) {
+            printf("vkCreateFramebuffer() failed. Frame Buffer[%zd]\n", image_index);
+            return result;
+        }
+    }
+
+    return result;
+}
+
+VkResult create_command_pools(VulkanRenderer* renderer) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_command_pools");
+
+    for(size_t command_pool_index = 0; command_pool_index < QueueFamilies::MAX_QUEUE_FAMILIES; ++command_pool_index) {
+        VkCommandPoolCreateInfo command_pool_create_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = get_queue_family_index(renderer, QueueFamilies::Type(command_pool_index))
+        };
+
+        result = vkCreateCommandPool(renderer->devices.logical.device, &command_pool_create_info, nullptr, &renderer->command_pools[command_pool_index].pool);
+        if(result != VK_SUCCESS) {
+            printf("vkCreateCommandPool failed. Command Pool[%zd]\n", command_pool_index);
+            //free(renderer->command_pools);
+            return result;
+        }
+    }
+
+    return result;
+}
+
+VkResult create_timeline(VulkanRenderer* renderer, Timeline* timeline) {
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    VkSemaphoreTypeCreateInfo semaphore_type_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext = nullptr,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0
+    };
+
+    VkSemaphoreCreateInfo semaphore_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &semaphore_type_create_info,
+        .flags = 0
+    };
+
+    result = vkCreateSemaphore(renderer->devices.logical.device, &semaphore_create_info, nullptr, &timeline->semaphore);
+    if(result != VK_SUCCESS) {
+        printf("vkCreateSemaphore() failed. [Timeline]\n");
+        return result;
+    }
+
+    timeline->value = 0;
+
+    return result;
+}
+
+//Blocks until the GPU has signalled value on the timeline
+VkResult timeline_wait(VulkanRenderer* renderer, Timeline* timeline, u64 value) {
+    VkSemaphoreWaitInfo semaphore_wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &timeline->semaphore,
+        .pValues = &value
+    };
+
+    return vkWaitSemaphores(renderer->devices.logical.device, &semaphore_wait_info, UINT64_MAX);
+}
+
+//Highest value the GPU has signalled so far, never blocks
+u64 timeline_completed_value(VulkanRenderer* renderer, Timeline* timeline) {
+    //Not created yet, nothing can have been submitted against it
+    if(timeline->semaphore == VK_NULL_HANDLE) {
+        return timeline->value;
+    }
+
+    u64 value = 0;
+    vkGetSemaphoreCounterValue(renderer->devices.logical.device, timeline->semaphore, &value);
+    return value;
+}
+
+VkResult allocate_command_buffers(VulkanRenderer* renderer, CommandBufferAllocationInfo* command_buffer_allocation_info) {
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    size_t command_pool_index = static_cast<size_t>(command_buffer_allocation_info->pool_type);
+
+    VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = renderer->command_pools[command_pool_index].pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = static_cast<u32>(command_buffer_allocation_info->buffer_count)
+    };
+
+    size_t buffer_type_index = 0;
+    size_t buffer_types_count = 0;
+    switch(command_buffer_allocation_info->pool_type) {
+        case QueueFamilies::Type::GRAPHICS: {
+            buffer_type_index = static_cast<size_t>(command_buffer_allocation_info->graphics_buffer_type);
+            buffer_types_count = static_cast<size_t>(CommandBuffers::Graphics::COUNT);
+        } break;
+        case QueueFamilies::Type::TRANSFER: {
+            buffer_type_index = static_cast<size_t>(command_buffer_allocation_info->transfer_buffer_type);
+            buffer_types_count = static_cast<size_t>(CommandBuffers::Transfer::COUNT);
+        } break;
+        default:
+            break;
+    }
+
+    //size_t buffer_type_index = static_cast<size_t>(command_buffer_allocation_info->buffer_type);
+
+    if(!renderer->command_pools[command_pool_index].buffers) {
+        renderer->command_pools[command_pool_index].buffers = (CommandBuffers*)memory_arena_allocate(renderer->heap_data, sizeof(CommandBuffers) * buffer_types_count);
+    }
+
+    result = vkAllocateCommandBuffers(renderer->devices.logical.device, &command_buffer_allocate_info, renderer->command_pools[command_pool_index].buffers[buffer_type_index].buffer);
+    if(result == VK_SUCCESS) {
+        if(command_buffer_allocation_info->semaphore_count > 0) {
+            VkSemaphoreCreateInfo semaphore_create_info = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0
+            };
+
+            for(size_t command_buffer_index = 0; command_buffer_index < command_buffer_allocation_info->buffer_count; ++command_buffer_index) {
+                for(size_t semaphore_index = 0; semaphore_index < command_buffer_allocation_info->semaphore_count; ++semaphore_index) {
+                    result = vkCreateSemaphore(renderer->devices.logical.device, &semaphore_create_info, nullptr, &renderer->command_pools[command_pool_index].buffers[buffer_type_index].synchro[command_buffer_index].semaphores[semaphore_index]);
+                    if(result != VK_SUCCESS) {
+                        printf("vkCreateSemaphore() failed. [Semaphore Index: %zd]\n", semaphore_index);
+                        return result;
+                    }
+                }
+            }
+        }
+    } else {
+        printf("vkAllocateCommandBuffers failed. Command Pool[%zd] Buffer Count[%zd]\n", command_pool_index, command_buffer_allocation_info->buffer_count);
+        return result;
+    }
+
+    return result;
+}
+
+VkResult create_gpu_timestamps(VulkanRenderer* renderer) {
+    VkResult result = VK_SUCCESS;
+
+    GpuTimestamps* timestamps = &renderer->gpu_timestamps;
+
+    size_t graphics_index = static_cast<size_t>(QueueFamilies::Type::GRAPHICS);
+    u32 valid_bits = renderer->queue_families.families[graphics_index].properties.timestampValidBits;
+    if(valid_bits == 0) {
+        printf("GPU timestamps unavailable. [Graphics queue has no timestamp support]\n");
+        return result;
+    }
+
+    timestamps->valid_mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+    timestamps->period_ns = static_cast<f64>(renderer->devices.physical.properties.limits.timestampPeriod);
+
+    VkQueryPoolCreateInfo query_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = GpuTimestamps::QUERIES_PER_FRAME * Swapchain::MAX_FRAMES_IN_FLIGHT,
+        .pipelineStatistics = 0
+    };
+
+    result = vkCreateQueryPool(renderer->devices.logical.device, &query_pool_create_info, nullptr, &timestamps->pool);
+    if(result != VK_SUCCESS) {
+        printf("vkCreateQueryPool() failed.\n");
+        return result;
+    }
+
+    return result;
+}
+
+void gpu_zone_begin(VulkanRenderer* renderer, VkCommandBuffer command_buffer, GpuZone zone) {
+    GpuTimestamps* timestamps = &renderer->gpu_timestamps;
+    if(timestamps->pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    u32 query = static_cast<u32>(renderer->swapchain.current_frame_index) * GpuTimestamps::QUERIES_PER_FRAME + static_cast<u32>(zone) * 2;
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamps->pool, query);
+}
+
+void gpu_zone_end(VulkanRenderer* renderer, VkCommandBuffer command_buffer, GpuZone zone) {
+    GpuTimestamps* timestamps = &renderer->gpu_timestamps;
+    if(timestamps->pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    u32 query = static_cast<u32>(renderer->swapchain.current_frame_index) * GpuTimestamps::QUERIES_PER_FRAME + static_cast<u32>(zone) * 2 + 1;
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps->pool, query);
+}
+
+//Only called once the frame's previous submit has completed. No WAIT flag, a frame whose submit never went through reports
+//VK_NOT_READY and is skipped
+void collect_gpu_timestamps(VulkanRenderer* renderer, size_t frame_index) {
+    GpuTimestamps* timestamps = &renderer->gpu_timestamps;
+    if(timestamps->pool == VK_NULL_HANDLE || !timestamps->written[frame_index]) {
+        return;
+    }
+    timestamps->written[frame_index] = false;
+
+    u64 results[GpuTimestamps::QUERIES_PER_FRAME];
+    u32 first_query = static_cast<u32>(frame_index) * GpuTimestamps::QUERIES_PER_FRAME;
+    VkResult result = vkGetQueryPoolResults(renderer->devices.logical.device, timestamps->pool, first_query, GpuTimestamps::QUERIES_PER_FRAME, sizeof(results), results, sizeof(u64), VK_QUERY_RESULT_64_BIT);
+    if(result != VK_SUCCESS) {
+        return;
+    }
+
+    for(size_t zone_index = 0; zone_index < GPU_ZONE_COUNT; ++zone_index) {
+        u64 ticks = ((results[zone_index * 2 + 1] & timestamps->valid_mask) - (results[zone_index * 2] & timestamps->valid_mask)) & timestamps->valid_mask;
+        Time::Duration duration = Time::Duration(static_cast<i64>(static_cast<f64>(ticks) * timestamps->period_ns));
+        profiler_gpu_zone_record(renderer->profiler, GpuZone(zone_index), duration);
+    }
+}
+
+VkResult record_command_buffer(VulkanRenderer* renderer, VkCommandBuffer command_buffer, size_t image_index) {
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    VkCommandBufferBeginInfo command_buffer_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr
+    };
+
+    result = vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
+    if(result != VK_SUCCESS) {
+        printf("vkBeginCommandBuffer() failed.\n");
+        return result;
+    }
+
+    GpuTimestamps* timestamps = &renderer->gpu_timestamps;
+    if(timestamps->pool != VK_NULL_HANDLE) {
+        u32 first_query = static_cast<u32>(renderer->swapchain.current_frame_index) * GpuTimestamps::QUERIES_PER_FRAME;
+        vkCmdResetQueryPool(command_buffer, timestamps->pool, first_query, GpuTimestamps::QUERIES_PER_FRAME);
+        timestamps->written[renderer->swapchain.current_frame_index] = true;
+    }
+    gpu_zone_begin(renderer, command_buffer, GpuZone::FRAME);
+
+    VkRenderPassBeginInfo render_pass_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext = nullptr,
+        .renderPass = renderer->graphics_pipeline.render_pass,
+        .framebuffer = renderer->swapchain.images.frame_buffers[image_index],
+        .renderArea = {
+            .offset = { 0, 0 },
+            .extent = renderer->swapchain.extent },
+        .clearValueCount = 1,
+        .pClearValues = &renderer->graphics_pipeline.clear_color
+    };
+
+    gpu_zone_begin(renderer, command_buffer, GpuZone::SPRITE_PASS);
+    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_cache_find(renderer, &renderer->graphics_pipeline.key));
+
+    //Pipeline Dynamic State stuff VVV
+    VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = static_cast<float>(renderer->swapchain.extent.width),
+        .height = static_cast<float>(renderer->swapchain.extent.height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {
+        .offset = { 0, 0 },
+        .extent = renderer->swapchain.extent
     };
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    //End Pipeline Dynamic State stuff
+
+    //Uniforms and instances both live in the upload ring, only the offsets change from frame to frame
+    size_t frame_index = renderer->swapchain.current_frame_index;
+    VkBuffer vertex_buffers[] = { renderer->graphics_pipeline.vertex_buffer.buffer, renderer->upload_ring.buffer.buffer };
+    VkDeviceSize offsets[] = { 0, renderer->graphics_pipeline.instance_range.offset };
+    vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
+    vkCmdBindIndexBuffer(command_buffer, renderer->graphics_pipeline.index_buffer.buffer, 0, VkIndexType::VK_INDEX_TYPE_UINT16);
+
+    u32 uniform_offset = static_cast<u32>(renderer->graphics_pipeline.uniform_range.offset);
+    VkDescriptorSet descriptor_sets[] = { renderer->graphics_pipeline.descriptor_sets[frame_index], renderer->texture_atlas.descriptor_set };
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->graphics_pipeline.layout, 0, 2, descriptor_sets, 1, &uniform_offset);
+
+    //One draw for every sprite, the quad is shared and each instance supplies its own transform, texture and tint
+    if(renderer->graphics_pipeline.instance_count > 0) {
+        vkCmdDrawIndexed(command_buffer, 6, renderer->graphics_pipeline.instance_count, 0, 0, 0);
+    }
+    //vkCmdDraw(command_buffer, 9, 1, 0, 0);\
 
-    VkPipelineVertexInputStateCreateInfo pipeline_vertex_input_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = vertex_input_binding_descriptions,
-        .vertexAttributeDescriptionCount = 3,
-        .pVertexAttributeDescriptions = vertex_input_attribute_descriptions
-    };
+    vkCmdEndRenderPass(command_buffer);
+    gpu_zone_end(renderer, command_buffer, GpuZone::SPRITE_PASS);
 
-    VkPipelineInputAssemblyStateCreateInfo pipeline_input_assembly_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .topology = VkPrimitiveTopology::VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE
-    };
+    gpu_zone_end(renderer, command_buffer, GpuZone::FRAME);
 
-    VkPipelineTessellationStateCreateInfo pipeline_tesselation_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .patchControlPoints = 0
-    };
+    result = vkEndCommandBuffer(command_buffer);
+    if(result != VK_SUCCESS) {
+        printf("vkEndCommandBuffer() failed.\n");
+        return result;
+    }
 
-    //We're trying out the dynamic states, but this is the explicit version, maybe the source of our triangle not being scaled/centered on resize
-    // VkViewport viewport = {
-    //     .x = 0,
-    //     .y = 0,
-    //     .width = static_cast<f32>(renderer->swapchain.extent.width),
-    //     .height = static_cast<f32>(renderer->swapchain.extent.height),
-    //     .minDepth = 0.0f,
-    //     .maxDepth = 1.0f
-    // };
+    return result;
+}
 
-    // VkRect2D scissor = {
-    //     .offset = { 0, 0 },
-    //     .extent = renderer->swapchain.extent
-    // };
+VkResult draw_frame(VulkanRenderer* renderer, Time::Duration delta_time) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("draw_frame");
 
-    VkPipelineViewportStateCreateInfo pipeline_viewport_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .viewportCount = 1,
-        .pViewports = nullptr, //&viewport,
-        .scissorCount = 1,
-        .pScissors = nullptr //&scissor
-    };
+    size_t frame_index = renderer->swapchain.current_frame_index;
+    size_t command_pool_index = static_cast<size_t>(QueueFamilies::Type::GRAPHICS);
+    CommandPool* command_pool = &renderer->command_pools[command_pool_index];
 
-    VkPipelineRasterizationStateCreateInfo pipeline_rasterization_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = VkPolygonMode::VK_POLYGON_MODE_FILL,
-        .cullMode = VkCullModeFlagBits::VK_CULL_MODE_BACK_BIT,
-        .frontFace = VkFrontFace::VK_FRONT_FACE_CLOCKWISE,
-        .depthBiasEnable = VK_FALSE,
-        .depthBiasConstantFactor = 0.0f,
-        .depthBiasClamp = 0.0f,
-        .depthBiasSlopeFactor = 0.0f,
-        .lineWidth = 1.0f
-    };
+    size_t buffer_type_index = static_cast<size_t>(CommandBuffers::Graphics::DRAW_FRAME);
+    CommandBuffers* command_buffers = &command_pool->buffers[buffer_type_index];
 
-    VkPipelineMultisampleStateCreateInfo pipeline_multisample_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .rasterizationSamples = VkSampleCountFlagBits::VK_SAMPLE_COUNT_1_BIT,
-        .sampleShadingEnable = VK_FALSE,
-        .minSampleShading = 1.0f,
-        .pSampleMask = nullptr,
-        .alphaToCoverageEnable = VK_FALSE,
-        .alphaToOneEnable = VK_FALSE
-    };
+    memory_arena_reset(temporary_memory);
 
-    VkPipelineDepthStencilStateCreateInfo pipeline_depth_stencil_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .depthTestEnable = VK_FALSE,
-        .depthWriteEnable = VK_FALSE,
-        .depthBoundsTestEnable = VK_FALSE,
-        .stencilTestEnable = VK_FALSE,
-        .front = {},
-        .back = {},
-        .minDepthBounds = 0.0f,
-        .maxDepthBounds = 1.0f
-    };
+    //Waits for the submit that last used this frame's slot, value 0 on the first pass returns straight away
+    Time::Stamp wait_start = Time::Clock::now();
+    profiler_zone_begin(renderer->profiler, ProfileZone::FRAME_WAIT);
+    result = timeline_wait(renderer, &renderer->graphics_timeline, renderer->frame_timeline_values[frame_index]);
+    if(result != VK_SUCCESS) {
+        printf("timeline_wait() failed.\n");
+        profiler_zone_end(renderer->profiler, ProfileZone::FRAME_WAIT);
+        return result;
+    }
+    profiler_zone_end(renderer->profiler, ProfileZone::FRAME_WAIT);
+    Time::Duration blocked = Time::Clock::now() - wait_start;
 
-    //The tutorial only has one attachment, let's try that
-    // VkPipelineColorBlendAttachmentState* pipeline_color_blend_attachment_states = (VkPipelineColorBlendAttachmentState*)malloc(sizeof(VkPipelineColorBlendAttachmentState) * renderer->swapchain.images.count);
-    // for(size_t image_index = 0; image_index < renderer->swapchain.images.count; ++image_index) {
-    //     pipeline_color_blend_attachment_states[image_index] = {
-    //         .blendEnable = VK_FALSE,
-    //         .srcColorBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ONE,
-    //         .dstColorBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ZERO,
-    //         .colorBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
-    //         .srcAlphaBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ONE,
-    //         .dstAlphaBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ZERO,
-    //         .alphaBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
-    //         .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
-    //     };
-    // }
+    //The wait covers this frame's previous submit, so its timestamps are ready to read
+    collect_gpu_timestamps(renderer, frame_index);
 
-    VkPipelineColorBlendAttachmentState pipeline_color_blend_attachment_state = {
-        .blendEnable = VK_FALSE,
-        .srcColorBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ONE,
-        .dstColorBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ZERO,
-        .colorBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VkBlendFactor::VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VkBlendOp::VK_BLEND_OP_ADD,
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
-    };
+    deletion_queue_collect(renderer, false);
+    shader_reload_update(renderer);
 
-    VkPipelineColorBlendStateCreateInfo pipeline_color_blend_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0, //Do we want VK_PIPELINE_COLOR_BLEND_STATE_CREATE_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_BIT_EXT to hook into the implicit synchro steps? Probably not
-        .logicOpEnable = VK_FALSE,
-        .logicOp = VkLogicOp::VK_LOGIC_OP_COPY,
-        .attachmentCount = 1, //static_cast<u32>(renderer->swapchain.images.count),
-        .pAttachments = &pipeline_color_blend_attachment_state,
-        .blendConstants = { 0.0f, 0.0f, 0.0f, 0.0f }
-    };
+    //Anything queued since the last frame goes out ahead of this frame's submit on the graphics queue
+    upload_manager_collect(renderer);
+    result = upload_manager_flush(renderer);
+    if(result != VK_SUCCESS) {
+        printf("upload_manager_flush() failed.\n");
+        return result;
+    }
 
-    //Here's our dynamic states, see above
-    VkDynamicState dynamic_states[] = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
+    //Safe to reuse, the timeline wait above guarantees the GPU is done with this frame's partition of the upload ring.
+    //Filled before acquiring, once an image is acquired the frame has to be submitted and presented
+    upload_ring_begin_frame(&renderer->upload_ring, frame_index);
+
+    profiler_zone_begin(renderer->profiler, ProfileZone::UNIFORM_UPDATE);
+
+    result = update_uniform_buffer(renderer, frame_index, delta_time);
+    if(result != VK_SUCCESS) {
+        printf("update_uniform_buffer() failed.\n");
+        profiler_zone_end(renderer->profiler, ProfileZone::UNIFORM_UPDATE);
+        return result;
+    }
+
+    result = update_instance_buffer(renderer, frame_index);
+    if(result != VK_SUCCESS) {
+        printf("update_instance_buffer() failed.\n");
+        profiler_zone_end(renderer->profiler, ProfileZone::UNIFORM_UPDATE);
+        return result;
+    }
+    profiler_zone_end(renderer->profiler, ProfileZone::UNIFORM_UPDATE);
+
+    VkSemaphore image_available_semaphore = command_buffers->synchro[frame_index].semaphores[0];
+    size_t image_index = frame_index;
+    bool suboptimal = false;
+    Time::Stamp acquire_start = Time::Clock::now();
+    profiler_zone_begin(renderer->profiler, ProfileZone::ACQUIRE);
+    if(!renderer->offscreen) {
+        result = vkAcquireNextImageKHR(renderer->devices.logical.device, renderer->swapchain.swapchain, UINT64_MAX, image_available_semaphore, VK_NULL_HANDLE, reinterpret_cast<u32*>(&image_index));
+        if(result == VK_ERROR_OUT_OF_DATE_KHR) {
+            profiler_zone_end(renderer->profiler, ProfileZone::ACQUIRE);
+            VkResult resize_result = resize(renderer);
+            if(resize_result != VK_SUCCESS) {
+                printf("resize() failed. [%s]\n", string_VkResult(resize_result));
+            }
+            return result;
+        } else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            printf("vkAcquireNextImageKHR() failed.\n");
+            profiler_zone_end(renderer->profiler, ProfileZone::ACQUIRE);
+            return result;
+        }
+        //A suboptimal image is still acquired and its semaphore signalled, so the frame is drawn and resized after presenting
+        suboptimal = result == VK_SUBOPTIMAL_KHR;
+        renderer->swapchain.image_acquired = true;
+    }
+
+    profiler_zone_end(renderer->profiler, ProfileZone::ACQUIRE);
+    renderer->frame_pacing_state.blocked = blocked + (Time::Clock::now() - acquire_start);
+    renderer->frame_pacing_state.measured = true;
+
+    profiler_zone_begin(renderer->profiler, ProfileZone::RECORD);
+    VkCommandBuffer command_buffer = command_buffers->buffer[frame_index];
+    result = vkResetCommandBuffer(command_buffer, 0);
+    if(result != VK_SUCCESS) {
+        printf("vkResetCommandBuffer() failed.\n");
+        profiler_zone_end(renderer->profiler, ProfileZone::RECORD);
+        return result;
+    }
+
+    result = record_command_buffer(renderer, command_buffer, image_index);
+    if(result != VK_SUCCESS) {
+        printf("record_command_buffer() failed.\n");
+        profiler_zone_end(renderer->profiler, ProfileZone::RECORD);
+        return result;
+    }
+    profiler_zone_end(renderer->profiler, ProfileZone::RECORD);
+
+    VkPipelineStageFlags wait_stages[] = {
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
     };
 
-    VkPipelineDynamicStateCreateInfo pipeline_dynamic_state_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+    VkSemaphore render_finished_semaphore = command_buffers->synchro[frame_index].semaphores[1];
+
+    //The swapchain only takes binary semaphores, so they sit next to the graphics timeline. Their values are ignored
+    u64 frame_value = renderer->graphics_timeline.value + 1;
+    VkSemaphore signal_semaphores[] = { renderer->graphics_timeline.semaphore, render_finished_semaphore };
+    u64 wait_values[] = { 0 };
+    u64 signal_values[] = { frame_value, 0 };
+
+    //Offscreen targets are never acquired or presented, so there is nothing to wait on or signal
+    u32 semaphore_count = renderer->offscreen ? 0 : 1;
+    VkTimelineSemaphoreSubmitInfo timeline_submit_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
         .pNext = nullptr,
-        .flags = 0,
-        .dynamicStateCount = 2,
-        .pDynamicStates = dynamic_states
+        .waitSemaphoreValueCount = semaphore_count,
+        .pWaitSemaphoreValues = wait_values,
+        .signalSemaphoreValueCount = 1 + semaphore_count,
+        .pSignalSemaphoreValues = signal_values
     };
 
-    VkDescriptorSetLayoutBinding ubo_layout_binding = {
-        .binding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-        .pImmutableSamplers = nullptr
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_submit_info,
+        .waitSemaphoreCount = semaphore_count,
+        .pWaitSemaphores = &image_available_semaphore,
+        .pWaitDstStageMask = wait_stages,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &command_buffer,
+        .signalSemaphoreCount = 1 + semaphore_count,
+        .pSignalSemaphores = signal_semaphores
     };
 
-    VkDescriptorSetLayoutBinding sampler_layout_binding = {
-        .binding = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .pImmutableSamplers = nullptr
-    };
+    //Another spot that we can make use of the get_queue_family_index(QueueFamilies::Type type) function
+    VkQueue queue = renderer->queue_families.families[0].queues[0];
+    profiler_zone_begin(renderer->profiler, ProfileZone::SUBMIT);
+    result = vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE);
+    if(result != VK_SUCCESS) {
+        printf("vkQueueSubmit() failed.\n");
+        profiler_zone_end(renderer->profiler, ProfileZone::SUBMIT);
+        return result;
+    }
+    renderer->graphics_timeline.value = frame_value;
+    renderer->frame_timeline_values[frame_index] = frame_value;
+    profiler_zone_end(renderer->profiler, ProfileZone::SUBMIT);
+
+    if(!renderer->offscreen) {
+        VkPresentInfoKHR present_info = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &render_finished_semaphore,
+            .swapchainCount = 1,
+            .pSwapchains = &renderer->swapchain.swapchain,
+            .pImageIndices = reinterpret_cast<const u32*>(&image_index),
+            .pResults = nullptr
+        };
 
-    VkDescriptorSetLayoutBinding bindings[] = {
-        ubo_layout_binding,
-        sampler_layout_binding
-    };
+        profiler_zone_begin(renderer->profiler, ProfileZone::PRESENT);
+        result = vkQueuePresentKHR(queue, &present_info);
+        profiler_zone_end(renderer->profiler, ProfileZone::PRESENT);
+        //Out of date presents still wait on render_finished_semaphore, so the frame's slot is used up either way
+        if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || (result == VK_SUCCESS && suboptimal)) {
+            result = resize(renderer);
+            if(result != VK_SUCCESS) {
+                printf("resize() failed. [%s]\n", string_VkResult(result));
+            }
+        } else if(result != VK_SUCCESS) {
+            printf("vkQueuePresentKHR() failed.\n");
+        }
+    }
 
-    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .bindingCount = 2,
-        .pBindings = bindings
-    };
+    renderer->swapchain.current_frame_index = (renderer->swapchain.current_frame_index + 1) % renderer->swapchain.frames_in_flight;
 
-    result = vkCreateDescriptorSetLayout(renderer->devices.logical.device, &descriptor_set_layout_create_info, nullptr, &renderer->graphics_pipeline.descriptor_set_layout);
+    return result;
+}
+
+VkResult resize(VulkanRenderer* renderer) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("resize");
+
+    //Offscreen targets have a fixed extent, there is no surface to follow
+    if(renderer->offscreen) {
+        return VK_SUCCESS;
+    }
+
+    result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(renderer->devices.physical.device, renderer->surface, &renderer->swapchain.support_info.capabilities);
     if(result != VK_SUCCESS) {
-        printf("vkCreateDescriptorSetLayout() failed.\n");
+        printf("vkGetPhysicalDeviceSurfaceCapabilitiesKHR() failed.\n");
         return result;
     }
 
-    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .setLayoutCount = 1,
-        .pSetLayouts = &renderer->graphics_pipeline.descriptor_set_layout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr
-    };
+    //Minimized, keep the current swapchain until the window has an area again
+    VkExtent2D extent = renderer->swapchain.support_info.capabilities.currentExtent;
+    if(extent.width == 0 || extent.height == 0) {
+        return VK_SUCCESS;
+    }
 
-    result = vkCreatePipelineLayout(renderer->devices.logical.device, &pipeline_layout_create_info, nullptr, &renderer->graphics_pipeline.layout);
+    //Frames in flight keep rendering to the old swapchain, it is handed over as oldSwapchain and destroyed later
+    DeletionQueue::Entry swapchain_entry = { .kind = DeletionQueue::Kind::SWAPCHAIN, .handle = { .swapchain = renderer->swapchain.swapchain } };
+    Swapchain::Images images = renderer->swapchain.images;
+    bool image_acquired = renderer->swapchain.image_acquired;
+
+    result = create_swapchain(renderer);
     if(result != VK_SUCCESS) {
-        printf("vkCreatePipelineLayout() failed.\n");
+        printf("create_swapchain() failed.\n");
         return result;
     }
+    renderer->swapchain.image_acquired = false;
+
+    //Dragging the window resizes many times between frames, none of those intermediate swapchains were ever used.
+    //Otherwise the deletion queue holds on to it until the first frame submitted after the resize completes, the
+    //graphics queue only starts that frame after the old swapchain's last present
+    destroy_swapchain_images(renderer, &images, image_acquired);
+    if(image_acquired) {
+        deletion_queue_push(renderer, &swapchain_entry);
+    } else {
+        deletion_queue_destroy_entry(renderer, &swapchain_entry);
+    }
 
-    VkAttachmentDescription color_attachment = {
-        .flags = 0,
-        .format = renderer->swapchain.surface_format.format,
-        .samples = VkSampleCountFlagBits::VK_SAMPLE_COUNT_1_BIT,
-        .loadOp = VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp = VkAttachmentStoreOp::VK_ATTACHMENT_STORE_OP_STORE,
-        .stencilLoadOp = VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-        .stencilStoreOp = VkAttachmentStoreOp::VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VkImageLayout::VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-    };
+    result = create_frame_buffers(renderer);
+    if(result != VK_SUCCESS) {
+        printf("create_frame_buffers() failed.\n");
+        return result;
+    }
+
+    return result;
+}
+
+//Swapchain images belong to the swapchain, only offscreen targets are destroyed and freed here
+void destroy_swapchain_images(VulkanRenderer* renderer, Swapchain::Images* images, bool deferred) {
+    for(size_t image_index = 0; image_index < images->count; ++image_index) {
+        DeletionQueue::Entry entries[] = {
+            { .kind = DeletionQueue::Kind::FRAMEBUFFER, .handle = { .framebuffer = images->frame_buffers[image_index] } },
+            { .kind = DeletionQueue::Kind::IMAGE_VIEW, .handle = { .image_view = images->views[image_index] } },
+            { .kind = DeletionQueue::Kind::IMAGE, .handle = { .image = images->images[image_index] }, .allocation = images->allocations[image_index] }
+        };
+
+        size_t entry_count = renderer->offscreen ? 3 : 2;
+        for(size_t entry_index = 0; entry_index < entry_count; ++entry_index) {
+            if(deferred) {
+                deletion_queue_push(renderer, &entries[entry_index]);
+            } else {
+                deletion_queue_destroy_entry(renderer, &entries[entry_index]);
+            }
+        }
+    }
+    images->count = 0;
+}
 
-    VkAttachmentReference color_attachment_reference = {
-        .attachment = 0,
-        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    };
+//Points through the sprite shaders. A variant of the sprite pipeline's key, so once built it's a lookup
+VkResult create_point_pipeline(VulkanRenderer* renderer, VkPipeline* pipeline) {
+    PipelineKey key = renderer->graphics_pipeline.key;
+    key.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+    key.cull_mode = VK_CULL_MODE_NONE;
+    return pipeline_cache_get(renderer, &key, pipeline);
+}
 
-    VkSubpassDescription subpass_description = {
-        .flags = 0,
-        .pipelineBindPoint = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS,
-        .inputAttachmentCount = 0,
-        .pInputAttachments = VK_NULL_HANDLE,
-        //use swapchain.images.count if we need an attachment per frame buffer
-        .colorAttachmentCount = 1,
-        //The index of the attachment in this array is directly referenced from the fragment shader
-        //with the layout(location = 0) out vec4 outColor directive
-        .pColorAttachments = &color_attachment_reference,
-        .pResolveAttachments = VK_NULL_HANDLE,
-        .pDepthStencilAttachment = VK_NULL_HANDLE,
-        .preserveAttachmentCount = 0,
-        .pPreserveAttachments = VK_NULL_HANDLE
-    };
+VkResult create_buffer(VulkanRenderer* renderer, BufferAllocationInfo* buffer_allocation_info) {
+    VkResult result;
 
-    VkSubpassDependency subpass_dependency = {
-        .srcSubpass = VK_SUBPASS_EXTERNAL,
-        .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask = 0,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
-    };
+    //Concurrent sharing requires distinct families, which we don't have when transfers run on the graphics family
+    bool concurrent = buffer_allocation_info->sharing_mode == VK_SHARING_MODE_CONCURRENT && has_dedicated_transfer_family(renderer);
 
-    VkRenderPassCreateInfo render_pass_create_info = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+    VkBufferCreateInfo buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = nullptr,
         .flags = 0,
-        .attachmentCount = 1,
-        .pAttachments = &color_attachment,
-        .subpassCount = 1,
-        .pSubpasses = &subpass_description,
-        .dependencyCount = 1,
-        .pDependencies = &subpass_dependency
+        .size = buffer_allocation_info->size,
+        .usage = buffer_allocation_info->usage_flags,
+        .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = concurrent ? buffer_allocation_info->queue_families_indices_count : 0,
+        .pQueueFamilyIndices = concurrent ? buffer_allocation_info->queue_family_indices : nullptr
     };
 
-    result = vkCreateRenderPass(renderer->devices.logical.device, &render_pass_create_info, nullptr, &renderer->graphics_pipeline.render_pass);
+    result = vkCreateBuffer(renderer->devices.logical.device, &buffer_create_info, nullptr, &buffer_allocation_info->buffer->buffer);
     if(result != VK_SUCCESS) {
-        printf("ckCreateRenderPass() failed.\n");
+        printf("vkCreateBuffer() failed.\n");
         return result;
     }
 
-    VkGraphicsPipelineCreateInfo graphics_pipeline_create_info = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext = nullptr,
-        //Consider the optional VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR and VK_PIPELINE_CREATE_CAPTURE_INTERNAL_REPRESENTATIONS_BIT_KHR flags to deduce some debug info?
-        .flags = 0,
-        .stageCount = static_cast<u32>(renderer->graphics_pipeline.shader_data.count),
-        .pStages = pipeline_shader_stage_create_infos,
-        .pVertexInputState = &pipeline_vertex_input_state_create_info,
-        .pInputAssemblyState = &pipeline_input_assembly_state_create_info,
-        .pTessellationState = &pipeline_tesselation_state_create_info,
-        .pViewportState = &pipeline_viewport_state_create_info,
-        .pRasterizationState = &pipeline_rasterization_state_create_info,
-        .pMultisampleState = &pipeline_multisample_state_create_info,
-        .pDepthStencilState = &pipeline_depth_stencil_state_create_info,
-        .pColorBlendState = &pipeline_color_blend_state_create_info,
-        //VVV This was true before, we're trying dynamic states at the moment
-        //Our pipeline is completely explicit, no dynamic state involved
-        .pDynamicState = &pipeline_dynamic_state_create_info,
-        .layout = renderer->graphics_pipeline.layout,
-        .renderPass = renderer->graphics_pipeline.render_pass,
-        .subpass = 0,
-        .basePipelineHandle = VK_NULL_HANDLE,
-        .basePipelineIndex = -1
-    };
+    VkMemoryRequirements buffer_memory_requirements;
+    vkGetBufferMemoryRequirements(renderer->devices.logical.device, buffer_allocation_info->buffer->buffer, &buffer_memory_requirements);
 
-    result = vkCreateGraphicsPipelines(renderer->devices.logical.device, VK_NULL_HANDLE, 1, &graphics_pipeline_create_info, nullptr, &renderer->graphics_pipeline.pipeline);
+    GpuAllocation* allocation = &buffer_allocation_info->buffer->allocation;
+    result = gpu_allocate(renderer->gpu_allocator, &buffer_memory_requirements, buffer_allocation_info->memory_properties, GpuResourceKind::LINEAR, allocation);
     if(result != VK_SUCCESS) {
-        printf("vkCreateGraphicsPipelines() failed.\n");
+        printf("gpu_allocate() failed.\n");
         return result;
     }
 
-    //Destroy shader modules on success
-
-    return result;
-}
-
-VkResult create_frame_buffers(VulkanRenderer* renderer) {
-    VkResult result = VK_ERROR_UNKNOWN;
-
-    renderer->swapchain.images.frame_buffers = (VkFramebuffer*)malloc(sizeof(VkFramebuffer) * renderer->swapchain.images.count);
-    for(size_t image_index = 0; image_index < renderer->swapchain.images.count; ++image_index) {
-        VkFramebufferCreateInfo frame_buffer_create_info = {
-            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .renderPass = renderer->graphics_pipeline.render_pass,
-            .attachmentCount = 1,
-            .pAttachments = &renderer->swapchain.images.views[image_index],
-            .width = renderer->swapchain.extent.width,
-            .height = renderer->swapchain.extent.height,
-            .layers = 1
-        };
+    result = vkBindBufferMemory(renderer->devices.logical.device, buffer_allocation_info->buffer->buffer, allocation->memory, allocation->offset);
+    if(result != VK_SUCCESS) {
+        printf("vkBindBufferMemory() failed.\n");
+        return result;
+    }
 
-        result = vkCreateFramebuffer(renderer->devices.logical.device, &frame_buffer_create_info, nullptr, &renderer->swapchain.images.frame_buffers[image_index]);
-        if(result != VK_SUCCESS) {
-            printf("vkCreateFramebuffer() failed. Frame Buffer[%zd]\n", image_index);
-            //free(renderer->swapchain.images.frame_buffers);
+    //Host visible blocks stay mapped for their lifetime, so mapping is just an offset into the block
+    if(buffer_allocation_info->map_memory) {
+        if(!allocation->mapped) {
+            result = VK_ERROR_MEMORY_MAP_FAILED;
+            printf("create_buffer() failed. [map_memory requested on memory that isn't host visible]\n");
             return result;
         }
+        buffer_allocation_info->buffer->data = allocation->mapped;
     }
 
     return result;
 }
 
-VkResult create_command_pools(VulkanRenderer* renderer) {
-    VkResult result = VK_ERROR_UNKNOWN;
+void destroy_buffer(VulkanRenderer* renderer, Buffer* buffer) {
+    vkDestroyBuffer(renderer->devices.logical.device, buffer->buffer, nullptr);
+    gpu_free(renderer->gpu_allocator, &buffer->allocation);
+    *buffer = {};
+}
 
-    for(size_t command_pool_index = 0; command_pool_index < QueueFamilies::MAX_QUEUE_FAMILIES; ++command_pool_index) {
-        VkCommandPoolCreateInfo command_pool_create_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-            .queueFamilyIndex = get_queue_family_index(renderer, QueueFamilies::Type(command_pool_index))
-        };
+VkResult create_deletion_queue(VulkanRenderer* renderer) {
+    VkResult result = VK_SUCCESS;
 
-        result = vkCreateCommandPool(renderer->devices.logical.device, &command_pool_create_info, nullptr, &renderer->command_pools[command_pool_index].pool);
-        if(result != VK_SUCCESS) {
-            printf("vkCreateCommandPool failed. Command Pool[%zd]\n", command_pool_index);
-            //free(renderer->command_pools);
-            return result;
-        }
+    renderer->deletion_queue.entries = push_array<DeletionQueue::Entry>(renderer->heap_data, DeletionQueue::CAPACITY);
+    if(!renderer->deletion_queue.entries) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("push_array() failed. [DeletionQueue %zd entries]\n", DeletionQueue::CAPACITY);
+        return result;
     }
+    renderer->deletion_queue.count = 0;
 
     return result;
 }
 
-VkResult allocate_command_buffers(VulkanRenderer* renderer, CommandBufferAllocationInfo* command_buffer_allocation_info) {
-    VkResult result = VK_ERROR_UNKNOWN;
+//Safe to call from anywhere between frames or while recording. Null handles are skipped when the entry is destroyed
+void deletion_queue_push(VulkanRenderer* renderer, DeletionQueue::Entry* entry) {
+    DeletionQueue* queue = &renderer->deletion_queue;
 
-    size_t command_pool_index = get_queue_family_index(renderer, command_buffer_allocation_info->pool_type);
+    //Only a renderer that failed before create_deletion_queue() gets here without one, nothing was submitted yet
+    if(!queue->entries) {
+        deletion_queue_destroy_entry(renderer, entry);
+        return;
+    }
 
-    VkCommandBufferAllocateInfo command_buffer_allocate_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext = nullptr,
-        .commandPool = renderer->command_pools[command_pool_index].pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = static_cast<u32>(command_buffer_allocation_info->buffer_count)
-    };
+    if(!entry->timeline) {
+        entry->timeline = &renderer->graphics_timeline;
+    }
+    if(entry->timeline_value == 0) {
+        entry->timeline_value = entry->timeline->value + 1;
+    }
 
-    size_t buffer_type_index = 0;
-    size_t buffer_types_count = 0;
-    switch(command_buffer_allocation_info->pool_type) {
-        case QueueFamilies::Type::GRAPHICS: {
-            buffer_type_index = static_cast<size_t>(command_buffer_allocation_info->graphics_buffer_type);
-            buffer_types_count = static_cast<size_t>(CommandBuffers::Graphics::COUNT);
-        } break;
-        case QueueFamilies::Type::TRANSFER: {
-            buffer_type_index = static_cast<size_t>(command_buffer_allocation_info->transfer_buffer_type);
-            buffer_types_count = static_cast<size_t>(CommandBuffers::Transfer::COUNT);
-        } break;
+    if(queue->count == DeletionQueue::CAPACITY) {
+        deletion_queue_collect(renderer, false);
+        if(queue->count == DeletionQueue::CAPACITY) {
+            printf("Deletion queue full. [Waiting for the device]\n");
+            deletion_queue_collect(renderer, true);
+        }
+    }
+
+    queue->entries[queue->count++] = *entry;
+}
+
+void deletion_queue_destroy_entry(VulkanRenderer* renderer, DeletionQueue::Entry* entry) {
+    VkDevice device = renderer->devices.logical.device;
+
+    switch(entry->kind) {
+        case DeletionQueue::Kind::BUFFER: vkDestroyBuffer(device, entry->handle.buffer, nullptr); break;
+        case DeletionQueue::Kind::IMAGE: vkDestroyImage(device, entry->handle.image, nullptr); break;
+        case DeletionQueue::Kind::IMAGE_VIEW: vkDestroyImageView(device, entry->handle.image_view, nullptr); break;
+        case DeletionQueue::Kind::FRAMEBUFFER: vkDestroyFramebuffer(device, entry->handle.framebuffer, nullptr); break;
+        case DeletionQueue::Kind::SAMPLER: vkDestroySampler(device, entry->handle.sampler, nullptr); break;
+        case DeletionQueue::Kind::SHADER_MODULE: vkDestroyShaderModule(device, entry->handle.shader_module, nullptr); break;
+        case DeletionQueue::Kind::PIPELINE: vkDestroyPipeline(device, entry->handle.pipeline, nullptr); break;
+        case DeletionQueue::Kind::PIPELINE_LAYOUT: vkDestroyPipelineLayout(device, entry->handle.pipeline_layout, nullptr); break;
+        case DeletionQueue::Kind::DESCRIPTOR_SET_LAYOUT: vkDestroyDescriptorSetLayout(device, entry->handle.descriptor_set_layout, nullptr); break;
+        case DeletionQueue::Kind::DESCRIPTOR_POOL: vkDestroyDescriptorPool(device, entry->handle.descriptor_pool, nullptr); break;
+        case DeletionQueue::Kind::RENDER_PASS: vkDestroyRenderPass(device, entry->handle.render_pass, nullptr); break;
+        case DeletionQueue::Kind::SWAPCHAIN: vkDestroySwapchainKHR(device, entry->handle.swapchain, nullptr); break;
         default:
             break;
     }
 
-    //size_t buffer_type_index = static_cast<size_t>(command_buffer_allocation_info->buffer_type);
-
-    if(!renderer->command_pools[command_pool_index].buffers) {
-        renderer->command_pools[command_pool_index].buffers = (CommandBuffers*)memory_arena_allocate(renderer->heap_data, sizeof(CommandBuffers) * buffer_types_count);
+    if(entry->allocation.memory != VK_NULL_HANDLE) {
+        gpu_free(renderer->gpu_allocator, &entry->allocation);
     }
+}
 
-    result = vkAllocateCommandBuffers(renderer->devices.logical.device, &command_buffer_allocate_info, renderer->command_pools[command_pool_index].buffers[buffer_type_index].buffer);
-    if(result == VK_SUCCESS) {
-        if(command_buffer_allocation_info->semaphore_count > 0) {
-            VkSemaphoreCreateInfo semaphore_create_info = {
-                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-                .pNext = nullptr,
-                .flags = 0
-            };
+//Called once per frame after the frame wait. wait_all idles the device and empties the queue, for shutdown and overflow
+void deletion_queue_collect(VulkanRenderer* renderer, bool wait_all) {
+    DeletionQueue* queue = &renderer->deletion_queue;
+    if(queue->count == 0) {
+        return;
+    }
 
-            for(size_t command_buffer_index = 0; command_buffer_index < command_buffer_allocation_info->buffer_count; ++command_buffer_index) {
-                for(size_t semaphore_index = 0; semaphore_index < command_buffer_allocation_info->semaphore_count; ++semaphore_index) {
-                    result = vkCreateSemaphore(renderer->devices.logical.device, &semaphore_create_info, nullptr, &renderer->command_pools[command_pool_index].buffers[buffer_type_index].synchro[command_buffer_index].semaphores[semaphore_index]);
-                    if(result != VK_SUCCESS) {
-                        printf("vkCreateSemaphore() failed. [Semaphore Index: %zd]\n", semaphore_index);
-                        return result;
-                    }
-                }
-            }
+    if(wait_all) {
+        VkResult result = vkDeviceWaitIdle(renderer->devices.logical.device);
+        if(result != VK_SUCCESS) {
+            printf("vkDeviceWaitIdle() failed. [%s]\n", string_VkResult(result));
         }
+    }
 
-        if(command_buffer_allocation_info->semaphore_count > 0) {
-            VkFenceCreateInfo fence_create_info = {
-                .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-                .pNext = nullptr,
-                .flags = VK_FENCE_CREATE_SIGNALED_BIT //Lets us bypass fence waiting on first frame
-            };
+    //One query per timeline rather than per entry
+    u64 graphics_completed = timeline_completed_value(renderer, &renderer->graphics_timeline);
+    u64 transfer_completed = timeline_completed_value(renderer, &renderer->transfer_timeline);
 
-            for(size_t command_buffer_index = 0; command_buffer_index < command_buffer_allocation_info->buffer_count; ++command_buffer_index) {
-                for(size_t fence_index = 0; fence_index < command_buffer_allocation_info->semaphore_count; ++fence_index) {
-                    result = vkCreateFence(renderer->devices.logical.device, &fence_create_info, nullptr, &renderer->command_pools[command_pool_index].buffers[buffer_type_index].synchro[command_buffer_index].fences[fence_index]);
-                    if(result != VK_SUCCESS) {
-                        printf("vkCreateFence() failed. [Fence Index: %zd]\n", fence_index);
-                        return result;
-                    }
-                }
-            }
+    size_t kept = 0;
+    for(size_t entry_index = 0; entry_index < queue->count; ++entry_index) {
+        DeletionQueue::Entry* entry = &queue->entries[entry_index];
+
+        u64 completed = 0;
+        if(entry->timeline == &renderer->graphics_timeline) {
+            completed = graphics_completed;
+        } else if(entry->timeline == &renderer->transfer_timeline) {
+            completed = transfer_completed;
+        } else {
+            completed = timeline_completed_value(renderer, entry->timeline);
+        }
+
+        if(wait_all || entry->timeline_value <= completed) {
+            deletion_queue_destroy_entry(renderer, entry);
+        } else {
+            queue->entries[kept++] = *entry;
         }
-    } else {
-        printf("vkAllocateCommandBuffers failed. Command Pool[%zd] Buffer Count[%zd]\n", command_pool_index, command_buffer_allocation_info->buffer_count);
-        return result;
     }
+    queue->count = kept;
+}
 
-    return result;
+void defer_destroy_buffer(VulkanRenderer* renderer, Buffer* buffer) {
+    DeletionQueue::Entry entry = {
+        .kind = DeletionQueue::Kind::BUFFER,
+        .handle = { .buffer = buffer->buffer },
+        .allocation = buffer->allocation
+    };
+    deletion_queue_push(renderer, &entry);
+    *buffer = {};
 }
 
-VkResult record_command_buffer(VulkanRenderer* renderer, VkCommandBuffer command_buffer, size_t image_index) {
+//The pixels were copied into staging when the upload was queued, only the GPU copies have to wait
+void defer_destroy_texture(VulkanRenderer* renderer, Texture* texture) {
+    DeletionQueue::Entry entries[] = {
+        { .kind = DeletionQueue::Kind::IMAGE_VIEW, .handle = { .image_view = texture->image_view } },
+        { .kind = DeletionQueue::Kind::IMAGE, .handle = { .image = texture->image }, .allocation = texture->allocation }
+    };
+    for(DeletionQueue::Entry& entry : entries) {
+        deletion_queue_push(renderer, &entry);
+    }
+
+    image_free(&texture->image_data);
+    *texture = {};
+}
+
+u32 get_queue_family_index(VulkanRenderer* renderer, QueueFamilies::Type type) {
+    size_t index = static_cast<size_t>(type);
+    return static_cast<u32>(renderer->queue_families.families[index].index);
+}
+
+bool has_dedicated_transfer_family(VulkanRenderer* renderer) {
+    return get_queue_family_index(renderer, QueueFamilies::Type::GRAPHICS) != get_queue_family_index(renderer, QueueFamilies::Type::TRANSFER);
+}
+
+VkResult create_vertex_buffer(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
 
-    VkCommandBufferBeginInfo command_buffer_begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = nullptr,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-        .pInheritanceInfo = nullptr
+    VkDeviceSize buffer_size = sizeof(quad_vertices);
+
+    BufferAllocationInfo vertex_buffer_info = {
+        .buffer = &renderer->graphics_pipeline.vertex_buffer,
+        .usage_flags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .size = buffer_size,
+        .sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
+        .map_memory = false
     };
 
-    result = vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
+    result = create_buffer(renderer, &vertex_buffer_info);
     if(result != VK_SUCCESS) {
-        printf("vkBeginCommandBuffer() failed.\n");
+        printf("create_buffer() failed. [Vertex Buffer]\n");
         return result;
     }
 
-    VkRenderPassBeginInfo render_pass_begin_info = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .pNext = nullptr,
-        .renderPass = renderer->graphics_pipeline.render_pass,
-        .framebuffer = renderer->swapchain.images.frame_buffers[image_index],
-        .renderArea = {
-            .offset = { 0, 0 },
-            .extent = renderer->swapchain.extent },
-        .clearValueCount = 1,
-        .pClearValues = &renderer->graphics_pipeline.clear_color
-    };
+    result = upload_buffer(renderer, &renderer->graphics_pipeline.vertex_buffer, quad_vertices, buffer_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, nullptr);
+    if(result != VK_SUCCESS) {
+        printf("upload_buffer() failed. [Vertex Buffer]\n");
+        return result;
+    }
 
-    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->graphics_pipeline.pipeline);
+    return result;
+}
 
-    //Pipeline Dynamic State stuff VVV
-    VkViewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = static_cast<float>(renderer->swapchain.extent.width),
-        .height = static_cast<float>(renderer->swapchain.extent.height),
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f
-    };
-    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+VkResult create_index_buffer(VulkanRenderer* renderer) {
+    VkResult result = VK_ERROR_UNKNOWN;
 
-    VkRect2D scissor = {
-        .offset = { 0, 0 },
-        .extent = renderer->swapchain.extent
-    };
-    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-    //End Pipeline Dynamic State stuff
+    VkDeviceSize buffer_size = sizeof(quad_indices);
 
-    VkBuffer vertex_buffers[] = { renderer->graphics_pipeline.vertex_buffer.buffer };
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
-    vkCmdBindIndexBuffer(command_buffer, renderer->graphics_pipeline.index_buffer.buffer, 0, VkIndexType::VK_INDEX_TYPE_UINT16);
-    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->graphics_pipeline.layout, 0, 1, &renderer->graphics_pipeline.descriptor_sets[renderer->swapchain.current_frame_index], 0, nullptr);
-    vkCmdDrawIndexed(command_buffer, 6, 1, 0, 0, 0);
-    //vkCmdDraw(command_buffer, 9, 1, 0, 0);\
+    BufferAllocationInfo index_buffer_info = {
+        .buffer = &renderer->graphics_pipeline.index_buffer,
+        .usage_flags = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .size = buffer_size,
+        .sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
+        .map_memory = false
+    };
 
-    vkCmdEndRenderPass(command_buffer);
+    result = create_buffer(renderer, &index_buffer_info);
+    if(result != VK_SUCCESS) {
+        printf("create_buffer() failed. [Index Buffer]\n");
+        return result;
+    }
 
-    result = vkEndCommandBuffer(command_buffer);
+    result = upload_buffer(renderer, &renderer->graphics_pipeline.index_buffer, quad_indices, buffer_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, nullptr);
     if(result != VK_SUCCESS) {
-        printf("vkEndCommandBuffer() failed.\n");
+        printf("upload_buffer() failed. [Index Buffer]\n");
         return result;
     }
 
     return result;
 }
 
-VkResult draw_frame(VulkanRenderer* renderer, Time::Duration delta_time) {
+VkResult create_upload_manager(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_upload_manager");
 
-    size_t frame_index = renderer->swapchain.current_frame_index;
-    size_t command_pool_index = static_cast<size_t>(QueueFamilies::Type::GRAPHICS);
-    CommandPool* command_pool = &renderer->command_pools[command_pool_index];
+    UploadManager* manager = &renderer->upload_manager;
 
-    size_t buffer_type_index = static_cast<size_t>(CommandBuffers::Graphics::DRAW_FRAME);
-    CommandBuffers* command_buffers = &command_pool->buffers[buffer_type_index];
+    //Every batch's partition has to start on an offset that is valid for image copies
+    VkDeviceSize copy_alignment = renderer->devices.physical.properties.limits.optimalBufferCopyOffsetAlignment;
+    manager->copy_alignment = copy_alignment > 16 ? copy_alignment : 16;
+    manager->batch_size = (MB(UploadManager::STAGING_SIZE_MB) / UploadManager::MAX_BATCHES) & ~(manager->copy_alignment - 1);
+
+    BufferAllocationInfo staging_allocation_info = {
+        .buffer = &manager->staging,
+        .usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        .size = manager->batch_size * UploadManager::MAX_BATCHES,
+        .sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
+        .map_memory = true
+    };
 
-    VkFence frame_in_flight_fence = command_buffers->synchro[frame_index].fences[0];
-    result = vkWaitForFences(renderer->devices.logical.device, 1, &frame_in_flight_fence, VK_TRUE, UINT64_MAX);
+    result = create_buffer(renderer, &staging_allocation_info);
     if(result != VK_SUCCESS) {
-        printf("vkWaitForFences() failed.\n");
+        printf("create_buffer() failed. [Upload Staging]\n");
         return result;
     }
 
-    VkSemaphore image_available_semaphore = command_buffers->synchro[frame_index].semaphores[0];
-    size_t image_index = 0;
-    result = vkAcquireNextImageKHR(renderer->devices.logical.device, renderer->swapchain.swapchain, UINT64_MAX, image_available_semaphore, VK_NULL_HANDLE, reinterpret_cast<u32*>(&image_index));
-    if(result == VK_ERROR_OUT_OF_DATE_KHR) {
-        VkResult resize_result = resize(renderer);
-        if(resize_result != VK_SUCCESS) {
-            printf("resize() failed. [%s]\n", string_VkResult(resize_result));
-        }
-        return result;
-    } else if(result != VK_SUCCESS) {
-        printf("vkAcquireNextImageKHR() failed.\n");
+    //Batches synchronize through the transfer and graphics timelines, no per-batch semaphores or fences
+    CommandBufferAllocationInfo upload_command_buffer_allocation_info = {
+        .pool_type = QueueFamilies::Type::TRANSFER,
+        .transfer_buffer_type = CommandBuffers::Transfer::UPLOAD,
+        .buffer_count = UploadManager::MAX_BATCHES,
+        .semaphore_count = 0
+    };
+
+    result = allocate_command_buffers(renderer, &upload_command_buffer_allocation_info);
+    if(result != VK_SUCCESS) {
+        printf("allocate_command_buffers() [CommandBuffers::Transfer::UPLOAD] failed.\n");
         return result;
     }
 
-    update_uniform_buffer(renderer, frame_index, delta_time);
+    CommandBufferAllocationInfo acquire_command_buffer_allocation_info = {
+        .pool_type = QueueFamilies::Type::GRAPHICS,
+        .graphics_buffer_type = CommandBuffers::Graphics::UPLOAD_ACQUIRE,
+        .buffer_count = UploadManager::MAX_BATCHES,
+        .semaphore_count = 0
+    };
 
-    result = vkResetFences(renderer->devices.logical.device, 1, &frame_in_flight_fence);
+    result = allocate_command_buffers(renderer, &acquire_command_buffer_allocation_info);
     if(result != VK_SUCCESS) {
-        printf("vkResetFences() failed.\n");
+        printf("allocate_command_buffers() [CommandBuffers::Graphics::UPLOAD_ACQUIRE] failed.\n");
         return result;
     }
 
-    VkCommandBuffer command_buffer = command_buffers->buffer[frame_index];
-    result = vkResetCommandBuffer(command_buffer, 0);
-    if(result != VK_SUCCESS) {
-        printf("vkResetCommandBuffer() failed.\n");
-        return result;
+    CommandBuffers* upload_buffers = &renderer->command_pools[static_cast<size_t>(QueueFamilies::Type::TRANSFER)].buffers[static_cast<size_t>(CommandBuffers::Transfer::UPLOAD)];
+    CommandBuffers* acquire_buffers = &renderer->command_pools[static_cast<size_t>(QueueFamilies::Type::GRAPHICS)].buffers[static_cast<size_t>(CommandBuffers::Graphics::UPLOAD_ACQUIRE)];
+    for(size_t batch_index = 0; batch_index < UploadManager::MAX_BATCHES; ++batch_index) {
+        UploadManager::Batch* batch = &manager->batches[batch_index];
+        batch->transfer_commands = upload_buffers->buffer[batch_index];
+        batch->acquire_commands = acquire_buffers->buffer[batch_index];
+        batch->staging_offset = manager->batch_size * batch_index;
     }
 
-    result = record_command_buffer(renderer, command_buffer, image_index);
-    if(result != VK_SUCCESS) {
-        printf("record_command_buffer() failed.\n");
+    return result;
+}
+
+//Opens the current batch for recording, waiting on it first only if its previous submission is still in flight
+VkResult upload_manager_begin_batch(VulkanRenderer* renderer) {
+    VkResult result = VK_SUCCESS;
+
+    UploadManager* manager = &renderer->upload_manager;
+    UploadManager::Batch* batch = &manager->batches[manager->current_batch];
+    if(batch->recording) {
         return result;
     }
 
-    VkPipelineStageFlags wait_stages[] = {
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-    };
+    if(batch->pending) {
+        result = timeline_wait(renderer, batch->timeline, batch->timeline_value);
+        if(result != VK_SUCCESS) {
+            printf("timeline_wait() failed. [Upload Batch]\n");
+            return result;
+        }
+        upload_manager_collect(renderer);
+    }
 
-    VkSemaphore render_finished_semaphore = command_buffers->synchro[frame_index].semaphores[1];
-    VkSubmitInfo submit_info = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &image_available_semaphore,
-        .pWaitDstStageMask = wait_stages,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &command_buffer,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &render_finished_semaphore
+    VkCommandBufferBeginInfo command_buffer_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr
     };
 
-    //Another spot that we can make use of the get_queue_family_index(QueueFamilies::Type type) function
-    VkQueue queue = renderer->queue_families.families[0].queues[0];
-    result = vkQueueSubmit(queue, 1, &submit_info, frame_in_flight_fence);
+    result = vkBeginCommandBuffer(batch->transfer_commands, &command_buffer_begin_info);
     if(result != VK_SUCCESS) {
-        printf("vkQueueSubmit() failed.\n");
+        printf("vkBeginCommandBuffer() failed. [Upload Transfer]\n");
         return result;
     }
 
-    VkPresentInfoKHR present_info = {
-        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &render_finished_semaphore,
-        .swapchainCount = 1,
-        .pSwapchains = &renderer->swapchain.swapchain,
-        .pImageIndices = reinterpret_cast<const u32*>(&image_index),
-        .pResults = nullptr
-    };
-
-    result = vkQueuePresentKHR(queue, &present_info);
-    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-        VkResult resize_result = resize(renderer);
-        if(resize_result != VK_SUCCESS) {
-            printf("resize() failed. [%s]\n", string_VkResult(resize_result));
+    if(has_dedicated_transfer_family(renderer)) {
+        result = vkBeginCommandBuffer(batch->acquire_commands, &command_buffer_begin_info);
+        if(result != VK_SUCCESS) {
+            printf("vkBeginCommandBuffer() failed. [Upload Acquire]\n");
+            return result;
         }
-        return result;
-    } else if(result != VK_SUCCESS) {
-        printf("vkAcquireNextImageKHR() failed.\n");
-        return result;
     }
 
-    renderer->swapchain.current_frame_index = (renderer->swapchain.current_frame_index + 1) % renderer->swapchain.MAX_FRAMES_IN_FLIGHT;
+    batch->head = 0;
+    batch->copy_count = 0;
+    batch->serial = manager->next_serial++;
+    batch->recording = true;
 
     return result;
 }
 
-VkResult resize(VulkanRenderer* renderer) {
+//Reserves size bytes of staging space in the current batch, flushing it and moving on to the next one when it is full
+VkResult upload_manager_reserve(VulkanRenderer* renderer, VkDeviceSize size, VkDeviceSize* staging_offset) {
     VkResult result = VK_ERROR_UNKNOWN;
 
-    vkDeviceWaitIdle(renderer->devices.logical.device);
-
-    result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(renderer->devices.physical.device, renderer->surface, &renderer->swapchain.support_info.capabilities);
-    if(result != VK_SUCCESS) {
-        printf("vkGetPhysicalDeviceSurfaceCapabilitiesKHR() failed.\n");
+    UploadManager* manager = &renderer->upload_manager;
+    if(size > manager->batch_size) {
+        result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        printf("upload_manager_reserve() failed. [%llu bytes requested, batches hold %llu]\n", (unsigned long long)size, (unsigned long long)manager->batch_size);
         return result;
     }
 
-    result = create_swapchain(renderer);
-    if(result != VK_SUCCESS) {
-        printf("create_swapchain() failed.\n");
-        return result;
+    UploadManager::Batch* batch = &manager->batches[manager->current_batch];
+    VkDeviceSize offset = (batch->head + manager->copy_alignment - 1) & ~(manager->copy_alignment - 1);
+    if(batch->recording && offset + size > manager->batch_size) {
+        result = upload_manager_flush(renderer);
+        if(result != VK_SUCCESS) {
+            printf("upload_manager_flush() failed.\n");
+            return result;
+        }
     }
 
-    result = create_frame_buffers(renderer);
+    result = upload_manager_begin_batch(renderer);
     if(result != VK_SUCCESS) {
-        printf("create_frame_buffers() failed.\n");
+        printf("upload_manager_begin_batch() failed.\n");
         return result;
     }
 
+    batch = &manager->batches[manager->current_batch];
+    offset = (batch->head + manager->copy_alignment - 1) & ~(manager->copy_alignment - 1);
+    batch->head = offset + size;
+    batch->copy_count++;
+    *staging_offset = batch->staging_offset + offset;
+
     return result;
 }
 
-VkResult create_point_pipeline(VulkanRenderer* renderer) {
+//Queues a copy into a device-local buffer. destination_stage and destination_access describe the first use on the
+//graphics queue. The copy is submitted by the next upload_manager_flush(), ticket (optional) tracks its completion
+VkResult upload_buffer(VulkanRenderer* renderer, Buffer* destination, const void* data, VkDeviceSize size, VkPipelineStageFlags destination_stage, VkAccessFlags destination_access, u64* ticket) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("upload_buffer");
 
-    size_t shader_count = 0;
-    result = load_shader_data(renderer, &shader_count, nullptr);
-    if(result != VK_SUCCESS || shader_count == 0) {
-        printf("load_shader_data failed. [Shader Count: %zd]\n", shader_count);
-        return result;
-    }
-
-    renderer->point_pipeline.shader_data.modules = (VkShaderModule*)malloc(sizeof(VkShaderModule) * shader_count);
-    result = load_shader_data(renderer, &shader_count, &renderer->point_pipeline.shader_data);
-    if(result != VK_SUCCESS || shader_count == 0) {
-        printf("load_shader_data failed. [Shader Count: %zd]\n", shader_count);
+    VkDeviceSize staging_offset = 0;
+    result = upload_manager_reserve(renderer, size, &staging_offset);
+    if(result != VK_SUCCESS) {
+        printf("upload_manager_reserve() failed. [Buffer]\n");
         return result;
     }
 
-    VkPipelineShaderStageCreateInfo* shader_stage_create_infos = (VkPipelineShaderStageCreateInfo*)memory_arena_allocate(temporary_memory, sizeof(VkPipelineShaderStageCreateInfo) * shader_count);
-    for(size_t shader_index = 0; shader_index < shader_count; ++shader_index) {
-        shader_stage_create_infos[shader_index] = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .stage = renderer->point_pipeline.shader_data.shaders[shader_index].type,
-            .module = renderer->point_pipeline.shader_data.modules[shader_index],
-            .pName = "main",
-            .pSpecializationInfo = VK_NULL_HANDLE
-        };
-    }
+    UploadManager* manager = &renderer->upload_manager;
+    UploadManager::Batch* batch = &manager->batches[manager->current_batch];
+    memcpy_s((u8*)manager->staging.data + staging_offset, size, data, size);
 
-    VkVertexInputBindingDescription vertex_input_binding_description = {
-        .binding = 0,
-        .stride = sizeof(Vec3),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+    VkBufferCopy buffer_region = {
+        .srcOffset = staging_offset,
+        .dstOffset = 0,
+        .size = size
     };
 
-    VkPipelineVertexInputStateCreateInfo vertex_input_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &vertex_input_binding_description,
-        .vertexAttributeDescriptionCount = 0,
-        .pVertexAttributeDescriptions = nullptr
-    };
+    vkCmdCopyBuffer(batch->transfer_commands, manager->staging.buffer, destination->buffer, 1, &buffer_region);
 
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+    VkBufferMemoryBarrier buffer_memory_barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
         .pNext = nullptr,
-        .flags = 0,
-        .topology = VkPrimitiveTopology::VK_PRIMITIVE_TOPOLOGY_POINT_LIST,
-        .primitiveRestartEnable = VK_FALSE
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = destination_access,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = destination->buffer,
+        .offset = 0,
+        .size = size
     };
 
-    //We left off here
-
-    VkPipelineViewportStateCreateInfo viewport_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        //.viewportCount
-    };
+    if(has_dedicated_transfer_family(renderer)) {
+        //Release on the transfer queue, the matching acquire on the graphics queue makes the write visible there
+        buffer_memory_barrier.srcQueueFamilyIndex = get_queue_family_index(renderer, QueueFamilies::Type::TRANSFER);
+        buffer_memory_barrier.dstQueueFamilyIndex = get_queue_family_index(renderer, QueueFamilies::Type::GRAPHICS);
 
-    VkGraphicsPipelineCreateInfo pipeline_create_info = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .stageCount = static_cast<u32>(shader_count),
-        .pStages = shader_stage_create_infos,
-        .pVertexInputState = &vertex_input_state,
-        .pInputAssemblyState = &input_assembly_state,
-        .pTessellationState = nullptr,
-        .pViewportState = &viewport_state
+        VkBufferMemoryBarrier release_barrier = buffer_memory_barrier;
+        release_barrier.dstAccessMask = VK_ACCESS_NONE;
+        vkCmdPipelineBarrier(batch->transfer_commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &release_barrier, 0, nullptr);
 
-    };
+        buffer_memory_barrier.srcAccessMask = VK_ACCESS_NONE;
+        vkCmdPipelineBarrier(batch->acquire_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, destination_stage, 0, 0, nullptr, 1, &buffer_memory_barrier, 0, nullptr);
+    } else {
+        vkCmdPipelineBarrier(batch->transfer_commands, VK_PIPELINE_STAGE_TRANSFER_BIT, destination_stage, 0, 0, nullptr, 1, &buffer_memory_barrier, 0, nullptr);
+    }
 
-    result = vkCreateGraphicsPipelines(renderer->devices.logical.device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &renderer->point_pipeline.pipeline);
-    if(result != VK_SUCCESS) {
-        printf("vkCreate");
+    if(ticket) {
+        *ticket = batch->serial;
     }
 
     return result;
 }
 
-VkResult create_buffer(VulkanRenderer* renderer, BufferAllocationInfo* buffer_allocation_info) {
-    VkResult result;
+//Queues a copy of a whole RGBA8 texture, leaving it in SHADER_READ_ONLY_OPTIMAL for fragment shaders once the batch completes
+VkResult upload_texture(VulkanRenderer* renderer, Texture* texture, const void* pixels, VkDeviceSize size, u64* ticket) {
+    VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("upload_texture");
 
-    VkBufferCreateInfo buffer_create_info = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .size = buffer_allocation_info->size,
-        .usage = buffer_allocation_info->usage_flags,
-        .sharingMode = buffer_allocation_info->sharing_mode,
-        .queueFamilyIndexCount = buffer_allocation_info->queue_families_indices_count,
-        .pQueueFamilyIndices = buffer_allocation_info->queue_family_indices
-    };
+    VkDeviceSize staging_offset = 0;
+    result = upload_manager_reserve(renderer, size, &staging_offset);
+    if(result != VK_SUCCESS) {
+        printf("upload_manager_reserve() failed. [Texture]\n");
+        return result;
+    }
 
-    result = vkCreateBuffer(renderer->devices.logical.device, &buffer_create_info, nullptr, &buffer_allocation_info->buffer->buffer);
+    UploadManager* manager = &renderer->upload_manager;
+    memcpy_s((u8*)manager->staging.data + staging_offset, size, pixels, size);
+
+    result = upload_texture_from_staging(renderer, texture, staging_offset, ticket);
     if(result != VK_SUCCESS) {
-        printf("vkCreateBuffer() failed.\n");
+        printf("upload_texture_from_staging() failed.\n");
         return result;
     }
 
-    VkMemoryRequirements buffer_memory_requirements;
-    vkGetBufferMemoryRequirements(renderer->devices.logical.device, buffer_allocation_info->buffer->buffer, &buffer_memory_requirements);
+    return result;
+}
 
-    size_t memory_type_index = find_memory_type_index(renderer, buffer_memory_requirements.memoryTypeBits, buffer_allocation_info->memory_properties);
+//For callers that fill the pixels straight into a range from upload_manager_reserve(), which saves a copy when the
+//image is assembled on the CPU anyway. Must be called before anything else reserves staging
+VkResult upload_texture_from_staging(VulkanRenderer* renderer, Texture* texture, VkDeviceSize staging_offset, u64* ticket) {
+    VkResult result = VK_SUCCESS;
 
-    VkMemoryAllocateInfo allocate_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+    UploadManager* manager = &renderer->upload_manager;
+    UploadManager::Batch* batch = &manager->batches[manager->current_batch];
+
+    VkImageMemoryBarrier image_memory_barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .pNext = nullptr,
-        .allocationSize = buffer_memory_requirements.size,
-        .memoryTypeIndex = (u32)memory_type_index
+        .srcAccessMask = VK_ACCESS_NONE,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture->image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = texture->mip_levels,
+            .baseArrayLayer = 0,
+            .layerCount = 1 }
     };
 
-    result = vkAllocateMemory(renderer->devices.logical.device, &allocate_info, nullptr, &buffer_allocation_info->buffer->device_memory);
-    if(result != VK_SUCCESS) {
-        printf("vkAllocateMemory() failed.\n");
-        return result;
+    //Contents are undefined before the first copy, so the transfer queue can take the image without an acquire
+    vkCmdPipelineBarrier(batch->transfer_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+
+    //One copy per level present in staging
+    VkBufferImageCopy image_regions[ImageData::MAX_LEVELS];
+    for(u32 level = 0; level < texture->image_data.level_count; ++level) {
+        image_regions[level] = {
+            .bufferOffset = staging_offset + texture->image_data.level_offsets[level],
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = 1 },
+            .imageOffset = { 0, 0, 0 },
+            .imageExtent = {
+                .width = std::max(texture->image_data.width >> level, 1u),
+                .height = std::max(texture->image_data.height >> level, 1u),
+                .depth = 1 }
+        };
     }
 
-    vkBindBufferMemory(renderer->devices.logical.device, buffer_allocation_info->buffer->buffer, buffer_allocation_info->buffer->device_memory, 0);
+    vkCmdCopyBufferToImage(batch->transfer_commands, manager->staging.buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->image_data.level_count, image_regions);
+
+    //Missing levels are blitted from the last uploaded one, and only graphics queues can blit. Without a dedicated
+    //transfer family the transfer commands already run on one
+    bool generate_mips = texture->mip_levels > texture->image_data.level_count;
+    VkPipelineStageFlags destination_stage = generate_mips ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    VkCommandBuffer graphics_commands = batch->transfer_commands;
+
+    image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_memory_barrier.dstAccessMask = generate_mips ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+    image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_memory_barrier.newLayout = generate_mips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    if(has_dedicated_transfer_family(renderer)) {
+        //The layout transition is part of the ownership transfer, both halves have to name the same layouts
+        image_memory_barrier.srcQueueFamilyIndex = get_queue_family_index(renderer, QueueFamilies::Type::TRANSFER);
+        image_memory_barrier.dstQueueFamilyIndex = get_queue_family_index(renderer, QueueFamilies::Type::GRAPHICS);
+
+        VkImageMemoryBarrier release_barrier = image_memory_barrier;
+        release_barrier.dstAccessMask = VK_ACCESS_NONE;
+        vkCmdPipelineBarrier(batch->transfer_commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release_barrier);
+
+        image_memory_barrier.srcAccessMask = VK_ACCESS_NONE;
+        vkCmdPipelineBarrier(batch->acquire_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+        graphics_commands = batch->acquire_commands;
+    } else if(!generate_mips) {
+        vkCmdPipelineBarrier(batch->transfer_commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+    }
 
-    if(buffer_allocation_info->map_memory) {
-        vkMapMemory(renderer->devices.logical.device, buffer_allocation_info->buffer->device_memory, 0, buffer_allocation_info->size, 0, &buffer_allocation_info->buffer->data);
+    if(generate_mips) {
+        record_mipmap_generation(graphics_commands, texture, texture->image_data.level_count);
+    }
+
+    if(ticket) {
+        *ticket = batch->serial;
     }
 
     return result;
 }
 
-VkResult record_staging_command_buffer(VulkanRenderer* renderer, Buffer* staging_buffer, Buffer* destination_buffer, VkDeviceSize size) {
-    VkResult result = VK_ERROR_UNKNOWN;
-
-    size_t command_pool_index = static_cast<size_t>(QueueFamilies::Type::TRANSFER);
-    size_t command_buffer_type = static_cast<size_t>(CommandBuffers::Transfer::BUFFER_TO_BUFFER);
-    VkCommandBuffer command_buffer = renderer->command_pools[command_pool_index].buffers[command_buffer_type].buffer[0];
-
-    VkCommandBufferBeginInfo command_buffer_begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+//Each level from first_level on is a linear downsample of the one above it. Expects every level in
+//TRANSFER_DST_OPTIMAL with the levels before first_level written, leaves the whole chain in SHADER_READ_ONLY_OPTIMAL
+//for fragment shaders
+void record_mipmap_generation(VkCommandBuffer command_buffer, Texture* texture, u32 first_level) {
+    VkImageMemoryBarrier image_memory_barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .pNext = nullptr,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-        .pInheritanceInfo = nullptr
+        .srcAccessMask = VK_ACCESS_NONE,
+        .dstAccessMask = VK_ACCESS_NONE,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture->image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1 }
     };
 
-    vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
+    //Uploaded levels that aren't blitted from go straight to being sampled
+    if(first_level > 1) {
+        image_memory_barrier.subresourceRange.levelCount = first_level - 1;
+        image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+        image_memory_barrier.subresourceRange.levelCount = 1;
+    }
 
-    VkBufferCopy buffer_region = {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = size
-    };
+    i32 width = std::max(static_cast<i32>(texture->image_data.width >> (first_level - 1)), 1);
+    i32 height = std::max(static_cast<i32>(texture->image_data.height >> (first_level - 1)), 1);
+    for(u32 level = first_level; level < texture->mip_levels; ++level) {
+        image_memory_barrier.subresourceRange.baseMipLevel = level - 1;
+        image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+
+        i32 level_width = width > 1 ? width / 2 : 1;
+        i32 level_height = height > 1 ? height / 2 : 1;
+
+        VkImageBlit image_blit = {
+            .srcSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level - 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1 },
+            .srcOffsets = { { 0, 0, 0 }, { width, height, 1 } },
+            .dstSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = 1 },
+            .dstOffsets = { { 0, 0, 0 }, { level_width, level_height, 1 } }
+        };
 
-    vkCmdCopyBuffer(command_buffer, staging_buffer->buffer, destination_buffer->buffer, 1, &buffer_region);
+        vkCmdBlitImage(command_buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
 
-    vkEndCommandBuffer(command_buffer);
+        image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
 
-    return result;
-}
+        width = level_width;
+        height = level_height;
+    }
 
-u32 get_queue_family_index(VulkanRenderer* renderer, QueueFamilies::Type type) {
-    size_t index = static_cast<size_t>(type);
-    return static_cast<u32>(renderer->queue_families.families[index].index);
+    image_memory_barrier.subresourceRange.baseMipLevel = texture->mip_levels - 1;
+    image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
 }
 
-VkResult create_vertex_buffer(VulkanRenderer* renderer) {
-    VkResult result = VK_ERROR_UNKNOWN;
+//Submits everything recorded into the current batch as one transfer submit (plus one acquire submit on the graphics
+//queue when the families differ) and moves on to the next batch. Does nothing when no copies were queued
+VkResult upload_manager_flush(VulkanRenderer* renderer) {
+    VkResult result = VK_SUCCESS;
+    TraceScope trace_scope("upload_manager_flush");
 
-    Buffer staging_buffer;
-    VkDeviceSize buffer_sizes = sizeof(Vertex) * 4;
-    u32 shared_buffer_queue_family_indices[] = {
-        get_queue_family_index(renderer, QueueFamilies::Type::GRAPHICS),
-        get_queue_family_index(renderer, QueueFamilies::Type::TRANSFER)
-    };
-
-    //Vertex Staging Buffer
-    {
-        BufferAllocationInfo staging_buffer_info = {
-            .buffer = &staging_buffer,
-            .usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            .memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            .size = buffer_sizes,
-            .sharing_mode = VK_SHARING_MODE_CONCURRENT,
-            .queue_families_indices_count = 2,
-            .queue_family_indices = shared_buffer_queue_family_indices,
-            .map_memory = true
-        };
+    UploadManager* manager = &renderer->upload_manager;
+    UploadManager::Batch* batch = &manager->batches[manager->current_batch];
+    if(!batch->recording) {
+        return result;
+    }
 
-        result = create_buffer(renderer, &staging_buffer_info);
-        if(result != VK_SUCCESS) {
-            printf("create_buffer() failed. [Staging Buffer]\n");
-            return result;
-        } else {
-            memcpy_s(staging_buffer.data, buffer_sizes, quad_vertices, buffer_sizes);
-            vkUnmapMemory(renderer->devices.logical.device, staging_buffer.device_memory);
-        }
-    }
-
-    //Vertex Buffer
-    {
-        BufferAllocationInfo vertex_buffer_info = {
-            .buffer = &renderer->graphics_pipeline.vertex_buffer,
-            .usage_flags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            .memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            .size = buffer_sizes,
-            .sharing_mode = VK_SHARING_MODE_CONCURRENT,
-            .queue_families_indices_count = 2,
-            .queue_family_indices = shared_buffer_queue_family_indices,
-            .map_memory = false
-        };
+    bool dedicated_transfer = has_dedicated_transfer_family(renderer);
+
+    result = vkEndCommandBuffer(batch->transfer_commands);
+    if(result != VK_SUCCESS) {
+        printf("vkEndCommandBuffer() failed. [Upload Transfer]\n");
+        return result;
+    }
 
-        result = create_buffer(renderer, &vertex_buffer_info);
+    if(dedicated_transfer) {
+        result = vkEndCommandBuffer(batch->acquire_commands);
         if(result != VK_SUCCESS) {
-            printf("create_buffer() failed. [Vertex Buffer]\n");
+            printf("vkEndCommandBuffer() failed. [Upload Acquire]\n");
             return result;
         }
     }
 
-    record_staging_command_buffer(renderer, &staging_buffer, &renderer->graphics_pipeline.vertex_buffer, buffer_sizes);
+    VkQueue transfer_queue = renderer->queue_families.families[static_cast<size_t>(QueueFamilies::Type::TRANSFER)].queues[0];
+    VkQueue graphics_queue = renderer->queue_families.families[static_cast<size_t>(QueueFamilies::Type::GRAPHICS)].queues[0];
 
-    size_t command_pool_index = static_cast<size_t>(QueueFamilies::Type::TRANSFER);
-    size_t command_buffer_type = static_cast<size_t>(CommandBuffers::Transfer::BUFFER_TO_BUFFER);
+    u64 transfer_value = renderer->transfer_timeline.value + 1;
+    VkTimelineSemaphoreSubmitInfo transfer_timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = 0,
+        .pWaitSemaphoreValues = nullptr,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &transfer_value
+    };
 
-    //Staging Queue Submit
-    {
-        VkSubmitInfo submit_info = {
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    VkSubmitInfo transfer_submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &transfer_timeline_info,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch->transfer_commands,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &renderer->transfer_timeline.semaphore
+    };
+
+    result = vkQueueSubmit(transfer_queue, 1, &transfer_submit_info, VK_NULL_HANDLE);
+    if(result != VK_SUCCESS) {
+        printf("vkQueueSubmit() failed. [Upload Transfer]\n");
+        return result;
+    }
+    renderer->transfer_timeline.value = transfer_value;
+    batch->timeline = &renderer->transfer_timeline;
+    batch->timeline_value = transfer_value;
+
+    if(dedicated_transfer) {
+        //The batch only lands once the graphics queue has acquired ownership, so that is the value to track
+        u64 acquire_value = renderer->graphics_timeline.value + 1;
+        VkTimelineSemaphoreSubmitInfo acquire_timeline_info = {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
             .pNext = nullptr,
-            .waitSemaphoreCount = 0,
-            .pWaitSemaphores = nullptr,
-            .pWaitDstStageMask = 0,
+            .waitSemaphoreValueCount = 1,
+            .pWaitSemaphoreValues = &transfer_value,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &acquire_value
+        };
+
+        VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo acquire_submit_info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &acquire_timeline_info,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &renderer->transfer_timeline.semaphore,
+            .pWaitDstStageMask = &wait_stage,
             .commandBufferCount = 1,
-            .pCommandBuffers = renderer->command_pools[command_pool_index].buffers[command_buffer_type].buffer,
-            .signalSemaphoreCount = 0,
-            .pSignalSemaphores = nullptr
+            .pCommandBuffers = &batch->acquire_commands,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &renderer->graphics_timeline.semaphore
         };
 
-        result = vkQueueSubmit(renderer->queue_families.families[1].queues[0], 1, &submit_info, VK_NULL_HANDLE);
+        result = vkQueueSubmit(graphics_queue, 1, &acquire_submit_info, VK_NULL_HANDLE);
         if(result != VK_SUCCESS) {
-            printf("VkQueueSubmit failed()\n");
+            printf("vkQueueSubmit() failed. [Upload Acquire]\n");
             return result;
         }
+        renderer->graphics_timeline.value = acquire_value;
+        batch->timeline = &renderer->graphics_timeline;
+        batch->timeline_value = acquire_value;
+    }
 
-        result = vkQueueWaitIdle(renderer->queue_families.families[1].queues[0]);
-        if(result != VK_SUCCESS) {
-            printf("vkQueueWaitIdle failed()\n");
-            return result;
+    batch->recording = false;
+    batch->pending = true;
+    manager->current_batch = (manager->current_batch + 1) % UploadManager::MAX_BATCHES;
+
+    return result;
+}
+
+//Non-blocking, retires submitted batches oldest first (starting at the batch about to be reused) so completed_serial
+//only ever moves forward
+void upload_manager_collect(VulkanRenderer* renderer) {
+    UploadManager* manager = &renderer->upload_manager;
+    for(size_t i = 0; i < UploadManager::MAX_BATCHES; ++i) {
+        UploadManager::Batch* batch = &manager->batches[(manager->current_batch + i) % UploadManager::MAX_BATCHES];
+        if(!batch->pending) {
+            continue;
+        }
+
+        if(timeline_completed_value(renderer, batch->timeline) < batch->timeline_value) {
+            break;
         }
+
+        batch->pending = false;
+        manager->completed_serial = batch->serial;
     }
+}
 
-    return result;
+bool upload_complete(VulkanRenderer* renderer, u64 ticket) {
+    return ticket <= renderer->upload_manager.completed_serial;
 }
 
-VkResult create_index_buffer(VulkanRenderer* renderer) {
+VkResult create_upload_ring(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
 
-    Buffer staging_buffer;
-    size_t buffer_sizes = sizeof(u16) * 6;
-
-    u32 shared_buffer_queue_family_indices[] = {
-        get_queue_family_index(renderer, QueueFamilies::Type::GRAPHICS),
-        get_queue_family_index(renderer, QueueFamilies::Type::TRANSFER)
-    };
-
-    //Index Staging Buffer
-    {
-        BufferAllocationInfo staging_buffer_info = {
-            .buffer = &staging_buffer,
-            .usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            .memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            .size = buffer_sizes,
-            .sharing_mode = VK_SHARING_MODE_CONCURRENT,
-            .queue_families_indices_count = 2,
-            .queue_family_indices = shared_buffer_queue_family_indices,
-            .map_memory = true
-        };
+    UploadRing* ring = &renderer->upload_ring;
+    ring->uniform_alignment = renderer->devices.physical.properties.limits.minUniformBufferOffsetAlignment;
+    ring->frame_size = MB(UploadRing::FRAME_SIZE_MB);
 
-        result = create_buffer(renderer, &staging_buffer_info);
-        if(result != VK_SUCCESS) {
-            printf("create_buffer() failed. [Staging Buffer]\n");
-            return result;
-        } else {
-            memcpy_s(staging_buffer.data, buffer_sizes, quad_indices, buffer_sizes);
-            vkUnmapMemory(renderer->devices.logical.device, staging_buffer.device_memory);
-        }
-    }
-
-    //Index Buffer
-    {
-        BufferAllocationInfo index_buffer_info = {
-            .buffer = &renderer->graphics_pipeline.index_buffer,
-            .usage_flags = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            .memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            .size = buffer_sizes,
-            .sharing_mode = VK_SHARING_MODE_CONCURRENT,
-            .queue_families_indices_count = 2,
-            .queue_family_indices = shared_buffer_queue_family_indices,
-            .map_memory = false
-        };
+    //Every partition has to start on an offset the uniform descriptor can be bound at
+    ring->frame_size = (ring->frame_size + ring->uniform_alignment - 1) & ~(ring->uniform_alignment - 1);
 
-        result = create_buffer(renderer, &index_buffer_info);
-        if(result != VK_SUCCESS) {
-            printf("create_buffer() failed. [Index Buffer]\n");
-            return result;
-        }
+    BufferAllocationInfo ring_allocation_info = {
+        .buffer = &ring->buffer,
+        .usage_flags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        .memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        .size = ring->frame_size * Swapchain::MAX_FRAMES_IN_FLIGHT,
+        .sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
+        .map_memory = true
+    };
+
+    result = create_buffer(renderer, &ring_allocation_info);
+    if(result != VK_SUCCESS) {
+        printf("create_buffer() failed. [Upload Ring]\n");
+        return result;
     }
 
-    record_staging_command_buffer(renderer, &staging_buffer, &renderer->graphics_pipeline.index_buffer, buffer_sizes);
+    upload_ring_begin_frame(ring, 0);
 
-    size_t command_pool_index = static_cast<size_t>(QueueFamilies::Type::TRANSFER);
-    size_t command_buffer_type = static_cast<size_t>(CommandBuffers::Transfer::BUFFER_TO_BUFFER);
+    return result;
+}
 
-    //Staging Queue Submit
-    {
-        VkSubmitInfo submit_info = {
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .pNext = nullptr,
-            .waitSemaphoreCount = 0,
-            .pWaitSemaphores = nullptr,
-            .pWaitDstStageMask = 0,
-            .commandBufferCount = 1,
-            .pCommandBuffers = renderer->command_pools[command_pool_index].buffers[command_buffer_type].buffer,
-            .signalSemaphoreCount = 0,
-            .pSignalSemaphores = nullptr
-        };
+void upload_ring_begin_frame(UploadRing* ring, size_t frame_index) {
+    ring->frame_index = frame_index;
+    ring->head = 0;
+}
 
-        result = vkQueueSubmit(renderer->queue_families.families[command_pool_index].queues[0], 1, &submit_info, VK_NULL_HANDLE);
-        if(result != VK_SUCCESS) {
-            printf("VkQueueSubmit failed()\n");
-            return result;
-        }
+//Alignment must be a power of two. Returns an empty range when the frame's partition is exhausted
+UploadRange upload_ring_allocate(UploadRing* ring, VkDeviceSize size, VkDeviceSize alignment) {
+    UploadRange range = {};
 
-        result = vkQueueWaitIdle(renderer->queue_families.families[command_pool_index].queues[0]);
-        if(result != VK_SUCCESS) {
-            printf("vkQueueWaitIdle failed()\n");
-            return result;
-        }
+    VkDeviceSize frame_start = ring->frame_size * ring->frame_index;
+    VkDeviceSize offset = (frame_start + ring->head + alignment - 1) & ~(alignment - 1);
+    if(offset + size > frame_start + ring->frame_size) {
+        printf("upload_ring_allocate() failed. [%llu bytes requested, %llu of %llu used this frame]\n", (unsigned long long)size, (unsigned long long)ring->head, (unsigned long long)ring->frame_size);
+        return range;
     }
 
-    return result;
-}
+    ring->head = offset + size - frame_start;
 
-VkResult create_uniform_buffers(VulkanRenderer* renderer) {
-    VkResult result = VK_ERROR_UNKNOWN;
+    range.data = (u8*)ring->buffer.data + offset;
+    range.offset = offset;
+    range.size = size;
+    return range;
+}
 
-    VkDeviceSize buffer_size = sizeof(UniformBufferObject);
+VkResult update_instance_buffer(VulkanRenderer* renderer, size_t frame_index) {
+    VkResult result = VK_SUCCESS;
 
-    for(size_t uniform_buffer_index = 0; uniform_buffer_index < Swapchain::MAX_FRAMES_IN_FLIGHT; ++uniform_buffer_index) {
-        BufferAllocationInfo uniform_buffer_allocation_info = {
-            .buffer = &renderer->graphics_pipeline.uniform_buffers[uniform_buffer_index],
-            .usage_flags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            .memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            .size = buffer_size,
-            .sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
-            .map_memory = true
-        };
+    renderer->graphics_pipeline.instance_count = 0;
+    if(renderer->sprite_batch->count == 0) {
+        return result;
+    }
 
-        result = create_buffer(renderer, &uniform_buffer_allocation_info);
-        if(result != VK_SUCCESS) {
-            printf("create_buffer() failed. [Uniform Buffer]\n");
-            return result;
-        }
+    UploadRange range = upload_ring_allocate(&renderer->upload_ring, sizeof(SpriteInstance) * renderer->sprite_batch->count, alignof(SpriteInstance));
+    if(!range.data) {
+        result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        return result;
     }
 
+    size_t instance_count = sprite_batch_write_instances(renderer->sprite_batch, (SpriteInstance*)range.data, renderer->sprite_batch->count);
+    renderer->graphics_pipeline.instance_range = range;
+    renderer->graphics_pipeline.instance_count = static_cast<u32>(instance_count);
+
     return result;
 }
 
 VkResult update_uniform_buffer(VulkanRenderer* renderer, size_t image_index, Time::Duration delta_time) {
-    VkResult result = VK_ERROR_UNKNOWN;
+    VkResult result = VK_SUCCESS;
 
     UniformBufferObject uniform_buffer_object = {
         .model = MAT4_IDENTITY,
@@ -1714,7 +3800,14 @@ VkResult update_uniform_buffer(VulkanRenderer* renderer, size_t image_index, Tim
         .projection = MAT4_IDENTITY
     };
 
-    memcpy(renderer->graphics_pipeline.uniform_buffers[image_index].data, &uniform_buffer_object, sizeof(UniformBufferObject));
+    UploadRange range = upload_ring_allocate(&renderer->upload_ring, sizeof(UniformBufferObject), renderer->upload_ring.uniform_alignment);
+    if(!range.data) {
+        result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        return result;
+    }
+
+    memcpy(range.data, &uniform_buffer_object, sizeof(UniformBufferObject));
+    renderer->graphics_pipeline.uniform_range = range;
 
     return result;
 }
@@ -1725,27 +3818,17 @@ VkResult create_descriptor_pool(VulkanRenderer* renderer) {
     u32 frames_in_flight_count = static_cast<u32>(Swapchain::MAX_FRAMES_IN_FLIGHT);
 
     VkDescriptorPoolSize ubo_size = {
-        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = frames_in_flight_count
-    };
-
-    VkDescriptorPoolSize sampler_size = {
-        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
         .descriptorCount = frames_in_flight_count
     };
 
-    VkDescriptorPoolSize sizes[] = {
-        ubo_size,
-        sampler_size
-    };
-
     VkDescriptorPoolCreateInfo create_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext = nullptr,
         .flags = 0,
         .maxSets = frames_in_flight_count,
-        .poolSizeCount = 2,
-        .pPoolSizes = sizes
+        .poolSizeCount = 1,
+        .pPoolSizes = &ubo_size
     };
 
     result = vkCreateDescriptorPool(renderer->devices.logical.device, &create_info, nullptr, &renderer->graphics_pipeline.descriptor_pool);
@@ -1759,6 +3842,7 @@ VkResult create_descriptor_pool(VulkanRenderer* renderer) {
 
 VkResult create_descriptor_sets(VulkanRenderer* renderer) {
     VkResult result = VK_ERROR_UNKNOWN;
+    TraceScope trace_scope("create_descriptor_sets");
 
     VkDescriptorSetLayout layouts[Swapchain::MAX_FRAMES_IN_FLIGHT];
     for(size_t layout_index = 0; layout_index < Swapchain::MAX_FRAMES_IN_FLIGHT; ++layout_index) {
@@ -1780,8 +3864,9 @@ VkResult create_descriptor_sets(VulkanRenderer* renderer) {
     }
 
     for(size_t buffer_index = 0; buffer_index < Swapchain::MAX_FRAMES_IN_FLIGHT; ++buffer_index) {
+        //The offset into the ring is supplied per draw through vkCmdBindDescriptorSets()
         VkDescriptorBufferInfo buffer_info = {
-            .buffer = renderer->graphics_pipeline.uniform_buffers[buffer_index].buffer,
+            .buffer = renderer->upload_ring.buffer.buffer,
             .offset = 0,
             .range = sizeof(UniformBufferObject)
         };
@@ -1793,37 +3878,13 @@ VkResult create_descriptor_sets(VulkanRenderer* renderer) {
             .dstBinding = 0,
             .dstArrayElement = 0,
             .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .pImageInfo = nullptr,
             .pBufferInfo = &buffer_info,
             .pTexelBufferView = nullptr
         };
 
-        VkDescriptorImageInfo image_info = {
-            .sampler = renderer->texture_atlas.sampler,
-            .imageView = renderer->texture_atlas.textures[0].image_view,
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-        };
-
-        VkWriteDescriptorSet sampler_descriptor_set = {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .pNext = nullptr,
-            .dstSet = renderer->graphics_pipeline.descriptor_sets[buffer_index],
-            .dstBinding = 1,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &image_info,
-            .pBufferInfo = nullptr,
-            .pTexelBufferView = nullptr
-        };
-
-        VkWriteDescriptorSet write_descriptor_sets[] = {
-            ubo_descriptor_set,
-            sampler_descriptor_set
-        };
-
-        vkUpdateDescriptorSets(renderer->devices.logical.device, 2, write_descriptor_sets, 0, nullptr);
+        vkUpdateDescriptorSets(renderer->devices.logical.device, 1, &ubo_descriptor_set, 0, nullptr);
     }
 
     return result;
@@ -1848,7 +3909,7 @@ VkResult create_texture_atlas(VulkanRenderer* renderer) {
         .compareEnable = VK_FALSE,
         .compareOp = VkCompareOp::VK_COMPARE_OP_NEVER,
         .minLod = 0.0f,
-        .maxLod = 0.0f,
+        .maxLod = VK_LOD_CLAMP_NONE, //Clamped by each page's own chain
         .borderColor = VkBorderColor::VK_BORDER_COLOR_INT_OPAQUE_BLACK,
         .unnormalizedCoordinates = VK_FALSE
     };
@@ -1859,173 +3920,207 @@ VkResult create_texture_atlas(VulkanRenderer* renderer) {
         return result;
     }
 
-    return result;
-}
+    TextureAtlas* atlas = &renderer->texture_atlas;
 
-VkResult load_texture(VulkanRenderer* renderer, const char* filename) {
-    VkResult result = VK_ERROR_UNKNOWN;
+    VkPhysicalDeviceVulkan12Properties vulkan_12_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+        .pNext = nullptr
+    };
+
+    VkPhysicalDeviceProperties2 physical_device_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &vulkan_12_properties
+    };
+
+    vkGetPhysicalDeviceProperties2(renderer->devices.physical.device, &physical_device_properties);
+
+    //Mip chains are blitted on the GPU, which needs linear filtering of the page format
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(renderer->devices.physical.device, VK_FORMAT_R8G8B8A8_SRGB, &format_properties);
 
-    Texture* texture = &renderer->texture_atlas.textures[renderer->texture_atlas.next_texture_index];
+    VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    atlas->mip_levels = (format_properties.optimalTilingFeatures & blit_features) == blit_features ? TextureAtlas::MAX_MIP_LEVELS : 1;
+    if(atlas->mip_levels == 1) {
+        printf("VK_FORMAT_R8G8B8A8_SRGB can't be blitted with linear filtering, atlas pages won't have mipmaps.\n");
+    }
+
+    atlas->capacity = TextureAtlas::MAX_PAGES;
+    atlas->capacity = std::min<size_t>(atlas->capacity, vulkan_12_properties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    atlas->capacity = std::min<size_t>(atlas->capacity, vulkan_12_properties.maxDescriptorSetUpdateAfterBindSampledImages);
 
-    if(!load_image(filename, &texture->image_data)) {
-        printf("load_image() failed.\n");
+    atlas->pages = push_array<Texture>(renderer->heap_data, atlas->capacity);
+    atlas->regions = push_array<AtlasRegion>(renderer->heap_data, TextureAtlas::MAX_REGIONS);
+    atlas->region_images = push_array<ImageData>(renderer->heap_data, TextureAtlas::MAX_REGIONS);
+    if(!atlas->pages || !atlas->regions || !atlas->region_images) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("push_array() failed. [TextureAtlas %zd pages, %zd regions]\n", atlas->capacity, TextureAtlas::MAX_REGIONS);
         return result;
     }
 
-    Buffer staging_buffer = {};
+    //Slots that were never written are never read, a sprite can only use an image whose page has been built
+    VkDescriptorSetLayoutBinding texture_layout_binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = static_cast<u32>(atlas->capacity),
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .pImmutableSamplers = nullptr
+    };
+
+    VkDescriptorBindingFlags texture_binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
 
-    u32 shared_buffer_queue_family_indices[] = {
-        get_queue_family_index(renderer, QueueFamilies::Type::GRAPHICS),
-        get_queue_family_index(renderer, QueueFamilies::Type::TRANSFER)
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .pNext = nullptr,
+        .bindingCount = 1,
+        .pBindingFlags = &texture_binding_flags
     };
 
-    BufferAllocationInfo buffer_allocation_info = {
-        .buffer = &staging_buffer,
-        .usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        .memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        .size = texture->image_data.size,
-        .sharing_mode = VK_SHARING_MODE_CONCURRENT,
-        .queue_families_indices_count = 2,
-        .queue_family_indices = shared_buffer_queue_family_indices,
-        .map_memory = true
+    VkDescriptorSetLayoutCreateInfo set_layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &binding_flags_create_info,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = 1,
+        .pBindings = &texture_layout_binding
     };
 
-    result = create_buffer(renderer, &buffer_allocation_info);
+    result = vkCreateDescriptorSetLayout(renderer->devices.logical.device, &set_layout_create_info, nullptr, &atlas->set_layout);
     if(result != VK_SUCCESS) {
-        printf("create_buffer() failed.\n");
+        printf("vkCreateDescriptorSetLayout() failed. [Texture Atlas]\n");
         return result;
     }
 
-    memcpy_s(staging_buffer.data, texture->image_data.size, texture->image_data.pixels, texture->image_data.size);
+    VkDescriptorPoolSize texture_pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = static_cast<u32>(atlas->capacity)
+    };
 
-    VkImageCreateInfo image_create_info = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+    VkDescriptorPoolCreateInfo pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext = nullptr,
-        .flags = 0,
-        .imageType = VK_IMAGE_TYPE_2D,
-        .format = VK_FORMAT_R8G8B8A8_SRGB,
-        .extent = {
-            .width = texture->image_data.width,
-            .height = texture->image_data.height,
-            .depth = 1 },
-        .mipLevels = 1,
-        .arrayLayers = 1,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
-        .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        .sharingMode = VK_SHARING_MODE_CONCURRENT,
-        .queueFamilyIndexCount = 2,
-        .pQueueFamilyIndices = shared_buffer_queue_family_indices,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &texture_pool_size
     };
 
-    result = vkCreateImage(renderer->devices.logical.device, &image_create_info, nullptr, &texture->image);
+    result = vkCreateDescriptorPool(renderer->devices.logical.device, &pool_create_info, nullptr, &atlas->descriptor_pool);
     if(result != VK_SUCCESS) {
-        printf("vkCreateImage() failed.\n");
+        printf("vkCreateDescriptorPool() failed. [Texture Atlas]\n");
         return result;
     }
 
-    VkMemoryRequirements image_memory_requirements;
-    vkGetImageMemoryRequirements(renderer->devices.logical.device, texture->image, &image_memory_requirements);
-
-    VkMemoryAllocateInfo image_memory_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+    u32 variable_descriptor_count = static_cast<u32>(atlas->capacity);
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
         .pNext = nullptr,
-        .allocationSize = image_memory_requirements.size,
-        .memoryTypeIndex = (u32)find_memory_type_index(renderer, image_memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+        .descriptorSetCount = 1,
+        .pDescriptorCounts = &variable_descriptor_count
     };
 
-    result = vkAllocateMemory(renderer->devices.logical.device, &image_memory_info, nullptr, &texture->device_memory);
-    if(result != VK_SUCCESS) {
-        printf("vkAllocateMemory() failed.\n");
-        return result;
-    }
+    VkDescriptorSetAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = &variable_count_allocate_info,
+        .descriptorPool = atlas->descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &atlas->set_layout
+    };
 
-    result = vkBindImageMemory(renderer->devices.logical.device, texture->image, texture->device_memory, 0);
+    result = vkAllocateDescriptorSets(renderer->devices.logical.device, &allocate_info, &atlas->descriptor_set);
     if(result != VK_SUCCESS) {
-        printf("vkBindImageMemory() failed.\n");
+        printf("vkAllocateDescriptorSets() failed. [Texture Atlas]\n");
         return result;
     }
 
-    result = transition_image_layout(renderer, texture->image, image_create_info.format, image_create_info.initialLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    if(result != VK_SUCCESS) {
-        printf("transition_image_layout() failed.\n");
-        return result;
-    }
+    return result;
+}
 
-    size_t command_pool_index = static_cast<size_t>(QueueFamilies::Type::TRANSFER);
-    size_t command_buffer_type = static_cast<size_t>(CommandBuffers::Transfer::BUFFER_TO_IMAGE);
-    VkCommandBuffer command_buffer = renderer->command_pools[command_pool_index].buffers[command_buffer_type].buffer[0];
+//Update-after-bind, the set may already be bound in frames that are in flight. Those frames never read this slot
+void write_texture_descriptor(VulkanRenderer* renderer, size_t page_index) {
+    TextureAtlas* atlas = &renderer->texture_atlas;
 
-    VkCommandBufferBeginInfo command_buffer_begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = nullptr,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-        .pInheritanceInfo = nullptr
+    VkDescriptorImageInfo image_info = {
+        .sampler = atlas->sampler,
+        .imageView = atlas->pages[page_index].image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     };
 
-    VkImageSubresourceLayers subresource_layers = {
-        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-        .mipLevel = 0,
-        .baseArrayLayer = 0,
-        .layerCount = 1,
+    VkWriteDescriptorSet texture_descriptor_set = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = nullptr,
+        .dstSet = atlas->descriptor_set,
+        .dstBinding = 0,
+        .dstArrayElement = static_cast<u32>(page_index),
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &image_info,
+        .pBufferInfo = nullptr,
+        .pTexelBufferView = nullptr
     };
 
-    VkBufferImageCopy region = {
-        .bufferOffset = 0,
-        .bufferRowLength = 0,
-        .bufferImageHeight = 0,
-        .imageSubresource = subresource_layers,
-        .imageOffset = { 0, 0, 0 },
-        .imageExtent = {
-            .width = texture->image_data.width,
-            .height = texture->image_data.height,
-            .depth = 1 }
-    };
+    vkUpdateDescriptorSets(renderer->devices.logical.device, 1, &texture_descriptor_set, 0, nullptr);
+}
 
-    result = vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
-    if(result != VK_SUCCESS) {
-        printf("vkBeginCommandBuffer() failed.\n");
-        return result;
-    }
+//Exclusive to the graphics family, the upload manager moves ownership across for the copy
+//Level 0 only is expected in staging, callers that upload more levels fill in image_data's level table afterwards
+VkResult create_texture_image(VulkanRenderer* renderer, Texture* texture, ImageFormat format, u32 width, u32 height, u32 mip_levels) {
+    VkResult result = VK_ERROR_UNKNOWN;
 
-    vkCmdCopyBufferToImage(command_buffer, staging_buffer.buffer, texture->image, VkImageLayout::VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    texture->image_data = {
+        .pixels = nullptr,
+        .width = width,
+        .height = height,
+        .size = image_level_size(format, width, height),
+        .format = format,
+        .level_count = 1
+    };
+    texture->image_data.level_sizes[0] = texture->image_data.size;
 
-    result = vkEndCommandBuffer(command_buffer);
-    if(result != VK_SUCCESS) {
-        printf("vkEndCommandBuffer() failed.\n");
-        return result;
+    //No further than the 1x1 level
+    u32 full_chain = 1;
+    while((std::max(width, height) >> full_chain) > 0) {
+        ++full_chain;
     }
+    texture->mip_levels = std::clamp<u32>(mip_levels, 1, full_chain);
 
-    VkSubmitInfo submit_info = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    VkImageCreateInfo image_create_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext = nullptr,
-        .waitSemaphoreCount = 0,
-        .pWaitSemaphores = nullptr,
-        .pWaitDstStageMask = nullptr,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &command_buffer,
-        .signalSemaphoreCount = 0,
-        .pSignalSemaphores = nullptr
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = static_cast<VkFormat>(format),
+        .extent = {
+            .width = width,
+            .height = height,
+            .depth = 1 },
+        .mipLevels = texture->mip_levels,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = (image_format_compressed(format) ? 0u : VK_IMAGE_USAGE_TRANSFER_SRC_BIT) | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
     };
 
-    size_t queue_family_index = static_cast<size_t>(QueueFamilies::Type::TRANSFER);
-    VkQueue queue = renderer->queue_families.families[queue_family_index].queues[0];
-    result = vkQueueSubmit(queue, 1, &submit_info, nullptr);
+    result = vkCreateImage(renderer->devices.logical.device, &image_create_info, nullptr, &texture->image);
     if(result != VK_SUCCESS) {
-        printf("vkQueueSubmit() failed.\n");
+        printf("vkCreateImage() failed.\n");
         return result;
     }
 
-    result = vkQueueWaitIdle(queue);
+    VkMemoryRequirements image_memory_requirements;
+    vkGetImageMemoryRequirements(renderer->devices.logical.device, texture->image, &image_memory_requirements);
+
+    result = gpu_allocate(renderer->gpu_allocator, &image_memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GpuResourceKind::OPTIMAL_IMAGE, &texture->allocation);
     if(result != VK_SUCCESS) {
-        printf("vkQueueWaitIdle() failed.\n");
+        printf("gpu_allocate() failed.\n");
         return result;
     }
 
-    result = transition_image_layout(renderer, texture->image, image_create_info.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    result = vkBindImageMemory(renderer->devices.logical.device, texture->image, texture->allocation.memory, texture->allocation.offset);
     if(result != VK_SUCCESS) {
-        printf("transition_image_layout() failed.\n");
+        printf("vkBindImageMemory() failed.\n");
         return result;
     }
 
@@ -2035,13 +4130,13 @@ VkResult load_texture(VulkanRenderer* renderer, const char* filename) {
         .flags = 0,
         .image = texture->image,
         .viewType = VK_IMAGE_VIEW_TYPE_2D,
-        .format = VK_FORMAT_R8G8B8A8_SRGB,
+        .format = static_cast<VkFormat>(format),
         .components = {
             .r = VK_COMPONENT_SWIZZLE_IDENTITY,
             .g = VK_COMPONENT_SWIZZLE_IDENTITY,
             .b = VK_COMPONENT_SWIZZLE_IDENTITY,
             .a = VK_COMPONENT_SWIZZLE_IDENTITY },
-        .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1 }
+        .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = texture->mip_levels, .baseArrayLayer = 0, .layerCount = 1 }
 
     };
 
@@ -2051,21 +4146,312 @@ VkResult load_texture(VulkanRenderer* renderer, const char* filename) {
         return result;
     }
 
-    ++renderer->texture_atlas.next_texture_index;
+    return result;
+}
+
+//Sampled with linear filtering from optimal tiling, which is how every atlas page is used
+bool texture_format_supported(VulkanRenderer* renderer, ImageFormat format) {
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(renderer->devices.physical.device, static_cast<VkFormat>(format), &format_properties);
+
+    VkFormatFeatureFlags required_features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (format_properties.optimalTilingFeatures & required_features) == required_features;
+}
+
+//Checks that run once an image has been decoded. Frees the image when it can't be used
+VkResult validate_texture_image(VulkanRenderer* renderer, const char* filename, ImageData* image) {
+    VkResult result = VK_SUCCESS;
+
+    //Block-compressed images can't be blitted into a shared page, each gets a page of its own
+    if(image_format_compressed(image->format)) {
+        u32 max_dimension = renderer->devices.physical.properties.limits.maxImageDimension2D;
+        if(!texture_format_supported(renderer, image->format) || image->width > max_dimension || image->height > max_dimension) {
+            result = VK_ERROR_FORMAT_NOT_SUPPORTED;
+            printf("load_texture() failed. [%s is %ux%u %s, not supported by this device]\n", filename, image->width, image->height, string_VkFormat(static_cast<VkFormat>(image->format)));
+        }
+    } else {
+        u32 padded_limit = TextureAtlas::PAGE_SIZE - 2 * TextureAtlas::EXTRUDE - TextureAtlas::PADDING;
+        if(image->width > padded_limit || image->height > padded_limit) {
+            result = VK_ERROR_FORMAT_NOT_SUPPORTED;
+            printf("load_texture() failed. [%s is %ux%u, atlas images are at most %ux%u]\n", filename, image->width, image->height, padded_limit, padded_limit);
+        }
+    }
+
+    if(result != VK_SUCCESS) {
+        image_free(image);
+        *image = {};
+    }
+
+    return result;
+}
+
+void decode_image_job(void* data) {
+    ImageDecodeJob* job = (ImageDecodeJob*)data;
+    TraceScope trace_scope("decode_image");
+    job->loaded = load_image(job->filename, job->image);
+}
+
+//Takes packed images straight from the asset pack mapping and decodes the rest in parallel on the job pool, straight
+//into the atlas' pending images, and queues them for the next build_texture_atlas(). region_indices (may be null) receives the ids sprites refer to the images by, they
+//become usable once the atlas has been built. Nothing is added unless every file loads
+VkResult load_textures(VulkanRenderer* renderer, const char* const* filenames, size_t count, u32* region_indices) {
+    VkResult result = VK_SUCCESS;
+    TraceScope trace_scope("load_textures");
+    TempScope scratch(temporary_memory);
+
+    TextureAtlas* atlas = &renderer->texture_atlas;
+    if(atlas->region_count + count > TextureAtlas::MAX_REGIONS) {
+        result = VK_ERROR_TOO_MANY_OBJECTS;
+        printf("load_textures() failed. [Texture atlas full, %zd images]\n", TextureAtlas::MAX_REGIONS);
+        return result;
+    }
+
+    ImageDecodeJob* jobs = push_array<ImageDecodeJob>(temporary_memory, count);
+    if(!jobs) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("push_array() failed. [%zd decode jobs]\n", count);
+        return result;
+    }
+
+    JobCounter counter;
+    for(size_t index = 0; index < count; ++index) {
+        jobs[index] = { .filename = filenames[index], .image = &atlas->region_images[atlas->region_count + index], .loaded = false };
+
+        const AssetPack::Entry* entry = asset_pack_find(&renderer->asset_pack, filenames[index]);
+        if(entry) {
+            jobs[index].loaded = asset_pack_image(&renderer->asset_pack, entry, jobs[index].image);
+            continue;
+        }
+        job_pool_submit(renderer->job_pool, decode_image_job, &jobs[index], &counter);
+    }
+    job_pool_wait(renderer->job_pool, &counter);
+
+    for(size_t index = 0; index < count; ++index) {
+        if(!jobs[index].loaded) {
+            result = VK_ERROR_INITIALIZATION_FAILED;
+            printf("load_image() failed. [%s]\n", filenames[index]);
+        } else if(validate_texture_image(renderer, filenames[index], jobs[index].image) != VK_SUCCESS) {
+            result = VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+    }
+
+    if(result != VK_SUCCESS) {
+        for(size_t index = 0; index < count; ++index) {
+            image_free(jobs[index].image);
+            *jobs[index].image = {};
+        }
+        return result;
+    }
+
+    for(size_t index = 0; index < count; ++index) {
+        ImageData* image = jobs[index].image;
+        atlas->regions[atlas->region_count] = { .width = image->width, .height = image->height };
+        if(region_indices) {
+            region_indices[index] = static_cast<u32>(atlas->region_count);
+        }
+        ++atlas->region_count;
+    }
 
     return result;
 }
 
-size_t find_memory_type_index(VulkanRenderer* renderer, u32 memory_type_bits, VkMemoryPropertyFlags memory_property_flags) {
-    for(size_t memory_type_index = 0; memory_type_index < renderer->devices.physical.memory_properties.memoryTypeCount; ++memory_type_index) {
-        if(
-            (memory_type_bits & (1 << memory_type_index)) &&
-            memory_property_flags & renderer->devices.physical.memory_properties.memoryTypes[memory_type_index].propertyFlags) {
-            return memory_type_index;
+//region_index may be null
+VkResult load_texture(VulkanRenderer* renderer, const char* filename, u32* region_index) {
+    return load_textures(renderer, &filename, 1, region_index);
+}
+
+//Gives up on the images of a failed build. Pages created so far stay counted, so neither their indices nor the uploads
+//already queued for them are handed out again. Regions that didn't make it into a written page can't be drawn
+void texture_atlas_abandon_build(TextureAtlas* atlas, size_t first_region, size_t failed_page) {
+    for(size_t region_index = first_region; region_index < atlas->region_count; ++region_index) {
+        if(atlas->regions[region_index].page >= failed_page) {
+            atlas->regions[region_index].page = UINT32_MAX;
+        }
+        image_free(&atlas->region_images[region_index]);
+        atlas->region_images[region_index] = {};
+    }
+    atlas->built_region_count = atlas->region_count;
+}
+
+//Packs every image loaded since the last build into new pages, tallest first, and queues one upload per page. Pages
+//from earlier builds are never touched again since frames in flight may be sampling them
+VkResult build_texture_atlas(VulkanRenderer* renderer) {
+    VkResult result = VK_SUCCESS;
+    TraceScope trace_scope("build_texture_atlas");
+    TempScope scratch(temporary_memory);
+
+    TextureAtlas* atlas = &renderer->texture_atlas;
+    size_t first_region = atlas->built_region_count;
+    size_t pending_count = atlas->region_count - first_region;
+    if(pending_count == 0) {
+        return result;
+    }
+
+    u32* order = push_array<u32>(temporary_memory, pending_count);
+    size_t max_pages = std::min(pending_count, atlas->capacity - atlas->page_count);
+    SkylinePacker* packers = push_array<SkylinePacker>(temporary_memory, max_pages);
+    if(!order || (max_pages > 0 && !packers)) {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        printf("push_array() failed. [Atlas packing, %zd images]\n", pending_count);
+        return result;
+    }
+
+    for(size_t index = 0; index < pending_count; ++index) {
+        order[index] = static_cast<u32>(first_region + index);
+    }
+    std::sort(order, order + pending_count, [atlas](u32 a, u32 b) {
+        return atlas->regions[a].height != atlas->regions[b].height ? atlas->regions[a].height > atlas->regions[b].height : atlas->regions[a].width > atlas->regions[b].width;
+    });
+
+    //Each image takes up its extruded border plus the padding on its right and bottom. Earlier pages of this build
+    //are retried first so small images fill the gaps left by large ones. Cells are rounded up to the texel footprint
+    //of the smallest mip, so no texel of the chain straddles two images
+    u32 mip_alignment = 1u << (atlas->mip_levels - 1);
+    size_t first_page = atlas->page_count;
+    size_t page_count = 0;
+    for(size_t index = 0; index < pending_count; ++index) {
+        AtlasRegion* region = &atlas->regions[order[index]];
+        if(image_format_compressed(atlas->region_images[order[index]].format)) {
+            continue;
+        }
+
+        u32 padded_width = (region->width + 2 * TextureAtlas::EXTRUDE + TextureAtlas::PADDING + mip_alignment - 1) & ~(mip_alignment - 1);
+        u32 padded_height = (region->height + 2 * TextureAtlas::EXTRUDE + TextureAtlas::PADDING + mip_alignment - 1) & ~(mip_alignment - 1);
+
+        u32 x = 0;
+        u32 y = 0;
+        size_t page = 0;
+        while(page < page_count && !skyline_packer_insert(&packers[page], padded_width, padded_height, &x, &y)) {
+            ++page;
+        }
+
+        if(page == page_count) {
+            if(page_count == max_pages) {
+                result = VK_ERROR_TOO_MANY_OBJECTS;
+                printf("build_texture_atlas() failed. [Out of pages, %zd in use]\n", atlas->capacity);
+                texture_atlas_abandon_build(atlas, first_region, first_page);
+                return result;
+            }
+
+            skyline_packer_init(&packers[page_count++], TextureAtlas::PAGE_SIZE, TextureAtlas::PAGE_SIZE);
+            skyline_packer_insert(&packers[page], padded_width, padded_height, &x, &y);
+        }
+
+        region->page = static_cast<u32>(first_page + page);
+        region->x = x + TextureAtlas::EXTRUDE;
+        region->y = y + TextureAtlas::EXTRUDE;
+    }
+
+    for(size_t page = 0; page < page_count; ++page) {
+        size_t page_index = first_page + page;
+        Texture* texture = &atlas->pages[page_index];
+
+        result = create_texture_image(renderer, texture, ImageFormat::RGBA8_SRGB, packers[page].used_width, packers[page].used_height, atlas->mip_levels);
+        if(result != VK_SUCCESS) {
+            printf("create_texture_image() failed. [Atlas page %zd]\n", page_index);
+            texture_atlas_abandon_build(atlas, first_region, page_index);
+            return result;
+        }
+        atlas->page_count = page_index + 1;
+
+        //The page is assembled directly in staging, gaps stay transparent
+        VkDeviceSize staging_offset = 0;
+        result = upload_manager_reserve(renderer, texture->image_data.size, &staging_offset);
+        if(result != VK_SUCCESS) {
+            printf("upload_manager_reserve() failed. [Atlas page %zd]\n", page_index);
+            texture_atlas_abandon_build(atlas, first_region, page_index);
+            return result;
+        }
+
+        u8* page_pixels = (u8*)renderer->upload_manager.staging.data + staging_offset;
+        memset(page_pixels, 0, texture->image_data.size);
+
+        f32 page_width = static_cast<f32>(texture->image_data.width);
+        f32 page_height = static_cast<f32>(texture->image_data.height);
+        for(size_t region_index = first_region; region_index < atlas->region_count; ++region_index) {
+            AtlasRegion* region = &atlas->regions[region_index];
+            if(region->page != page_index) {
+                continue;
+            }
+
+            ImageData* image = &atlas->region_images[region_index];
+            atlas_blit_extruded(page_pixels, texture->image_data.width, image, region->x - TextureAtlas::EXTRUDE, region->y - TextureAtlas::EXTRUDE, TextureAtlas::EXTRUDE);
+            image_free(image);
+            *image = {};
+
+            region->uv_rect = {
+                .min = { static_cast<f32>(region->x) / page_width, static_cast<f32>(region->y) / page_height },
+                .max = { static_cast<f32>(region->x + region->width) / page_width, static_cast<f32>(region->y + region->height) / page_height }
+            };
+        }
+
+        result = upload_texture_from_staging(renderer, texture, staging_offset, nullptr);
+        if(result != VK_SUCCESS) {
+            printf("upload_texture_from_staging() failed. [Atlas page %zd]\n", page_index);
+            texture_atlas_abandon_build(atlas, first_region, page_index);
+            return result;
+        }
+
+        write_texture_descriptor(renderer, page_index);
+    }
+
+    //Pre-compressed images are copied as they are, their own mip chain included
+    size_t page_index = first_page + page_count;
+    for(size_t region_index = first_region; region_index < atlas->region_count; ++region_index) {
+        ImageData* image = &atlas->region_images[region_index];
+        if(!image_format_compressed(image->format)) {
+            continue;
+        }
+
+        if(page_index == atlas->capacity) {
+            result = VK_ERROR_TOO_MANY_OBJECTS;
+            printf("build_texture_atlas() failed. [Out of pages, %zd in use]\n", atlas->capacity);
+            texture_atlas_abandon_build(atlas, first_region, page_index);
+            return result;
+        }
+
+        Texture* texture = &atlas->pages[page_index];
+        result = create_texture_image(renderer, texture, image->format, image->width, image->height, image->level_count);
+        if(result != VK_SUCCESS) {
+            printf("create_texture_image() failed. [Atlas page %zd]\n", page_index);
+            texture_atlas_abandon_build(atlas, first_region, page_index);
+            return result;
+        }
+        atlas->page_count = page_index + 1;
+
+        VkDeviceSize staging_offset = 0;
+        result = upload_manager_reserve(renderer, image->size, &staging_offset);
+        if(result != VK_SUCCESS) {
+            printf("upload_manager_reserve() failed. [Atlas page %zd]\n", page_index);
+            texture_atlas_abandon_build(atlas, first_region, page_index);
+            return result;
+        }
+
+        memcpy((u8*)renderer->upload_manager.staging.data + staging_offset, image->pixels, image->size);
+        texture->image_data.size = image->size;
+        texture->image_data.level_count = texture->mip_levels;
+        memcpy(texture->image_data.level_offsets, image->level_offsets, sizeof(image->level_offsets));
+        memcpy(texture->image_data.level_sizes, image->level_sizes, sizeof(image->level_sizes));
+        image_free(image);
+        *image = {};
+
+        result = upload_texture_from_staging(renderer, texture, staging_offset, nullptr);
+        if(result != VK_SUCCESS) {
+            printf("upload_texture_from_staging() failed. [Atlas page %zd]\n", page_index);
+            texture_atlas_abandon_build(atlas, first_region, page_index);
+            return result;
         }
+
+        write_texture_descriptor(renderer, page_index);
+
+        atlas->regions[region_index].page = static_cast<u32>(page_index);
+        atlas->regions[region_index].uv_rect = UV_RECT_FULL;
+        ++page_index;
     }
 
-    return UINT64_MAX;
+    atlas->built_region_count = atlas->region_count;
+
+    return result;
 }
 
 VkResult transition_image_layout(VulkanRenderer* renderer, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout) {
@@ -2167,10 +4553,7 @@ VkResult transition_image_layout(VulkanRenderer* renderer, VkImage image, VkForm
     return result;
 }
 
-Sprite* create_sprite(VulkanRenderer* renderer, size_t texture_id) {
-    Sprite* sprite = (Sprite*)malloc(sizeof(Sprite));
-
-    sprite->texture = &renderer->texture_atlas.textures[texture_id];
+Sprite create_sprite(VulkanRenderer* renderer, size_t texture_id) {
     // sprite->dimensions = {
     //     .start = { 0.0f, 0.0f },
     //     .end = {
@@ -2178,34 +4561,21 @@ Sprite* create_sprite(VulkanRenderer* renderer, size_t texture_id) {
     //         (f32)sprite->texture->image_data.height }
     // };
 
-    // clang-format off
-    sprite->transform.translation = {
-        1, 0, 0, 0,
-        0, 1, 0, 0,
-        0, 0, 1, 0,
-        0, 0, 0, 1
-    };
-
-    sprite->transform.rotation = {
-        1, 0, 0, 0,
-        0, 1, 0, 0,
-        0, 0, 1, 0,
-        0, 0, 0, 1
-    };
-
-    sprite->transform.scale = {
-        1, 0, 0, 0,
-        0, 1, 0, 0,
-        0, 0, 1, 0,
-        0, 0, 0, 1
-    };
-    // clang-format on
+    //The bindless array is only partially bound, a page that was never built must not reach the shader
+    if(texture_id >= renderer->texture_atlas.built_region_count || renderer->texture_atlas.regions[texture_id].page == UINT32_MAX) {
+        printf("create_sprite() failed. [Texture %zd not in a built atlas page]\n", texture_id);
+        return {};
+    }
 
-    return sprite;
+    //Position, rotation and scale are written straight into renderer->sprite_batch->transforms[sprite.index]
+    AtlasRegion* region = &renderer->texture_atlas.regions[texture_id];
+    return sprite_batch_add(renderer->sprite_batch, region->page, region->uv_rect);
 }
 
-VkResult update_sprites(VulkanRenderer* renderer, Sprite* sprites[]) {
-    VkResult result = VK_ERROR_UNKNOWN;
+VkResult update_sprites(VulkanRenderer* renderer) {
+    VkResult result = VK_SUCCESS;
+
+    sprite_batch_update_transforms(renderer->sprite_batch);
 
     return result;
 }
\ No newline at end of file
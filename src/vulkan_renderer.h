@@ -1,12 +1,23 @@
 #pragma once
+#if defined(_WIN32)
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_enum_string_helper.h>
 #include "types.h"
+#include "platform_shared.h"
 #include "math.h"
 #include "memory.h"
 #include "time.h"
+#include "profiler.h"
+#include "trace.h"
 #include "texture.h"
+#include "atlas_packer.h"
+#include "job_pool.h"
+#include "asset_pack.h"
+#include "spirv_reflect.h"
+#include "gpu_memory.h"
+#include "sprite_batch.h"
 
 struct Vertex {
     Vec2 position;
@@ -79,12 +90,18 @@ struct QueueFamilies {
     u32 populated_families;
 };
 
+//Binary semaphores, only needed where the swapchain requires them. CPU waits go through a Timeline
 struct Synchronization {
     static constexpr size_t MAX_SEMAPHORES = 8;
-    static constexpr size_t MAX_FENCES = 8;
 
     VkSemaphore semaphores[MAX_SEMAPHORES];
-    VkFence fences[MAX_FENCES];
+};
+
+//A timeline semaphore and the last value handed to a submit. The GPU has finished everything up to the value
+//timeline_completed_value() reports
+struct Timeline {
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    u64 value = 0;
 };
 
 struct CommandBuffers {
@@ -93,12 +110,12 @@ struct CommandBuffers {
     enum class Graphics : size_t {
         DRAW_FRAME,
         TRANSITION_IMAGE_LAYOUT,
+        UPLOAD_ACQUIRE,
         COUNT
     };
 
     enum class Transfer : size_t {
-        BUFFER_TO_BUFFER,
-        BUFFER_TO_IMAGE,
+        UPLOAD,
         COUNT
     };
 
@@ -117,24 +134,38 @@ struct CommandBufferAllocationInfo {
     CommandBuffers::Transfer transfer_buffer_type;
     size_t buffer_count = 0;
     size_t semaphore_count = 0;
-    size_t fence_count = 0;
+};
+
+//Runtime pacing choices. Interactive sessions want one frame in flight and the latency wait, batch renders want more
+//frames in flight and a present mode that never blocks
+struct FramePacingConfig {
+    size_t frames_in_flight = 2; //1 to Swapchain::MAX_FRAMES_IN_FLIGHT
+    u32 image_count = 0; //Swapchain images, 0 picks minImageCount + 1. Clamped to what the surface allows
+    VkPresentModeKHR present_mode = VK_PRESENT_MODE_MAILBOX_KHR; //FIFO when the surface doesn't support it
+    bool latency_wait = false; //Sleep before input is sampled so the frame is submitted just ahead of vsync. FIFO modes only
+    Time::Duration latency_margin = Time::Milliseconds(2); //Slack left between the frame being ready and vsync
 };
 
 struct Swapchain {
     static constexpr size_t MIN_IMAGES = 3;
-    static constexpr size_t MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr size_t MAX_FRAMES_IN_FLIGHT = 4; //Per-frame resources are created for this many, frames_in_flight of them are used
 
     struct SupportInfo {
         VkSurfaceCapabilitiesKHR capabilities = {};
         VkSurfaceFormatKHR* surface_formats = nullptr;
         VkPresentModeKHR* present_modes = nullptr;
+        size_t present_mode_count = 0;
     };
 
+    //Fixed arrays, so recreating the swapchain never allocates
     struct Images {
+        static constexpr size_t MAX_IMAGES = 8;
+
         size_t count = 0;
-        VkImage* images = nullptr;
-        VkImageView* views = nullptr;
-        VkFramebuffer* frame_buffers = nullptr;
+        VkImage images[MAX_IMAGES] = {};
+        VkImageView views[MAX_IMAGES] = {};
+        VkFramebuffer frame_buffers[MAX_IMAGES] = {};
+        GpuAllocation allocations[MAX_IMAGES] = {}; //Offscreen mode only, swapchain images are owned by the swapchain
     };
 
     SupportInfo support_info = {};
@@ -143,14 +174,25 @@ struct Swapchain {
     VkSurfaceFormatKHR surface_format = {};
     VkExtent2D extent = {};
     Images images = {};
+    bool image_acquired = false; //Since the swapchain was created. One that was never acquired from can be destroyed straight away
+    size_t frames_in_flight = 2;
     size_t current_frame_index = 0;
 };
 
+//Learned length of the latency wait. draw_frame() measures how long the frame blocked on the GPU and the swapchain,
+//frame_pacing_wait() moves that time in front of input sampling instead
+struct FramePacingState {
+    Time::Duration delay = Time::Duration::zero();
+    Time::Duration blocked = Time::Duration::zero(); //Last frame's FRAME_WAIT + ACQUIRE
+    bool measured = false;
+};
+
 struct Shader {
     VkShaderStageFlagBits type = VkShaderStageFlagBits::VK_SHADER_STAGE_ALL;
     char file_path[MAX_PATH] = "";
     size_t file_size = 0;
     void* data = nullptr;
+    bool mapped = false; //data points into the asset pack and isn't ours to free
 };
 
 struct ShaderData {
@@ -161,7 +203,7 @@ struct ShaderData {
 
 struct Buffer {
     VkBuffer buffer = VK_NULL_HANDLE;
-    VkDeviceMemory device_memory = VK_NULL_HANDLE;
+    GpuAllocation allocation = {};
     void* data = nullptr;
 };
 
@@ -176,46 +218,290 @@ struct BufferAllocationInfo {
     bool map_memory = false;
 };
 
+//A sub-range of the upload ring, valid for the frame it was allocated in
+struct UploadRange {
+    void* data = nullptr;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+};
+
+//One persistently mapped host-visible buffer split into a partition per frame in flight. Each frame's partition is
+//handed out linearly and reset once that frame's submit has completed on the graphics timeline
+struct UploadRing {
+    static constexpr size_t FRAME_SIZE_MB = 8;
+
+    Buffer buffer = {};
+    VkDeviceSize frame_size = 0;
+    VkDeviceSize uniform_alignment = 0; //minUniformBufferOffsetAlignment
+    size_t frame_index = 0;
+    VkDeviceSize head = 0; //Relative to the start of the current frame's partition
+};
+
+//Staging copies batched into one transfer submit per flush. The staging buffer is split into a partition per batch,
+//a batch is only waited on when it comes round again while still in flight
+struct UploadManager {
+    static constexpr size_t MAX_BATCHES = 2;
+    static constexpr size_t STAGING_SIZE_MB = 64;
+
+    struct Batch {
+        VkCommandBuffer transfer_commands = VK_NULL_HANDLE;
+        VkCommandBuffer acquire_commands = VK_NULL_HANDLE; //Graphics queue half of the ownership transfer, dedicated transfer family only
+        Timeline* timeline = nullptr; //Signalled to timeline_value once the batch has landed
+        u64 timeline_value = 0;
+        VkDeviceSize staging_offset = 0; //Start of this batch's partition
+        VkDeviceSize head = 0; //Relative to staging_offset
+        u32 copy_count = 0;
+        u64 serial = 0;
+        bool recording = false;
+        bool pending = false;
+    };
+
+    Buffer staging = {};
+    VkDeviceSize batch_size = 0;
+    VkDeviceSize copy_alignment = 0;
+    Batch batches[MAX_BATCHES];
+    size_t current_batch = 0;
+    u64 next_serial = 1;
+    u64 completed_serial = 0; //Every ticket up to and including this one has landed
+};
+
 struct Texture {
     ImageData image_data;
+    u32 mip_levels;
     VkImage image;
     VkImageView image_view;
-    VkDeviceMemory device_memory;
+    GpuAllocation allocation;
 };
 
-struct TextureAtlas {
-    static constexpr size_t MAX_TEXTURES = 64;
+//Where one loaded image ended up. Sprites refer to images by region index
+struct AtlasRegion {
+    u32 page = UINT32_MAX; //UINT32_MAX until build_texture_atlas() has placed the image
+    u32 x = 0; //Top left of the image inside the page, without extrusion
+    u32 y = 0;
+    u32 width = 0;
+    u32 height = 0;
+    UvRect uv_rect = {};
+};
 
-    size_t next_texture_index = 0;
-    Texture textures[MAX_TEXTURES];
+//Loaded images are packed into shared pages and each page is uploaded once. Bindless: a page keeps the index it was
+//built at, which is also its element of the sampler2D array in set 1, so every instance picks its own page in the
+//fragment shader and any mix of images draws in one call
+struct TextureAtlas {
+    static constexpr size_t MAX_PAGES = 4096;
+    static constexpr size_t MAX_REGIONS = 16384;
+    static constexpr u32 PAGE_SIZE = 2048; //Pages are cropped to what was packed into them
+    static constexpr u32 EXTRUDE = 2; //Edge pixels repeated around every image, covers bilinear taps and a little minification
+    static constexpr u32 PADDING = 2; //Transparent gap between the extruded borders of neighbouring images
+    static constexpr u32 MAX_MIP_LEVELS = 4; //Down to 1/8 scale. Deeper levels would need wider borders to keep images from bleeding
+    static constexpr u32 DESCRIPTOR_SET = 1; //Set 0 is the per-frame uniform set
+
+    size_t capacity = 0; //MAX_PAGES clamped to the device's update-after-bind sampled image limits
+    u32 mip_levels = 1; //MAX_MIP_LEVELS, or 1 when the page format can't be blitted with linear filtering
+    size_t page_count = 0;
+    Texture* pages = nullptr;
+    AtlasRegion* regions = nullptr;
+    ImageData* region_images = nullptr; //Decoded pixels, freed once the image has been copied into its page
+    size_t region_count = 0;
+    size_t built_region_count = 0; //Regions from here to region_count wait for the next build_texture_atlas()
     VkSampler sampler;
+    VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE; //Shared by every frame, new textures are written with update-after-bind
 };
 
-struct Transform {
-    Mat4 translation = MAT4_IDENTITY;
-    Mat4 rotation = MAT4_IDENTITY;
-    Mat4 scale = MAT4_IDENTITY;
+struct ImageDecodeJob {
+    const char* filename;
+    ImageData* image;
+    bool loaded;
 };
 
-struct Sprite {
-    Texture* texture = nullptr;
-    Transform transform = {};
+//Descriptor set and pipeline layouts made from reflected shader interfaces. Pipelines whose shaders declare the same
+//resources get the same handles. Owns everything it made, destroy_renderer() hands them to the deletion queue
+struct LayoutCache {
+    static constexpr size_t MAX_SET_LAYOUTS = 16;
+    static constexpr size_t MAX_PIPELINE_LAYOUTS = 16;
+    static constexpr u32 MAX_SETS = 4;
+
+    struct SetLayout {
+        u32 binding_count;
+        VkDescriptorSetLayoutBinding bindings[ShaderInterface::MAX_BINDINGS];
+        VkDescriptorSetLayout layout;
+    };
+
+    struct PipelineLayout {
+        u32 set_count;
+        VkDescriptorSetLayout set_layouts[MAX_SETS];
+        u32 push_constant_range_count;
+        VkPushConstantRange push_constant_ranges[ShaderInterface::MAX_PUSH_CONSTANT_RANGES];
+        VkPipelineLayout layout;
+    };
+
+    size_t set_layout_count = 0;
+    SetLayout set_layouts[MAX_SET_LAYOUTS] = {};
+    size_t pipeline_layout_count = 0;
+    PipelineLayout pipeline_layouts[MAX_PIPELINE_LAYOUTS] = {};
 };
 
+//REPLACE rather than OPAQUE, which wingdi.h defines
+enum class PipelineBlend : u32 {
+    REPLACE,
+    ALPHA, //Straight alpha, over what's there
+    ADDITIVE
+};
+
+//Vertex streams a pipeline reads, build_graphics_pipeline() holds the attributes of each
+enum class VertexLayout : u32 {
+    SPRITE //Vertex at binding 0, SpriteInstance at binding 1
+};
+
+//Everything that tells two pipelines apart. Hashed and compared as bytes, so start every key from {}
+struct PipelineKey {
+    static constexpr size_t MAX_STAGES = 4;
+
+    u64 shaders[MAX_STAGES]; //AssetPack::hash_name() of each stage's SPIR-V path, 0 after the last stage
+    VkRenderPass render_pass;
+    VkPrimitiveTopology topology;
+    PipelineBlend blend;
+    VertexLayout vertex_layout;
+    VkCullModeFlags cull_mode;
+};
+
+static_assert(sizeof(PipelineKey) == 56, "PipelineKey must have no padding");
+
 struct GraphicsPipeline {
-    ShaderData shader_data = {};
-    VkPipelineLayout layout = VK_NULL_HANDLE;
-    VkPipeline pipeline = VK_NULL_HANDLE;
-    VkDescriptorSetLayout descriptor_set_layout;
+    PipelineKey key = {}; //The pipeline itself is looked up in the pipeline cache, hot reload may replace it
+    VkPipelineLayout layout = VK_NULL_HANDLE; //Owned by the layout cache
+    VkDescriptorSetLayout descriptor_set_layout; //Set 0, owned by the layout cache
     VkDescriptorSet descriptor_sets[Swapchain::MAX_FRAMES_IN_FLIGHT];
     VkRenderPass render_pass = VK_NULL_HANDLE;
     VkClearValue clear_color = { .color = { 0.0f, 0.0f, 0.0f, 0.0f } };
     Buffer vertex_buffer = {};
     Buffer index_buffer = {};
-    Buffer uniform_buffers[Swapchain::MAX_FRAMES_IN_FLIGHT];
+    UploadRange uniform_range = {}; //This frame's UniformBufferObject, bound with a dynamic offset
+    UploadRange instance_range = {}; //This frame's SpriteInstance stream
+    u32 instance_count = 0;
     VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
 };
 
+struct VulkanRenderer;
+
+//Driver pipeline cache persisted between runs, relative to the working directory like shaders/ and textures/, and the
+//pipelines made through it. Pipelines are asked for by PipelineKey, one made before costs a hash lookup. A new one is
+//built on the spot by pipeline_cache_get() or on a job worker by pipeline_cache_request()
+struct PipelineCache {
+    static constexpr const char* FILE_PATH = "pipeline_cache.bin";
+    static constexpr size_t CAPACITY = 64; //Power of two, open addressing
+
+    struct Entry {
+        PipelineKey key;
+        u64 hash;
+        bool used;
+        bool building; //A job owns pipeline and result until counter drops to 0
+        JobCounter counter;
+        VulkanRenderer* renderer; //For the build job
+        VkPipelineLayout layout; //Owned by the layout cache
+        ShaderInterface shader_interface; //Reflected from the key's shaders when the entry was made
+        VkPipeline pipeline;
+        VkResult result; //Of the build, a failed key isn't built again
+    };
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    bool warm = false; //Seeded from a compatible file on disk
+    Time::Duration creation_time = Time::Duration::zero(); //Time spent in create_graphics_pipeline()
+    ShaderData shaders = {}; //Every module a key can name, loaded once. Modules live as long as the cache
+    Entry* entries = nullptr; //CAPACITY slots in heap_data
+    size_t entry_count = 0;
+};
+
+//Watches the shader sources and, when one is saved, recompiles it with glslc and rebuilds the pipelines built from it
+//in a single job, so no frame waits on the compiler or the driver. draw_frame() swaps the new pipelines in between
+//frames and the replaced ones go through the deletion queue
+struct ShaderReload {
+    static constexpr const char* SOURCE_DIRECTORY = "shaders/";
+    static constexpr const char* COMPILED_DIRECTORY = "shaders/compiled/";
+    static constexpr size_t MAX_SOURCES = 16;
+
+    struct Compile {
+        char source_path[MAX_PATH];
+        char spirv_path[MAX_PATH]; //shader.vert compiles to shader_vert.spv, named as compile.bat does
+        bool compiled;
+    };
+
+    DirectoryWatch watch = {}; //No state while hot reload is off
+    char pending[MAX_SOURCES][MAX_PATH] = {}; //Sources saved while a reload was running, they start the next one
+    size_t pending_count = 0;
+
+    //The reload in flight
+    JobCounter counter;
+    bool running = false;
+    Compile compiles[MAX_SOURCES] = {};
+    size_t compile_count = 0;
+    PipelineCache::Entry* entries[PipelineCache::CAPACITY] = {}; //Cached pipelines built from an edited shader
+    size_t entry_count = 0;
+    VkPipeline pipelines[PipelineCache::CAPACITY] = {}; //Their rebuilds, all null unless every one of them built
+    ShaderData shaders = {}; //The recompiled modules the rebuilds came from, they replace PipelineCache::shaders
+    bool succeeded = false; //Every source compiled, the modules loaded and every entry rebuilt
+    Time::Stamp start = {};
+};
+
+//Vulkan objects the GPU may still be using. Each entry is destroyed by deletion_queue_collect() once its timeline reaches
+//the value it was pushed with, so nothing has to wait on the device to let go of a resource
+struct DeletionQueue {
+    static constexpr size_t CAPACITY = 4096;
+
+    enum class Kind : u32 {
+        BUFFER,
+        IMAGE,
+        IMAGE_VIEW,
+        FRAMEBUFFER,
+        SAMPLER,
+        SHADER_MODULE,
+        PIPELINE,
+        PIPELINE_LAYOUT,
+        DESCRIPTOR_SET_LAYOUT,
+        DESCRIPTOR_POOL,
+        RENDER_PASS,
+        SWAPCHAIN,
+        MEMORY, //allocation only
+        COUNT
+    };
+
+    struct Entry {
+        Kind kind = Kind::MEMORY;
+        union Handle {
+            VkBuffer buffer;
+            VkImage image;
+            VkImageView image_view;
+            VkFramebuffer framebuffer;
+            VkSampler sampler;
+            VkShaderModule shader_module;
+            VkPipeline pipeline;
+            VkPipelineLayout pipeline_layout;
+            VkDescriptorSetLayout descriptor_set_layout;
+            VkDescriptorPool descriptor_pool;
+            VkRenderPass render_pass;
+            VkSwapchainKHR swapchain;
+        } handle = {};
+        GpuAllocation allocation = {}; //Freed after the handle is destroyed, if it has memory
+        Timeline* timeline = nullptr; //graphics_timeline when left null
+        u64 timeline_value = 0; //0 picks the next graphics submit, which covers everything recorded so far
+    };
+
+    Entry* entries = nullptr; //Oldest first
+    size_t count = 0;
+};
+
+//A begin/end timestamp pair per GpuZone for every frame in flight. A frame's results are read back once its submit has
+//completed, so reading them never stalls
+struct GpuTimestamps {
+    static constexpr u32 QUERIES_PER_FRAME = 2 * static_cast<u32>(GPU_ZONE_COUNT);
+
+    VkQueryPool pool = VK_NULL_HANDLE; //Stays null when the graphics queue can't write timestamps
+    f64 period_ns = 0.0; //limits.timestampPeriod
+    u64 valid_mask = 0; //timestampValidBits of the graphics family
+    bool written[Swapchain::MAX_FRAMES_IN_FLIGHT] = {};
+};
+
 struct Devices {
     struct Physical {
         VkPhysicalDevice device = VK_NULL_HANDLE;
@@ -232,16 +518,35 @@ struct Devices {
 };
 
 struct VulkanRenderer {
+    static constexpr size_t MAX_SPRITES = 1 << 17;
+
     VkInstance instance = VK_NULL_HANDLE;
     Devices devices = {};
     VkSurfaceKHR surface = VK_NULL_HANDLE;
     Swapchain swapchain = {};
     GraphicsPipeline graphics_pipeline = {};
-    GraphicsPipeline point_pipeline = {};
     QueueFamilies queue_families = {};
     CommandPool command_pools[QueueFamilies::MAX_QUEUE_FAMILIES];
     TextureAtlas texture_atlas = {};
-
+    UploadRing upload_ring = {};
+    UploadManager upload_manager = {};
+    PipelineCache pipeline_cache = {};
+    ShaderReload shader_reload = {};
+    LayoutCache layout_cache = {};
+    GpuTimestamps gpu_timestamps = {};
+    DeletionQueue deletion_queue = {};
+    FramePacingConfig frame_pacing = {};
+    FramePacingState frame_pacing_state = {};
+    Timeline graphics_timeline = {};
+    Timeline transfer_timeline = {};
+    u64 frame_timeline_values[Swapchain::MAX_FRAMES_IN_FLIGHT] = {}; //graphics_timeline value of each frame slot's last submit
+    GpuAllocator* gpu_allocator = nullptr;
+    SpriteBatch* sprite_batch = nullptr;
+    JobPool* job_pool = nullptr; //Asset decoding
+    MappedAssetPack asset_pack = {}; //Checked before loose files, stays mapped while the renderer lives
+    Profiler* profiler = nullptr; //Owned by the platform's Session, zones are skipped while null
+
+    bool offscreen = false;
     bool resizing = false;
     bool should_render = true;
     bool fixed_frame_mode = false;
@@ -253,54 +558,134 @@ struct VulkanRenderer {
 struct VulkanRendererInitInfo {
     VulkanRenderer* renderer = nullptr;
     const char* application_name = "";
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
     HWND window_handle = NULL;
     HINSTANCE window_instance = NULL;
+#endif
+    bool offscreen = false;
+    Resolution offscreen_resolution = {};
+    FramePacingConfig frame_pacing = {};
+    size_t worker_count = 0; //Job pool threads, 0 for one per hardware thread besides the main one
+    const char* asset_pack_path = "assets.pak"; //Assets not in the pack, or every asset when it is missing, load from loose files
+    bool shader_hot_reload = false; //Rebuild pipelines when a source in shaders/ is saved, needs glslc
 };
 
 VkResult create_renderer(VulkanRendererInitInfo* vulkan_renderer_init_info);
+void destroy_renderer(VulkanRenderer* renderer);
+void destroy_device(VulkanRenderer* renderer);
 VkResult create_instance(VulkanRendererInitInfo* vulkan_renderer_init_info);
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
 VkResult create_win32_surface(VulkanRendererInitInfo* vulkan_renderer_init_info);
+#endif
 VkResult choose_physical_device(VulkanRenderer* renderer);
 VkResult query_queue_families(VulkanRenderer* renderer);
 VkResult create_logical_device(VulkanRenderer* renderer);
 VkResult query_swapchain_support(VulkanRenderer* renderer);
 VkResult create_swapchain(VulkanRenderer* renderer);
+VkPresentModeKHR choose_present_mode(VulkanRenderer* renderer, VkPresentModeKHR requested);
+u32 choose_image_count(VulkanRenderer* renderer, u32 requested);
+VkResult apply_frame_pacing(VulkanRenderer* renderer, FramePacingConfig* config);
+void frame_pacing_wait(VulkanRenderer* renderer);
+VkResult create_offscreen_targets(VulkanRenderer* renderer);
+VkShaderStageFlagBits shader_stage_from_file_name(const char* file_name);
+VkResult load_packed_shader_data(VulkanRenderer* renderer, const char* shader_directory, size_t* shader_count, ShaderData* shader_data);
 VkResult load_shader_data(VulkanRenderer* renderer, size_t* shader_count, ShaderData* shader_data);
-void destroy_shader_data(VulkanRenderer* renderer);
+VkResult load_loose_shader_data(VulkanRenderer* renderer, const char* shader_directory, size_t* shader_count, ShaderData* shader_data);
+void destroy_shader_data(VulkanRenderer* renderer, ShaderData* shader_data);
+VkResult create_pipeline_cache(VulkanRenderer* renderer);
+bool pipeline_cache_compatible(VulkanRenderer* renderer, const void* data, size_t size);
+VkResult save_pipeline_cache(VulkanRenderer* renderer);
+void destroy_pipeline_cache(VulkanRenderer* renderer);
 VkResult create_graphics_pipeline(VulkanRenderer* renderer);
+size_t shader_data_find(ShaderData* shader_data, u64 name);
+bool reflect_shader_data(ShaderData* shader_data, const PipelineKey* key, ShaderInterface* shader_interface);
+VkDescriptorType layout_descriptor_type(VkDescriptorType reflected_type);
+VkResult layout_cache_set_layout(VulkanRenderer* renderer, const VkDescriptorSetLayoutBinding* bindings, u32 binding_count, VkDescriptorSetLayout* set_layout);
+VkResult layout_cache_pipeline_layout(VulkanRenderer* renderer, const ShaderInterface* shader_interface, VkPipelineLayout* pipeline_layout, VkDescriptorSetLayout* set_layouts, u32* set_count);
+void destroy_layout_cache(VulkanRenderer* renderer);
+u64 pipeline_key_hash(const PipelineKey* key);
+bool pipeline_key_uses_shader(const PipelineKey* key, u64 name);
+PipelineCache::Entry* pipeline_cache_slot(PipelineCache* pipeline_cache, const PipelineKey* key, u64 hash);
+PipelineCache::Entry* pipeline_cache_insert(VulkanRenderer* renderer, const PipelineKey* key);
+VkPipeline pipeline_cache_find(VulkanRenderer* renderer, const PipelineKey* key);
+VkResult pipeline_cache_get(VulkanRenderer* renderer, const PipelineKey* key, VkPipeline* pipeline);
+VkPipeline pipeline_cache_request(VulkanRenderer* renderer, const PipelineKey* key);
+void pipeline_cache_wait(VulkanRenderer* renderer);
+void pipeline_build_job(void* data);
+VkResult build_graphics_pipeline(VulkanRenderer* renderer, const PipelineKey* key, ShaderData* shader_data, VkPipelineLayout layout, const ShaderInterface* shader_interface, VkPipeline* pipeline);
+bool shader_reload_start(VulkanRenderer* renderer);
+void shader_compile_job(void* data);
+void shader_reload_job(void* data);
+bool shader_reload_edited(ShaderReload* reload, const PipelineKey* key);
+void shader_reload_requeue(VulkanRenderer* renderer);
+void shader_reload_update(VulkanRenderer* renderer);
+void shader_reload_destroy(VulkanRenderer* renderer);
 VkResult create_frame_buffers(VulkanRenderer* renderer);
 VkResult create_command_pools(VulkanRenderer* renderer);
+VkResult create_timeline(VulkanRenderer* renderer, Timeline* timeline);
+VkResult timeline_wait(VulkanRenderer* renderer, Timeline* timeline, u64 value);
+u64 timeline_completed_value(VulkanRenderer* renderer, Timeline* timeline);
 VkResult allocate_command_buffers(VulkanRenderer* renderer, CommandBufferAllocationInfo* command_buffer_allocation_info);
+VkResult create_gpu_timestamps(VulkanRenderer* renderer);
+void gpu_zone_begin(VulkanRenderer* renderer, VkCommandBuffer command_buffer, GpuZone zone);
+void gpu_zone_end(VulkanRenderer* renderer, VkCommandBuffer command_buffer, GpuZone zone);
+void collect_gpu_timestamps(VulkanRenderer* renderer, size_t frame_index);
 VkResult record_command_buffer(VulkanRenderer* renderer, VkCommandBuffer buffer, size_t image_index);
 VkResult draw_frame(VulkanRenderer* renderer, Time::Duration delta_time);
 
 VkResult create_buffer(VulkanRenderer* renderer, BufferAllocationInfo* buffer_allocation_info);
+void destroy_buffer(VulkanRenderer* renderer, Buffer* buffer);
+VkResult create_deletion_queue(VulkanRenderer* renderer);
+void deletion_queue_push(VulkanRenderer* renderer, DeletionQueue::Entry* entry);
+void deletion_queue_destroy_entry(VulkanRenderer* renderer, DeletionQueue::Entry* entry);
+void deletion_queue_collect(VulkanRenderer* renderer, bool wait_all);
+void defer_destroy_buffer(VulkanRenderer* renderer, Buffer* buffer);
+void defer_destroy_texture(VulkanRenderer* renderer, Texture* texture);
 VkResult create_vertex_buffers(VulkanRenderer* renderer);
 
 VkResult resize(VulkanRenderer* renderer);
+void destroy_swapchain_images(VulkanRenderer* renderer, Swapchain::Images* images, bool deferred);
 
-VkResult create_point_pipeline(VulkanRenderer* renderer);
+VkResult create_point_pipeline(VulkanRenderer* renderer, VkPipeline* pipeline);
 
 u32 get_queue_family_index(VulkanRenderer* renderer, QueueFamilies::Type type);
-
-VkResult record_staging_command_buffer(VulkanRenderer* renderer, Buffer* buffer, VkDeviceSize size);
+bool has_dedicated_transfer_family(VulkanRenderer* renderer);
 
 VkResult create_vertex_buffer(VulkanRenderer* renderer);
 VkResult create_index_buffer(VulkanRenderer* renderer);
-VkResult create_uniform_buffers(VulkanRenderer* renderer);
+VkResult create_upload_manager(VulkanRenderer* renderer);
+VkResult upload_manager_begin_batch(VulkanRenderer* renderer);
+VkResult upload_manager_reserve(VulkanRenderer* renderer, VkDeviceSize size, VkDeviceSize* staging_offset);
+VkResult upload_buffer(VulkanRenderer* renderer, Buffer* destination, const void* data, VkDeviceSize size, VkPipelineStageFlags destination_stage, VkAccessFlags destination_access, u64* ticket);
+VkResult upload_texture(VulkanRenderer* renderer, Texture* texture, const void* pixels, VkDeviceSize size, u64* ticket);
+VkResult upload_texture_from_staging(VulkanRenderer* renderer, Texture* texture, VkDeviceSize staging_offset, u64* ticket);
+void record_mipmap_generation(VkCommandBuffer command_buffer, Texture* texture, u32 first_level);
+VkResult upload_manager_flush(VulkanRenderer* renderer);
+void upload_manager_collect(VulkanRenderer* renderer);
+bool upload_complete(VulkanRenderer* renderer, u64 ticket);
+VkResult create_upload_ring(VulkanRenderer* renderer);
+void upload_ring_begin_frame(UploadRing* ring, size_t frame_index);
+UploadRange upload_ring_allocate(UploadRing* ring, VkDeviceSize size, VkDeviceSize alignment);
 
 VkResult update_uniform_buffer(VulkanRenderer* renderer, size_t image_index, Time::Duration delta_time);
+VkResult update_instance_buffer(VulkanRenderer* renderer, size_t frame_index);
 
 VkResult create_descriptor_pool(VulkanRenderer* renderer);
 VkResult create_descriptor_sets(VulkanRenderer* renderer);
 
 VkResult create_texture_atlas(VulkanRenderer* renderer);
+void write_texture_descriptor(VulkanRenderer* renderer, size_t page_index);
 
-VkResult load_texture(VulkanRenderer* renderer, const char* filename);
-
-size_t find_memory_type_index(VulkanRenderer* renderer, u32 memory_type_bits, VkMemoryPropertyFlags memory_property_flags);
+VkResult create_texture_image(VulkanRenderer* renderer, Texture* texture, ImageFormat format, u32 width, u32 height, u32 mip_levels);
+bool texture_format_supported(VulkanRenderer* renderer, ImageFormat format);
+VkResult validate_texture_image(VulkanRenderer* renderer, const char* filename, ImageData* image);
+void decode_image_job(void* data);
+VkResult load_textures(VulkanRenderer* renderer, const char* const* filenames, size_t count, u32* region_indices);
+VkResult load_texture(VulkanRenderer* renderer, const char* filename, u32* region_index);
+void texture_atlas_abandon_build(TextureAtlas* atlas, size_t first_region, size_t failed_page);
+VkResult build_texture_atlas(VulkanRenderer* renderer);
 
 VkResult transition_image_layout(VulkanRenderer* renderer, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
 
-Sprite* create_sprite(VulkanRenderer* renderer, size_t texture_id);
-VkResult update_sprites(VulkanRenderer* renderer, Sprite* sprites[]);
\ No newline at end of file
+Sprite create_sprite(VulkanRenderer* renderer, size_t texture_id);
+VkResult update_sprites(VulkanRenderer* renderer);
\ No newline at end of file